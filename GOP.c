@@ -17,8 +17,11 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
+#include <Library/TimerLib.h>
 #include "UefiDebug.h"
 #include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Surface.h"
 #include "Rectangle.h"
 
 /*
@@ -27,12 +30,64 @@
 **----------------------------------------------------------------------------
 */
 
+#define BLT_BATCH_INITIAL_SIZE	256
+#define BLT_BATCH_LOOKAHEAD		16
+#define GOP_CONTEXT_MAX			4
+#define GOP_TUNE_CACHE_MAX		16
+#define GOP_TUNE_WIDTH			1024	/* Rows reach GOP_PIXEL_STREAM_MIN_BYTES, so streaming is timed */
+#define GOP_TUNE_HEIGHT			16
+#define GOP_TUNE_ROUNDS			4
+
 /*
 **----------------------------------------------------------------------------
 **  Type Definitions
 **----------------------------------------------------------------------------
 */
 
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL	*ptGraphicsOutput;
+	UINT32							nModeNumber;
+	UINTN							nWidth;
+	UINTN							nHeight;
+	PIXEL_LAYOUT					tLayout;
+	UINT8							*pFrameBuffer;	/* NULL = BLT only */
+	UINTN							nPitch;			/* Framebuffer bytes per scan line */
+	UINTN							nOutputPath;	/* GOP_OUTPUT_* */
+} GOP_CONTEXT;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL	*ptGraphicsOutput;
+	UINT32							nModeNumber;
+	UINTN							nOutputPath;
+} GOP_TUNE_RESULT;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL	*ptGraphicsOutput;	/* NULL when disabled */
+	SURFACE							tSurface;
+	RECT_LIST						tDirty;
+} SHADOW_FRAMEBUFFER;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL	*ptGraphicsOutput;	/* NULL when drawing to the GOP */
+	SURFACE							*ptSurface;
+} DRAW_TARGET;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_BLT_OPERATION	nMode;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL	*ptPixels;	/* First source pixel, unused for fills */
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL	tColor;		/* Fill color */
+	UINTN							nDelta;		/* Source stride in bytes */
+	RECT							tRect;		/* Destination on screen */
+	BOOLEAN							bDropped;
+} BLT_COMMAND;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL	*ptGraphicsOutput;	/* NULL when no batch is open */
+	BLT_COMMAND						*ptCommands;
+	UINTN							nCount;
+	UINTN							nCapacity;
+} BLT_BATCH;
+
 /*
 **---------------------------------------------------------------------------
 **  Global variables
@@ -45,16 +100,756 @@
 **---------------------------------------------------------------------------
 */
 
+static GOP_CONTEXT gatContexts[GOP_CONTEXT_MAX];
+static UINTN gnNextContext = 0;
+static GOP_TUNE_RESULT gatTuneResults[GOP_TUNE_CACHE_MAX];
+static UINTN gnNextTuneResult = 0;
+static SHADOW_FRAMEBUFFER gtShadow = { NULL, { 0 }, { 0 } };
+static DRAW_TARGET gtTarget = { NULL, NULL };
+static BLT_BATCH gtBatch = { NULL, NULL, 0, 0 };
+
 /*
 **---------------------------------------------------------------------------
 **  Function(internal use only) Declarations
 **---------------------------------------------------------------------------
 */
 
+/*
+** ===========================================================================
+** Function: FrameBufferBlt()
+** Description: Performs a BLT operation by writing the linear framebuffer
+** directly with the row kernel of the mode's pixel format
+** Input:
+**		ptContext: GOP context with a mapped framebuffer
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		nBufX, nBufY: Position inside the BLT buffer
+**		nX, nY: Position on screen
+**		nWidth, nHeight: Size of the operation
+**		nDelta: BLT buffer stride in bytes (0 = nWidth pixels)
+**		bStream: TRUE = use non-temporal stores for rows of at least
+**		GOP_PIXEL_STREAM_MIN_BYTES
+** Output: Updated framebuffer/BLT buffer
+** Return value: EFI_INVALID_PARAMETER -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+FrameBufferBlt(
+	IN GOP_CONTEXT *ptContext,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN UINTN nBufX,
+	IN UINTN nBufY,
+	IN UINTN nX,
+	IN UINTN nY,
+	IN UINTN nWidth,
+	IN UINTN nHeight,
+	IN UINTN nDelta,
+	IN BOOLEAN bStream
+)
+{
+	UINT8      *pRow;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBufRow;
+	UINTN      nStride;
+	UINTN      nRow;
+	UINT32     nValue;
+	if (nWidth == 0 || nHeight == 0 || nX + nWidth > ptContext->nWidth || nY + nHeight > ptContext->nHeight)
+		return EFI_INVALID_PARAMETER;
+	nStride = (nDelta == 0) ? nWidth : nDelta / sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+	/* Short rows stay cached, streaming only pays off on large ones */
+	bStream = (BOOLEAN)(bStream && nWidth * sizeof(UINT32) >= GOP_PIXEL_STREAM_MIN_BYTES);
+	pRow = ptContext->pFrameBuffer + nY * ptContext->nPitch + nX * sizeof(UINT32);
+	ptBufRow = ptBlt + nBufY * nStride + nBufX;
+	switch (nMode) {
+	case EfiBltVideoFill:
+		nValue = PackPixel(&ptContext->tLayout, ptBlt);
+		for (nRow = 0; nRow < nHeight; nRow++, pRow += ptContext->nPitch)
+			FillPixelRow(pRow, nValue, nWidth, bStream);
+		break;
+	case EfiBltBufferToVideo:
+		for (nRow = 0; nRow < nHeight; nRow++, pRow += ptContext->nPitch, ptBufRow += nStride)
+			WritePixelRow(&ptContext->tLayout, pRow, ptBufRow, nWidth, bStream);
+		break;
+	case EfiBltVideoToBltBuffer:
+		for (nRow = 0; nRow < nHeight; nRow++, pRow += ptContext->nPitch, ptBufRow += nStride)
+			ReadPixelRow(&ptContext->tLayout, ptBufRow, pRow, nWidth);
+		break;
+	default:
+		return EFI_INVALID_PARAMETER;
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: PathBlt()
+** Description: Performs a BLT operation on the display through a specific
+** output path. Paths the mode cannot use fall back to a full-rect Blt().
+** Input:
+**		ptContext: GOP context
+**		nPath: GOP_OUTPUT_* path
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		nBufX, nBufY: Position inside the BLT buffer
+**		nX, nY: Position on screen
+**		nWidth, nHeight: Size of the operation
+**		nDelta: BLT buffer stride in bytes (0 = nWidth pixels)
+** Output: BLT data output on the screen
+** Return value: Status of the BLT operation
+** ===========================================================================
+*/
+static
+EFI_STATUS
+PathBlt(
+	IN GOP_CONTEXT *ptContext,
+	IN UINTN nPath,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN UINTN nBufX,
+	IN UINTN nBufY,
+	IN UINTN nX,
+	IN UINTN nY,
+	IN UINTN nWidth,
+	IN UINTN nHeight,
+	IN UINTN nDelta
+)
+{
+	EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput = ptContext->ptGraphicsOutput;
+	EFI_STATUS nStatus;
+	UINTN      nRow;
+	switch (nPath) {
+	case GOP_OUTPUT_FRAMEBUFFER:
+	case GOP_OUTPUT_FRAMEBUFFER_STREAM:
+		if (ptContext->pFrameBuffer != NULL && nMode != EfiBltVideoToVideo)
+			return FrameBufferBlt(ptContext, ptBlt, nMode, nBufX, nBufY, nX, nY, nWidth, nHeight, nDelta, (BOOLEAN)(nPath == GOP_OUTPUT_FRAMEBUFFER_STREAM));
+		break;
+	case GOP_OUTPUT_BLT_ROWS:
+		if (nMode == EfiBltBufferToVideo || nMode == EfiBltVideoFill)
+		{
+			if (nDelta == 0)
+				nDelta = nWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+			for (nRow = 0; nRow < nHeight; nRow++)
+			{
+				nStatus = ptGraphicsOutput->Blt(ptGraphicsOutput, ptBlt, nMode, nBufX, nBufY + nRow, nX, nY + nRow, nWidth, 1, nDelta);
+				if (nStatus != EFI_SUCCESS)
+					return nStatus;
+			}
+			return EFI_SUCCESS;
+		}
+		break;
+	default:
+		break;
+	}
+	if (nMode == EfiBltVideoToBltBuffer)
+		return ptGraphicsOutput->Blt(ptGraphicsOutput, ptBlt, nMode, nX, nY, nBufX, nBufY, nWidth, nHeight, nDelta);
+	return ptGraphicsOutput->Blt(ptGraphicsOutput, ptBlt, nMode, nBufX, nBufY, nX, nY, nWidth, nHeight, nDelta);
+}
+
+/*
+** ===========================================================================
+** Function: TuneOutputPath()
+** Description: Times every output path the mode supports by rewriting a
+** small screen region with its own contents (invisible to the user) and
+** picks the fastest one
+** Input:
+**		ptContext: GOP context (mode fields already filled)
+** Output: None
+** Return value: Fastest GOP_OUTPUT_* path
+** ===========================================================================
+*/
+static
+UINTN
+TuneOutputPath(
+	IN GOP_CONTEXT *ptContext
+)
+{
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptPixels;
+	UINTN      nWidth = MIN(GOP_TUNE_WIDTH, ptContext->nWidth);
+	UINTN      nHeight = MIN(GOP_TUNE_HEIGHT, ptContext->nHeight);
+	UINTN      nBestPath;
+	UINTN      nPath;
+	UINTN      nRound;
+	UINT64     nBestTicks;
+	UINT64     nTicks;
+	UINT64     nStart;
+	nBestPath = (ptContext->pFrameBuffer != NULL) ? GOP_OUTPUT_FRAMEBUFFER : GOP_OUTPUT_BLT;
+	if ((ptPixels = AllocatePool(nWidth * nHeight * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL))) == NULL)
+		return nBestPath;
+	if (PathBlt(ptContext, GOP_OUTPUT_BLT, ptPixels, EfiBltVideoToBltBuffer, 0, 0, 0, 0, nWidth, nHeight, 0) != EFI_SUCCESS)
+	{
+		FreePool(ptPixels);
+		return nBestPath;
+	}
+	nBestTicks = (UINT64)~0;
+	for (nPath = GOP_OUTPUT_BLT; nPath <= GOP_OUTPUT_FRAMEBUFFER_STREAM; nPath++)
+	{
+		if (nPath >= GOP_OUTPUT_FRAMEBUFFER && ptContext->pFrameBuffer == NULL)
+			break;
+		/* Untimed warm-up pass, then keep the best round */
+		if (PathBlt(ptContext, nPath, ptPixels, EfiBltBufferToVideo, 0, 0, 0, 0, nWidth, nHeight, 0) != EFI_SUCCESS)
+			continue;
+		for (nRound = 0; nRound < GOP_TUNE_ROUNDS; nRound++)
+		{
+			nStart = GetPerformanceCounter();
+			PathBlt(ptContext, nPath, ptPixels, EfiBltBufferToVideo, 0, 0, 0, 0, nWidth, nHeight, 0);
+			nTicks = GetElapsedTicks(nStart, GetPerformanceCounter());
+			if (nTicks < nBestTicks)
+			{
+				nBestTicks = nTicks;
+				nBestPath = nPath;
+			}
+		}
+	}
+	FreePool(ptPixels);
+	ASSERT_DEBUG_MSGONLY("Mode %d: output path %d (%ld ticks)", ptContext->nModeNumber, nBestPath, nBestTicks);
+	return nBestPath;
+}
+
+/*
+** ===========================================================================
+** Function: GetTuneResult()
+** Description: Finds the cached output path entry of a GOP mode
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		nModeNumber: GOP mode
+** Output: None
+** Return value: NULL -> Not cached, Entry -> Success
+** ===========================================================================
+*/
+static
+GOP_TUNE_RESULT*
+GetTuneResult(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN UINT32 nModeNumber
+)
+{
+	UINTN      nIndex;
+	for (nIndex = 0; nIndex < GOP_TUNE_CACHE_MAX; nIndex++)
+	{
+		if (gatTuneResults[nIndex].ptGraphicsOutput == ptGraphicsOutput && gatTuneResults[nIndex].nModeNumber == nModeNumber)
+			return &gatTuneResults[nIndex];
+	}
+	return NULL;
+}
+
+/*
+** ===========================================================================
+** Function: GetGopContext()
+** Description: Returns the cached state of a GOP, refreshing it when the GOP
+** is new or its mode changed. The first use of a mode tunes its output path.
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Up-to-date context
+** Return value: Context of the GOP
+** ===========================================================================
+*/
+static
+GOP_CONTEXT*
+GetGopContext(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+)
+{
+	GOP_CONTEXT *ptContext = NULL;
+	GOP_TUNE_RESULT *ptResult;
+	EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *ptMode = ptGraphicsOutput->Mode;
+	UINTN      nIndex;
+	for (nIndex = 0; nIndex < GOP_CONTEXT_MAX; nIndex++)
+	{
+		if (gatContexts[nIndex].ptGraphicsOutput == ptGraphicsOutput)
+		{
+			ptContext = &gatContexts[nIndex];
+			if (ptContext->nModeNumber == ptMode->Mode)
+				return ptContext;
+			break;
+		}
+	}
+	if (ptContext == NULL)
+	{
+		ptContext = &gatContexts[gnNextContext];
+		gnNextContext = (gnNextContext + 1) % GOP_CONTEXT_MAX;
+	}
+	ptContext->ptGraphicsOutput = ptGraphicsOutput;
+	ptContext->nModeNumber = ptMode->Mode;
+	ptContext->nWidth = ptMode->Info->HorizontalResolution;
+	ptContext->nHeight = ptMode->Info->VerticalResolution;
+	ptContext->pFrameBuffer = NULL;
+	ptContext->nPitch = 0;
+#if !defined(GOP_NO_DIRECT_FRAMEBUFFER)
+	if (InitPixelLayout(&ptContext->tLayout, ptMode->Info) == TRUE && ptMode->FrameBufferBase != 0 &&
+		ptMode->FrameBufferSize >= (UINTN)ptMode->Info->PixelsPerScanLine * ptMode->Info->VerticalResolution * ptContext->tLayout.nPixelBytes)
+	{
+		ptContext->pFrameBuffer = (UINT8 *)(UINTN)ptMode->FrameBufferBase;
+		ptContext->nPitch = ptMode->Info->PixelsPerScanLine * ptContext->tLayout.nPixelBytes;
+	}
+#endif
+	ptResult = GetTuneResult(ptGraphicsOutput, ptMode->Mode);
+	if (ptResult == NULL)
+	{
+		ptResult = &gatTuneResults[gnNextTuneResult];
+		gnNextTuneResult = (gnNextTuneResult + 1) % GOP_TUNE_CACHE_MAX;
+		ptResult->ptGraphicsOutput = ptGraphicsOutput;
+		ptResult->nModeNumber = ptMode->Mode;
+		ptResult->nOutputPath = TuneOutputPath(ptContext);
+	}
+	ptContext->nOutputPath = ptResult->nOutputPath;
+	return ptContext;
+}
+
+/*
+** ===========================================================================
+** Function: DeviceBlt()
+** Description: Performs a BLT operation on the display itself through the
+** output path tuned (or forced) for the current mode
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		nBufX, nBufY: Position inside the BLT buffer
+**		nX, nY: Position on screen
+**		nWidth, nHeight: Size of the operation
+**		nDelta: BLT buffer stride in bytes (0 = nWidth pixels)
+** Output: BLT data output on the screen
+** Return value: Status of the BLT operation
+** ===========================================================================
+*/
+static
+EFI_STATUS
+DeviceBlt(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN UINTN nBufX,
+	IN UINTN nBufY,
+	IN UINTN nX,
+	IN UINTN nY,
+	IN UINTN nWidth,
+	IN UINTN nHeight,
+	IN UINTN nDelta
+)
+{
+	GOP_CONTEXT *ptContext = GetGopContext(ptGraphicsOutput);
+	return PathBlt(ptContext, ptContext->nOutputPath, ptBlt, nMode, nBufX, nBufY, nX, nY, nWidth, nHeight, nDelta);
+}
+
+/*
+** ===========================================================================
+** Function: ShadowBlt()
+** Description: Performs a BLT operation on the shadow framebuffer instead of
+** video memory, clipped to the shadow size, recording the touched area as dirty
+** Input:
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		nBufX, nBufY: Position inside the BLT buffer
+**		nX, nY: Position on screen
+**		nWidth, nHeight: Size of the operation
+**		nDelta: BLT buffer stride in bytes (0 = nWidth pixels)
+** Output: Updated shadow framebuffer/BLT buffer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+ShadowBlt(
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN UINTN nBufX,
+	IN UINTN nBufY,
+	IN UINTN nX,
+	IN UINTN nY,
+	IN UINTN nWidth,
+	IN UINTN nHeight,
+	IN UINTN nDelta
+)
+{
+	RECT       tDirty;
+	UINTN      nLimitX = gtShadow.tSurface.nWidth;
+	UINTN      nLimitY = gtShadow.tSurface.nHeight;
+	/* Clip to the shadow so the dirty list never holds off-screen areas */
+	if (nX >= nLimitX || nY >= nLimitY)
+		return EFI_SUCCESS;
+	if (nMode == EfiBltVideoToVideo) {
+		if (nBufX >= nLimitX || nBufY >= nLimitY)
+			return EFI_SUCCESS;
+		nLimitX -= MAX(nX, nBufX) - nX;
+		nLimitY -= MAX(nY, nBufY) - nY;
+	}
+	if (nDelta == 0)
+		nDelta = nWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+	nWidth = MIN(nWidth, nLimitX - nX);
+	nHeight = MIN(nHeight, nLimitY - nY);
+	ASSERT_CHECK_EFISTATUS(SurfaceBlt(&gtShadow.tSurface, ptBlt, nMode, nBufX, nBufY, nX, nY, nWidth, nHeight, nDelta));
+	if (nMode == EfiBltVideoToBltBuffer || nWidth == 0 || nHeight == 0)
+		return EFI_SUCCESS;
+	SetRect(&tDirty, nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+	AddRectToList(&gtShadow.tDirty, &tDirty);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: OutputBlt()
+** Description: Sends a BLT operation down the active output path (bound draw
+** target surface, shadow framebuffer when enabled for this GOP, the display
+** otherwise)
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		nBufX, nBufY: Position inside the BLT buffer
+**		nX, nY: Position on screen
+**		nWidth, nHeight: Size of the operation
+**		nDelta: BLT buffer stride in bytes (0 = nWidth pixels)
+** Output: BLT data output on the screen
+** Return value: Status of the BLT operation
+** ===========================================================================
+*/
+static
+EFI_STATUS
+OutputBlt(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN UINTN nBufX,
+	IN UINTN nBufY,
+	IN UINTN nX,
+	IN UINTN nY,
+	IN UINTN nWidth,
+	IN UINTN nHeight,
+	IN UINTN nDelta
+)
+{
+	if (gtTarget.ptGraphicsOutput == ptGraphicsOutput)
+		return SurfaceBlt(gtTarget.ptSurface, ptBlt, nMode, nBufX, nBufY, nX, nY, nWidth, nHeight, nDelta);
+	if (gtShadow.ptGraphicsOutput == ptGraphicsOutput)
+		return ShadowBlt(ptBlt, nMode, nBufX, nBufY, nX, nY, nWidth, nHeight, nDelta);
+	return DeviceBlt(ptGraphicsOutput, ptBlt, nMode, nBufX, nBufY, nX, nY, nWidth, nHeight, nDelta);
+}
+
+/*
+** ===========================================================================
+** Function: IsUniformBlt()
+** Description: Checks whether every pixel of a BLT region has the same color
+** Input:
+**		ptPixels: First pixel of the region
+**		nWidth, nHeight: Region size
+**		nDelta: Stride in bytes
+** Output: None
+** Return value: FALSE -> Multiple colors, TRUE -> Single color
+** ===========================================================================
+*/
+static
+BOOLEAN
+IsUniformBlt(
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptPixels,
+	IN UINTN nWidth,
+	IN UINTN nHeight,
+	IN UINTN nDelta
+)
+{
+	CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptRow;
+	UINTN      nRow;
+	UINTN      nCol;
+	for (nRow = 0; nRow < nHeight; nRow++)
+	{
+		ptRow = (CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)((CONST UINT8 *)ptPixels + nRow * nDelta);
+		for (nCol = 0; nCol < nWidth; nCol++)
+		{
+			if (ptRow[nCol].Blue != ptPixels->Blue || ptRow[nCol].Green != ptPixels->Green || ptRow[nCol].Red != ptPixels->Red)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: IsRectInside()
+** Description: Checks whether a rectangle lies completely inside another
+** Input:
+**		ptOuter: Containing rectangle
+**		ptInner: Contained rectangle
+** Output: None
+** Return value: FALSE -> Not contained, TRUE -> Contained
+** ===========================================================================
+*/
+static
+BOOLEAN
+IsRectInside(
+	IN CONST RECT *ptOuter,
+	IN CONST RECT *ptInner
+)
+{
+	return (BOOLEAN)(ptInner->nLeft >= ptOuter->nLeft && ptInner->nRight <= ptOuter->nRight &&
+		ptInner->nTop >= ptOuter->nTop && ptInner->nBottom <= ptOuter->nBottom);
+}
+
+/*
+** ===========================================================================
+** Function: DropOverwrittenBlts()
+** Description: Marks queued commands whose area is completely redrawn by a
+** later command of the batch. Identical rectangles are found through a hash
+** over the whole batch, general containment within a short look-ahead.
+** Input: None
+** Output: Commands flagged as dropped
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+DropOverwrittenBlts(
+	VOID
+)
+{
+	BLT_COMMAND *ptCommands = gtBatch.ptCommands;
+	UINTN      *pnTable;
+	UINTN      nTableSize;
+	UINTN      nSlot;
+	UINTN      nIndex;
+	UINTN      nNext;
+	UINTN      nEnd;
+	for (nTableSize = 16; nTableSize < gtBatch.nCount * 2; nTableSize <<= 1);
+	pnTable = AllocateZeroPool(nTableSize * sizeof(UINTN));
+	if (pnTable != NULL)
+	{
+		nIndex = gtBatch.nCount;
+		while (nIndex-- > 0)
+		{
+			nSlot = (ptCommands[nIndex].tRect.nLeft * 73856093 ^ ptCommands[nIndex].tRect.nTop * 19349663 ^
+				ptCommands[nIndex].tRect.nRight * 83492791 ^ ptCommands[nIndex].tRect.nBottom * 2654435761u) & (nTableSize - 1);
+			while (pnTable[nSlot] != 0)
+			{
+				if (CompareMem(&ptCommands[pnTable[nSlot] - 1].tRect, &ptCommands[nIndex].tRect, sizeof(RECT)) == 0)
+				{
+					ptCommands[nIndex].bDropped = TRUE;
+					break;
+				}
+				nSlot = (nSlot + 1) & (nTableSize - 1);
+			}
+			if (pnTable[nSlot] == 0)
+				pnTable[nSlot] = nIndex + 1;
+		}
+		FreePool(pnTable);
+	}
+	for (nIndex = 0; nIndex < gtBatch.nCount; nIndex++)
+	{
+		if (ptCommands[nIndex].bDropped == TRUE)
+			continue;
+		nEnd = MIN(gtBatch.nCount, nIndex + 1 + BLT_BATCH_LOOKAHEAD);
+		for (nNext = nIndex + 1; nNext < nEnd; nNext++)
+		{
+			if (ptCommands[nNext].bDropped == FALSE && IsRectInside(&ptCommands[nNext].tRect, &ptCommands[nIndex].tRect))
+			{
+				ptCommands[nIndex].bDropped = TRUE;
+				break;
+			}
+		}
+	}
+}
+
+/*
+** ===========================================================================
+** Function: MergeBltCommands()
+** Description: Tries to extend a command with the one issued right after it:
+** same-color fills sharing an edge, or rows that continue each other in the
+** same source buffer
+** Input:
+**		ptInto: Command to extend
+**		ptNext: Following command
+** Output: Extended command
+** Return value: FALSE -> Not mergeable, TRUE -> Merged
+** ===========================================================================
+*/
+static
+BOOLEAN
+MergeBltCommands(
+	IN OUT   BLT_COMMAND *ptInto,
+	IN CONST BLT_COMMAND *ptNext
+)
+{
+	RECT       *ptInRect = &ptInto->tRect;
+	CONST RECT *ptNextRect = &ptNext->tRect;
+	if (ptInto->nMode != ptNext->nMode)
+		return FALSE;
+	if (ptInto->nMode == EfiBltVideoFill)
+	{
+		if (ptInto->tColor.Blue != ptNext->tColor.Blue || ptInto->tColor.Green != ptNext->tColor.Green || ptInto->tColor.Red != ptNext->tColor.Red)
+			return FALSE;
+		if (ptInRect->nLeft == ptNextRect->nLeft && ptInRect->nRight == ptNextRect->nRight && ptNextRect->nTop == ptInRect->nBottom + 1)
+		{
+			ptInRect->nBottom = ptNextRect->nBottom;
+			return TRUE;
+		}
+		if (ptInRect->nTop == ptNextRect->nTop && ptInRect->nBottom == ptNextRect->nBottom && ptNextRect->nLeft == ptInRect->nRight + 1)
+		{
+			ptInRect->nRight = ptNextRect->nRight;
+			return TRUE;
+		}
+		return FALSE;
+	}
+	if (ptInRect->nLeft == ptNextRect->nLeft && ptInRect->nRight == ptNextRect->nRight && ptNextRect->nTop == ptInRect->nBottom + 1 &&
+		ptInto->nDelta == ptNext->nDelta && (UINT8 *)ptNext->ptPixels == (UINT8 *)ptInto->ptPixels + HeightRect(ptInRect) * ptInto->nDelta)
+	{
+		ptInRect->nBottom = ptNextRect->nBottom;
+		return TRUE;
+	}
+	if (ptInRect->nTop == ptInRect->nBottom && ptNextRect->nTop == ptInRect->nTop && ptNextRect->nBottom == ptInRect->nBottom &&
+		ptNextRect->nLeft == ptInRect->nRight + 1 && ptNext->ptPixels == ptInto->ptPixels + WidthRect(ptInRect))
+	{
+		/* Single rows: the stride only has to cover the new width */
+		ptInRect->nRight = ptNextRect->nRight;
+		ptInto->nDelta = WidthRect(ptInRect) * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+** ===========================================================================
+** Function: IssueBltCommand()
+** Description: Sends one (possibly merged) queued command to the output
+** Input:
+**		ptCommand: Command to send
+** Output: BLT data output on the screen
+** Return value: Status of the BLT operation
+** ===========================================================================
+*/
+static
+EFI_STATUS
+IssueBltCommand(
+	IN BLT_COMMAND *ptCommand
+)
+{
+	RECT       *ptRect = &ptCommand->tRect;
+	if (ptCommand->nMode == EfiBltVideoFill)
+		return OutputBlt(gtBatch.ptGraphicsOutput, &ptCommand->tColor, EfiBltVideoFill, 0, 0,
+			ptRect->nLeft, ptRect->nTop, WidthRect(ptRect), HeightRect(ptRect), 0);
+	return OutputBlt(gtBatch.ptGraphicsOutput, ptCommand->ptPixels, EfiBltBufferToVideo, 0, 0,
+		ptRect->nLeft, ptRect->nTop, WidthRect(ptRect), HeightRect(ptRect), ptCommand->nDelta);
+}
+
+/*
+** ===========================================================================
+** Function: FlushBltBatch()
+** Description: Optimizes and sends all queued commands, the batch stays open
+** Input: None
+** Output: Queued BLT data output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+FlushBltBatch(
+	VOID
+)
+{
+	BLT_COMMAND *ptPending;
+	UINTN      nIndex;
+	EFI_STATUS nStatus;
+	if (gtBatch.nCount == 0)
+		return EFI_SUCCESS;
+	DropOverwrittenBlts();
+	nStatus = EFI_SUCCESS;
+	ptPending = NULL;
+	for (nIndex = 0; nIndex < gtBatch.nCount; nIndex++)
+	{
+		if (gtBatch.ptCommands[nIndex].bDropped == TRUE)
+			continue;
+		if (ptPending != NULL && MergeBltCommands(ptPending, &gtBatch.ptCommands[nIndex]) == TRUE)
+			continue;
+		if (ptPending != NULL && IssueBltCommand(ptPending) != EFI_SUCCESS)
+			nStatus = EFI_LOAD_ERROR;
+		ptPending = &gtBatch.ptCommands[nIndex];
+	}
+	if (ptPending != NULL && IssueBltCommand(ptPending) != EFI_SUCCESS)
+		nStatus = EFI_LOAD_ERROR;
+	gtBatch.nCount = 0;
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: GetClipSize()
+** Description: Gets the size drawing is clipped to: the draw target bound
+** to the GOP if any, the current mode otherwise
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		pnWidth, pnHeight: Clip size
+** Output: Clip size
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+GetClipSize(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	OUT UINTN *pnWidth,
+	OUT UINTN *pnHeight
+)
+{
+	GOP_CONTEXT *ptContext;
+	if (gtTarget.ptGraphicsOutput == ptGraphicsOutput)
+	{
+		*pnWidth = gtTarget.ptSurface->nWidth;
+		*pnHeight = gtTarget.ptSurface->nHeight;
+		return;
+	}
+	ptContext = GetGopContext(ptGraphicsOutput);
+	*pnWidth = ptContext->nWidth;
+	*pnHeight = ptContext->nHeight;
+}
+
+/*
+** ===========================================================================
+** Function: ClipBltRect()
+** Description: Clips the destination of a BLT operation against the draw
+** target or the cached mode. Coordinates are taken as signed so rectangles
+** may also start left of or above the screen.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptRect: Destination rectangle, its top left corner is used
+**		nWidth, nHeight: Size of the operation
+**		ptClipped: Visible part of the destination
+**		pnSkipX, pnSkipY: Columns and rows trimmed on the left and top
+** Output: Clipped destination
+** Return value: FALSE -> Nothing visible, TRUE -> Clipped destination set
+** ===========================================================================
+*/
+static
+BOOLEAN
+ClipBltRect(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST RECT *ptRect,
+	IN UINTN nWidth,
+	IN UINTN nHeight,
+	OUT RECT *ptClipped,
+	OUT UINTN *pnSkipX,
+	OUT UINTN *pnSkipY
+)
+{
+	INTN       nLeft = (INTN)ptRect->nLeft;
+	INTN       nTop = (INTN)ptRect->nTop;
+	UINTN      nClipWidth;
+	UINTN      nClipHeight;
+	GetClipSize(ptGraphicsOutput, &nClipWidth, &nClipHeight);
+	if (nWidth == 0 || nHeight == 0 || nLeft >= (INTN)nClipWidth || nTop >= (INTN)nClipHeight ||
+		nLeft + (INTN)nWidth <= 0 || nTop + (INTN)nHeight <= 0)
+		return FALSE;
+	*pnSkipX = (nLeft < 0) ? (UINTN)(-nLeft) : 0;
+	*pnSkipY = (nTop < 0) ? (UINTN)(-nTop) : 0;
+	nLeft += (INTN)*pnSkipX;
+	nTop += (INTN)*pnSkipY;
+	nWidth = MIN(nWidth - *pnSkipX, nClipWidth - (UINTN)nLeft);
+	nHeight = MIN(nHeight - *pnSkipY, nClipHeight - (UINTN)nTop);
+	SetRect(ptClipped, (UINTN)nLeft, (UINTN)nTop, (UINTN)nLeft + nWidth - 1, (UINTN)nTop + nHeight - 1);
+	return TRUE;
+}
+
 /*
 ** ===========================================================================
 ** Function: DrawBlt()
-** Description: Outputs graphical image to screen
+** Description: Outputs graphical image to screen, only the part inside the
+** current mode is drawn
 ** Input:
 **		ptGraphicsOutput: Output protocol
 **		ptBlt: BLT pixel buffer
@@ -72,21 +867,70 @@ DrawBlt(
 	IN CONST RECT*  ptRect
 )
 {
-	UINTN      nX = ptRect->nLeft;
-	UINTN      nY = ptRect->nTop;
-	UINTN      nWidth = WidthRect(ptRect);
-	UINTN      nHeight = HeightRect(ptRect);
+	return DrawBltEx(ptGraphicsOutput, ptBlt, nMode, ptRect, NULL, 0);
+}
+
+/*
+** ===========================================================================
+** Function: DrawBltEx()
+** Description: Outputs part of a larger BLT buffer to screen (or reads the
+** screen into part of one) without copying it first. The operation covers
+** the overlap of both rectangles' sizes, clipped to the current mode.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		ptRect: Rectangle on screen
+**		ptSrcRect: Rectangle inside the BLT buffer (NULL = from 0,0)
+**		nSrcStride: BLT buffer width in pixels (0 = operation width)
+** Output: BLT data output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DrawBltEx(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN CONST RECT*  ptRect,
+	IN CONST RECT*  ptSrcRect OPTIONAL,
+	IN UINTN nSrcStride
+)
+{
+	RECT       tClipped;
+	RECT       *ptClipped = &tClipped;
+	UINTN      nWidth;
+	UINTN      nHeight;
+	UINTN      nBufX = 0;
+	UINTN      nBufY = 0;
+	UINTN      nSkipX;
+	UINTN      nSkipY;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptBlt != NULL && ptRect != NULL);
+	nWidth = WidthRect(ptRect);
+	nHeight = HeightRect(ptRect);
+	if (ptSrcRect != NULL && nMode != EfiBltVideoFill)
+	{
+		nBufX = ptSrcRect->nLeft;
+		nBufY = ptSrcRect->nTop;
+		nWidth = MIN(nWidth, WidthRect(ptSrcRect));
+		nHeight = MIN(nHeight, HeightRect(ptSrcRect));
+	}
+	ASSERT_CHECK(nSrcStride == 0 || nBufX + nWidth <= nSrcStride);
+	/* The stride must not follow the clipped width */
+	if (nSrcStride == 0)
+		nSrcStride = nWidth;
+	if (ClipBltRect(ptGraphicsOutput, ptRect, nWidth, nHeight, &tClipped, &nSkipX, &nSkipY) == FALSE)
+		return EFI_SUCCESS;
+	nBufX += nSkipX;
+	nBufY += nSkipY;
 
-	ASSERT_DEBUG_MSGONLY("Pos-> X=%d, Y=%d; Size= %d\x78%d", nX, nY, nWidth, nHeight);
+	if (gtBatch.ptGraphicsOutput == ptGraphicsOutput)
+		ASSERT_CHECK_EFISTATUS(FlushBltBatch());
 	switch (nMode) {
 	case EfiBltVideoFill:
 	case EfiBltBufferToVideo:
-		ASSERT_DEBUG_MSGONLY("BLT->Video Out");
-		ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->Blt(ptGraphicsOutput, ptBlt, nMode, 0, 0, nX, nY, nWidth, nHeight, 0));
-		break;
 	case EfiBltVideoToBltBuffer:
-		ASSERT_DEBUG_MSGONLY("Video In->BLT");
-		ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->Blt(ptGraphicsOutput, ptBlt, nMode, nX, nY, 0, 0, nWidth, nHeight, 0));
+		ASSERT_CHECK_EFISTATUS(OutputBlt(ptGraphicsOutput, ptBlt, nMode, nBufX, nBufY, tClipped.nLeft, tClipped.nTop, WidthRect(ptClipped), HeightRect(ptClipped), nSrcStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)));
 		break;
 	default:
 		ASSERT_DEBUG_MSGONLY("Unknown mode!");
@@ -95,4 +939,601 @@ DrawBlt(
 	}
 
 	return EFI_SUCCESS;
-}
\ No newline at end of file
+}
+
+/*
+** ===========================================================================
+** Function: CopyScreenRect()
+** Description: Copies a screen region to another position on screen
+** (EfiBltVideoToVideo), overlapping regions included. The copy is clipped
+** so both regions lie inside the current mode.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSrcRect: Region to copy
+**		nX, nY: Destination top left corner
+** Output: Copied region on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+CopyScreenRect(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST RECT*  ptSrcRect,
+	IN UINTN nX,
+	IN UINTN nY
+)
+{
+	UINTN      nWidth;
+	UINTN      nHeight;
+	UINTN      nClipWidth;
+	UINTN      nClipHeight;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptSrcRect != NULL);
+	GetClipSize(ptGraphicsOutput, &nClipWidth, &nClipHeight);
+	if (ptSrcRect->nLeft >= nClipWidth || ptSrcRect->nTop >= nClipHeight || nX >= nClipWidth || nY >= nClipHeight)
+		return EFI_SUCCESS;
+	nWidth = MIN(WidthRect(ptSrcRect), nClipWidth - MAX(ptSrcRect->nLeft, nX));
+	nHeight = MIN(HeightRect(ptSrcRect), nClipHeight - MAX(ptSrcRect->nTop, nY));
+	if (gtBatch.ptGraphicsOutput == ptGraphicsOutput)
+		ASSERT_CHECK_EFISTATUS(FlushBltBatch());
+	return OutputBlt(ptGraphicsOutput, NULL, EfiBltVideoToVideo, ptSrcRect->nLeft, ptSrcRect->nTop, nX, nY, nWidth, nHeight, 0);
+}
+
+/*
+** ===========================================================================
+** Function: EnableShadow()
+** Description: Redirects drawing for a GOP into a system RAM copy of the
+** current mode. Nothing reaches video memory until FlushShadow() is called.
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Allocated shadow framebuffer, initialized from the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EnableShadow(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+)
+{
+	UINTN      nWidth;
+	UINTN      nHeight;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL);
+	ASSERT_CHECK(gtShadow.ptGraphicsOutput == NULL);
+	nWidth = ptGraphicsOutput->Mode->Info->HorizontalResolution;
+	nHeight = ptGraphicsOutput->Mode->Info->VerticalResolution;
+	ASSERT_CHECK_EFISTATUS(CreateSurface(&gtShadow.tSurface, nWidth, nHeight, SURFACE_FORMAT_BGRX));
+	/* Start from what is on screen so read-backs and partial flushes stay coherent */
+	if (DeviceBlt(ptGraphicsOutput, gtShadow.tSurface.ptPixels, EfiBltVideoToBltBuffer, 0, 0, 0, 0, nWidth, nHeight, 0) != EFI_SUCCESS)
+	{
+		DestroySurface(&gtShadow.tSurface);
+		return EFI_LOAD_ERROR;
+	}
+	gtShadow.ptGraphicsOutput = ptGraphicsOutput;
+	ClearRectList(&gtShadow.tDirty);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: FlushShadow()
+** Description: Pushes the dirty regions of the shadow framebuffer to the
+** screen, one BLT per merged region
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Shadow framebuffer contents output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+FlushShadow(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+)
+{
+	RECT       *ptDirty;
+	UINTN      nIndex;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL);
+	if (gtShadow.ptGraphicsOutput != ptGraphicsOutput)
+		return EFI_SUCCESS;
+	if (gtBatch.ptGraphicsOutput == ptGraphicsOutput)
+		ASSERT_CHECK_EFISTATUS(FlushBltBatch());
+	for (nIndex = 0; nIndex < gtShadow.tDirty.nCount; nIndex++)
+	{
+		ptDirty = &gtShadow.tDirty.atRects[nIndex];
+		ASSERT_CHECK_EFISTATUS(DeviceBlt(ptGraphicsOutput, gtShadow.tSurface.ptPixels, EfiBltBufferToVideo,
+			ptDirty->nLeft, ptDirty->nTop, ptDirty->nLeft, ptDirty->nTop, WidthRect(ptDirty), HeightRect(ptDirty),
+			gtShadow.tSurface.nStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL)));
+	}
+	ClearRectList(&gtShadow.tDirty);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: DisableShadow()
+** Description: Flushes and releases the shadow framebuffer, drawing goes
+** straight to video memory again
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Freed shadow framebuffer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DisableShadow(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+)
+{
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL);
+	if (gtShadow.ptGraphicsOutput != ptGraphicsOutput)
+		return EFI_SUCCESS;
+	nStatus = FlushShadow(ptGraphicsOutput);
+	DestroySurface(&gtShadow.tSurface);
+	gtShadow.ptGraphicsOutput = NULL;
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: BeginBltBatch()
+** Description: Opens a BLT batch. Until SubmitBltBatch(), QueueBlt() only
+** records operations; buffers passed to it must stay valid and unchanged
+** until the batch is submitted. A batch left open is submitted first.
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Open batch
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+BeginBltBatch(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+)
+{
+	ASSERT_ENSURE(ptGraphicsOutput != NULL);
+	if (gtBatch.ptGraphicsOutput != NULL)
+		ASSERT_CHECK_EFISTATUS(SubmitBltBatch(gtBatch.ptGraphicsOutput));
+	if (gtBatch.ptCommands == NULL)
+	{
+		ASSERT_CHECK((gtBatch.ptCommands = AllocatePool(BLT_BATCH_INITIAL_SIZE * sizeof(BLT_COMMAND))) != NULL);
+		gtBatch.nCapacity = BLT_BATCH_INITIAL_SIZE;
+	}
+	gtBatch.nCount = 0;
+	gtBatch.ptGraphicsOutput = ptGraphicsOutput;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: QueueBlt()
+** Description: Records a BLT operation in the open batch. Single-color
+** buffers are turned into fills. Reads (EfiBltVideoToBltBuffer) flush the
+** batch and run immediately; without an open batch this is DrawBlt().
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		ptRect: Rectangle with info about position
+** Output: Queued BLT operation
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+QueueBlt(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN CONST RECT*  ptRect
+)
+{
+	BLT_COMMAND *ptCommand;
+	BLT_COMMAND *ptNewCommands;
+	RECT       tClipped;
+	RECT       *ptClipped = &tClipped;
+	UINTN      nSkipX;
+	UINTN      nSkipY;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptBlt != NULL && ptRect != NULL);
+	if (gtBatch.ptGraphicsOutput != ptGraphicsOutput || nMode == EfiBltVideoToBltBuffer)
+		return DrawBlt(ptGraphicsOutput, ptBlt, nMode, ptRect);
+	if (nMode != EfiBltVideoFill && nMode != EfiBltBufferToVideo)
+	{
+		ASSERT_DEBUG_MSGONLY("Unknown mode!");
+		return EFI_LOAD_ERROR;
+	}
+	/* Clip like DrawBltEx(), commands outside the screen are dropped */
+	if (ClipBltRect(ptGraphicsOutput, ptRect, WidthRect(ptRect), HeightRect(ptRect), &tClipped, &nSkipX, &nSkipY) == FALSE)
+		return EFI_SUCCESS;
+	if (gtBatch.nCount == gtBatch.nCapacity)
+	{
+		ASSERT_CHECK((ptNewCommands = ReallocatePool(gtBatch.nCapacity * sizeof(BLT_COMMAND), gtBatch.nCapacity * 2 * sizeof(BLT_COMMAND), gtBatch.ptCommands)) != NULL);
+		gtBatch.ptCommands = ptNewCommands;
+		gtBatch.nCapacity *= 2;
+	}
+	ptCommand = &gtBatch.ptCommands[gtBatch.nCount++];
+	ptCommand->nMode = nMode;
+	ptCommand->tColor = *ptBlt;
+	/* The source stride stays the full buffer width */
+	ptCommand->nDelta = WidthRect(ptRect) * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+	ptCommand->ptPixels = (nMode == EfiBltVideoFill) ? ptBlt : ptBlt + nSkipY * WidthRect(ptRect) + nSkipX;
+	ptCommand->bDropped = FALSE;
+	CopyRect(&ptCommand->tRect, &tClipped);
+	if (nMode == EfiBltBufferToVideo && IsUniformBlt(ptCommand->ptPixels, WidthRect(ptClipped), HeightRect(ptClipped), ptCommand->nDelta) == TRUE)
+		ptCommand->nMode = EfiBltVideoFill;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SubmitBltBatch()
+** Description: Drops overwritten operations, merges the remaining ones and
+** sends them to the output, then closes the batch
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Queued BLT data output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SubmitBltBatch(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+)
+{
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL);
+	ASSERT_CHECK(gtBatch.ptGraphicsOutput == ptGraphicsOutput);
+	nStatus = FlushBltBatch();
+	gtBatch.ptGraphicsOutput = NULL;
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: SetGopOutputPath()
+** Description: Forces the output path used for the current mode of a GOP.
+** GOP_OUTPUT_AUTO drops the cached choice and measures the paths again.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		nPath: GOP_OUTPUT_* path
+** Output: Updated output path
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SetGopOutputPath(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN UINTN nPath
+)
+{
+	GOP_CONTEXT *ptContext;
+	GOP_TUNE_RESULT *ptResult;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && nPath <= GOP_OUTPUT_FRAMEBUFFER_STREAM);
+	ptContext = GetGopContext(ptGraphicsOutput);
+	ptResult = GetTuneResult(ptGraphicsOutput, ptContext->nModeNumber);
+	ASSERT_CHECK(ptResult != NULL);
+	if (nPath == GOP_OUTPUT_AUTO)
+		nPath = TuneOutputPath(ptContext);
+	ASSERT_CHECK(nPath < GOP_OUTPUT_FRAMEBUFFER || ptContext->pFrameBuffer != NULL);
+	ptResult->nOutputPath = nPath;
+	ptContext->nOutputPath = nPath;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: InitGop()
+** Description: Caches the mode information of a GOP and tunes its output
+** path, so the first draw does not pay for it
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Cached GOP state
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+InitGop(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+)
+{
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptGraphicsOutput->Mode != NULL && ptGraphicsOutput->Mode->Info != NULL);
+	GetGopContext(ptGraphicsOutput);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetGopMode()
+** Description: Switches a GOP to another mode and refreshes the cached mode
+** information (and the shadow framebuffer, if enabled)
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		nModeNumber: Mode to set
+** Output: New mode
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SetGopMode(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN UINT32 nModeNumber
+)
+{
+	BOOLEAN    bShadow;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL);
+	bShadow = (BOOLEAN)(gtShadow.ptGraphicsOutput == ptGraphicsOutput);
+	if (bShadow)
+		ASSERT_CHECK_EFISTATUS(DisableShadow(ptGraphicsOutput));
+	if (gtBatch.ptGraphicsOutput == ptGraphicsOutput)
+		ASSERT_CHECK_EFISTATUS(FlushBltBatch());
+	ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->SetMode(ptGraphicsOutput, nModeNumber));
+	GetGopContext(ptGraphicsOutput);
+	if (bShadow)
+		ASSERT_CHECK_EFISTATUS(EnableShadow(ptGraphicsOutput));
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetDrawTarget()
+** Description: Binds an off-screen surface to a GOP. Until it is unbound,
+** everything drawn to that GOP (DrawBlt(), batches, images, effects) goes to
+** the surface and is clipped to it, so a frame can be composed in RAM and
+** output once with PresentSurface().
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface to draw into, NULL = draw to the GOP again
+** Output: Bound draw target
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SetDrawTarget(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN SURFACE *ptSurface OPTIONAL
+)
+{
+	ASSERT_ENSURE(ptGraphicsOutput != NULL);
+	ASSERT_ENSURE(ptSurface == NULL || ptSurface->ptPixels != NULL);
+	/* Queued operations belong to the previous target */
+	if (gtBatch.ptGraphicsOutput == ptGraphicsOutput)
+		ASSERT_CHECK_EFISTATUS(FlushBltBatch());
+	if (ptSurface == NULL)
+	{
+		if (gtTarget.ptGraphicsOutput == ptGraphicsOutput)
+		{
+			gtTarget.ptGraphicsOutput = NULL;
+			gtTarget.ptSurface = NULL;
+		}
+		return EFI_SUCCESS;
+	}
+	gtTarget.ptGraphicsOutput = ptGraphicsOutput;
+	gtTarget.ptSurface = ptSurface;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: GetElapsedTicks()
+** Description: Computes the distance between two performance counter values,
+** whichever direction the counter runs and across a single wrap
+** Input:
+**		nFrom: Earlier counter value
+**		nTo: Later counter value
+** Output: None
+** Return value: Elapsed counter ticks
+** ===========================================================================
+*/
+UINT64
+EFIAPI
+GetElapsedTicks(
+	IN UINT64 nFrom,
+	IN UINT64 nTo
+)
+{
+	UINT64     nStartValue;
+	UINT64     nEndValue;
+	GetPerformanceCounterProperties(&nStartValue, &nEndValue);
+	if (nEndValue >= nStartValue)
+		return (nTo >= nFrom) ? (nTo - nFrom) : ((nEndValue - nFrom) + (nTo - nStartValue));
+	return (nFrom >= nTo) ? (nFrom - nTo) : ((nFrom - nEndValue) + (nStartValue - nTo));
+}
+
+/*
+** ===========================================================================
+** Function: GetFrameClockMicroseconds()
+** Description: Measures the time since a frame clock started
+** Input:
+**		ptClock: Frame clock
+** Output: None
+** Return value: Elapsed microseconds
+** ===========================================================================
+*/
+static
+UINT64
+GetFrameClockMicroseconds(
+	IN CONST FRAME_CLOCK *ptClock
+)
+{
+	return DivU64x32(GetTimeInNanoSecond(GetElapsedTicks(ptClock->nStart, GetPerformanceCounter())), 1000);
+}
+
+/*
+** ===========================================================================
+** Function: StartFrameClock()
+** Description: Starts pacing the frames of an animation of fixed duration.
+** Frames are due on the ticks of a periodic timer event; the clock itself
+** is the performance counter, so an animation that falls behind skips
+** frames instead of running longer.
+** Input:
+**		ptClock: Frame clock to start
+**		nFrameRate: Frames per second, 0 = FRAME_RATE_DEFAULT
+**		nDurationMs: Animation duration in milliseconds
+** Output: Running frame clock
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StartFrameClock(
+	OUT FRAME_CLOCK *ptClock,
+	IN UINT32 nFrameRate,
+	IN UINT32 nDurationMs
+)
+{
+	ASSERT_ENSURE(ptClock != NULL);
+	ptClock->nPeriodUs = 1000000 / ((nFrameRate != 0) ? nFrameRate : FRAME_RATE_DEFAULT);
+	ptClock->nDurationUs = MultU64x32(nDurationMs, 1000);
+	/* Timer periods are in 100ns units. Without a timer event (e.g. above
+	TPL_APPLICATION) the clock falls back to stalling between frames. */
+	ptClock->tTimer = NULL;
+	if (gBS->CreateEvent(EVT_TIMER, TPL_CALLBACK, NULL, NULL, &ptClock->tTimer) != EFI_SUCCESS)
+		ptClock->tTimer = NULL;
+	else if (gBS->SetTimer(ptClock->tTimer, TimerPeriodic, MultU64x32(ptClock->nPeriodUs, 10)) != EFI_SUCCESS)
+	{
+		gBS->CloseEvent(ptClock->tTimer);
+		ptClock->tTimer = NULL;
+	}
+	ptClock->nStart = GetPerformanceCounter();
+	ptClock->nFrameUs = 0;
+	ptClock->nDrawUs = 0;
+	ptClock->bDrawn = TRUE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: WaitFrameClock()
+** Description: Waits until the next frame is due. A tick that passed while
+** the previous frame was drawn returns at once. The last frame is due early
+** by the draw time given to MarkFrameClockDrawn(), so that it is on the screen
+** when the duration ends.
+** Input:
+**		ptClock: Frame clock
+** Output: None
+** Return value: Microseconds since the start, at most the duration
+** ===========================================================================
+*/
+UINT64
+EFIAPI
+WaitFrameClock(
+	IN FRAME_CLOCK *ptClock
+)
+{
+	UINT64     nElapsed = GetFrameClockMicroseconds(ptClock);
+	UINT64     nRemaining;
+	UINTN      nIndex;
+	ptClock->bDrawn = FALSE;
+	if (nElapsed + ptClock->nDrawUs >= ptClock->nDurationUs)
+		return ptClock->nFrameUs = ptClock->nDurationUs;
+	nRemaining = ptClock->nDurationUs - ptClock->nDrawUs - nElapsed;
+	if (nRemaining <= ptClock->nPeriodUs)
+	{
+		/* Last frame: wait for its own time rather than the next tick. A
+		tick that passed while drawing is still signaled and SetTimer() does
+		not clear it, so stop the ticks and drain it first. */
+		if (ptClock->tTimer != NULL)
+		{
+			gBS->SetTimer(ptClock->tTimer, TimerCancel, 0);
+			gBS->CheckEvent(ptClock->tTimer);
+		}
+		if (ptClock->tTimer == NULL || gBS->SetTimer(ptClock->tTimer, TimerRelative, MultU64x32(nRemaining, 10)) != EFI_SUCCESS || gBS->WaitForEvent(1, &ptClock->tTimer, &nIndex) != EFI_SUCCESS)
+		{
+			nElapsed = GetFrameClockMicroseconds(ptClock);
+			if (nElapsed + ptClock->nDrawUs < ptClock->nDurationUs)
+				gBS->Stall((UINTN)(ptClock->nDurationUs - ptClock->nDrawUs - nElapsed));
+		}
+		return ptClock->nFrameUs = ptClock->nDurationUs;
+	}
+	if (ptClock->tTimer == NULL || gBS->WaitForEvent(1, &ptClock->tTimer, &nIndex) != EFI_SUCCESS)
+		gBS->Stall((UINTN)(ptClock->nPeriodUs - ModU64x32(nElapsed, (UINT32)ptClock->nPeriodUs)));
+	ptClock->nFrameUs = GetFrameClockMicroseconds(ptClock);
+	return MIN(ptClock->nFrameUs, ptClock->nDurationUs);
+}
+
+/*
+** ===========================================================================
+** Function: PollFrameClock()
+** Description: Checks without waiting whether the next frame is due, for
+** callers that advance an animation from their own loop or a timer callback
+** Input:
+**		ptClock: Frame clock
+**		pnElapsed: Microseconds since the start, at most the duration (set
+**		when a frame is due)
+** Output: Elapsed time
+** Return value: TRUE -> A frame is due, FALSE -> Not yet
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+PollFrameClock(
+	IN FRAME_CLOCK *ptClock,
+	OUT UINT64 *pnElapsed
+)
+{
+	UINT64     nElapsed = GetFrameClockMicroseconds(ptClock);
+	BOOLEAN    bDue;
+	if (nElapsed + ptClock->nDrawUs >= ptClock->nDurationUs)
+	{
+		/* Last frame, due as in WaitFrameClock() */
+		nElapsed = ptClock->nDurationUs;
+		bDue = TRUE;
+	}
+	else if (ptClock->tTimer != NULL)
+		bDue = (BOOLEAN)(gBS->CheckEvent(ptClock->tTimer) == EFI_SUCCESS);
+	else
+		bDue = (BOOLEAN)(DivU64x32(nElapsed, (UINT32)ptClock->nPeriodUs) != DivU64x32(ptClock->nFrameUs, (UINT32)ptClock->nPeriodUs));
+	if (bDue == FALSE)
+		return FALSE;
+	ptClock->nFrameUs = nElapsed;
+	ptClock->bDrawn = FALSE;
+	*pnElapsed = nElapsed;
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: MarkFrameClockDrawn()
+** Description: Records that the frame last due is on the screen, to be
+** called right after outputting it. The time it took to draw moves the
+** last frame earlier in WaitFrameClock() and PollFrameClock(); only the
+** first call after a frame was due counts.
+** Input:
+**		ptClock: Frame clock
+** Output: Draw time of the last frame
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+MarkFrameClockDrawn(
+	IN OUT FRAME_CLOCK *ptClock
+)
+{
+	UINT64     nElapsed;
+	if (ptClock->bDrawn == TRUE)
+		return;
+	nElapsed = GetFrameClockMicroseconds(ptClock);
+	ptClock->nDrawUs = nElapsed - MIN(ptClock->nFrameUs, nElapsed);
+	ptClock->bDrawn = TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: StopFrameClock()
+** Description: Stops a frame clock and closes its timer event
+** Input:
+**		ptClock: Frame clock, started or zeroed
+** Output: Stopped frame clock
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+StopFrameClock(
+	IN OUT FRAME_CLOCK *ptClock
+)
+{
+	if (ptClock == NULL || ptClock->tTimer == NULL)
+		return;
+	gBS->SetTimer(ptClock->tTimer, TimerCancel, 0);
+	gBS->CloseEvent(ptClock->tTimer);
+	ptClock->tTimer = NULL;
+}
@@ -20,6 +20,9 @@ extern "C" {
 #ifndef _GRAPHICS_RECTANGLE_H_
 #include "Rectangle.h"
 #endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
 
 /*
 **----------------------------------------------------------------------------
@@ -39,6 +42,28 @@ enum
 	FRONT_STYLE_RIGHT_CENTER,
 	FRONT_STYLE_RIGHT_BOTTOM
 };
+/* Ways of getting pixels to the display, picked per GOP mode on first use */
+enum
+{
+	GOP_OUTPUT_AUTO,				/* Measure and pick the fastest */
+	GOP_OUTPUT_BLT,					/* One Blt() per rectangle */
+	GOP_OUTPUT_BLT_ROWS,			/* One Blt() per row */
+	GOP_OUTPUT_FRAMEBUFFER,			/* Direct framebuffer writes */
+	GOP_OUTPUT_FRAMEBUFFER_STREAM	/* Direct framebuffer, non-temporal stores for large rows */
+};
+
+#define FRAME_RATE_DEFAULT	60	/* Frames per second */
+
+/* Paces animation frames with a periodic timer event, see StartFrameClock() */
+typedef struct {
+	EFI_EVENT						tTimer;			/* NULL = Stall() between frames */
+	UINT64							nStart;			/* Performance counter value at the start */
+	UINT64							nPeriodUs;
+	UINT64							nDurationUs;
+	UINT64							nFrameUs;		/* When the last frame was due */
+	UINT64							nDrawUs;		/* Time the last frame took to draw */
+	BOOLEAN							bDrawn;			/* nDrawUs measured, see MarkFrameClockDrawn() */
+} FRAME_CLOCK;
 
 /*
 **---------------------------------------------------------------------------
@@ -55,7 +80,8 @@ enum
 /*
 ** ===========================================================================
 ** Function: DrawBlt()
-** Description: Outputs graphical image to screen
+** Description: Outputs graphical image to screen, only the part inside the
+** current mode is drawn
 ** Input:
 **		ptGraphicsOutput: Output protocol
 **		ptBlt: BLT pixel buffer
@@ -70,7 +96,348 @@ DrawBlt(
 	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
 	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
 	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
-	IN RECT*  ptRect
+	IN CONST RECT*  ptRect
+);
+
+/*
+** ===========================================================================
+** Function: DrawBltEx()
+** Description: Outputs part of a larger BLT buffer to screen (or reads the
+** screen into part of one) without copying it first. The operation covers
+** the overlap of both rectangles' sizes, clipped to the current mode.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		ptRect: Rectangle on screen
+**		ptSrcRect: Rectangle inside the BLT buffer (NULL = from 0,0)
+**		nSrcStride: BLT buffer width in pixels (0 = operation width)
+** Output: BLT data output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DrawBltEx(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN CONST RECT*  ptRect,
+	IN CONST RECT*  ptSrcRect OPTIONAL,
+	IN UINTN nSrcStride
+);
+
+/*
+** ===========================================================================
+** Function: CopyScreenRect()
+** Description: Copies a screen region to another position on screen
+** (EfiBltVideoToVideo), overlapping regions included. The copy is clipped
+** so both regions lie inside the current mode.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSrcRect: Region to copy
+**		nX, nY: Destination top left corner
+** Output: Copied region on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+CopyScreenRect(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST RECT*  ptSrcRect,
+	IN UINTN nX,
+	IN UINTN nY
+);
+
+/*
+** ===========================================================================
+** Function: EnableShadow()
+** Description: Redirects drawing for a GOP into a system RAM copy of the
+** current mode. Nothing reaches video memory until FlushShadow() is called.
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Allocated shadow framebuffer, initialized from the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EnableShadow(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+);
+
+/*
+** ===========================================================================
+** Function: FlushShadow()
+** Description: Pushes the dirty regions of the shadow framebuffer to the
+** screen, one BLT per merged region
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Shadow framebuffer contents output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+FlushShadow(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+);
+
+/*
+** ===========================================================================
+** Function: DisableShadow()
+** Description: Flushes and releases the shadow framebuffer, drawing goes
+** straight to video memory again
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Freed shadow framebuffer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DisableShadow(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+);
+
+/*
+** ===========================================================================
+** Function: BeginBltBatch()
+** Description: Opens a BLT batch. Until SubmitBltBatch(), QueueBlt() only
+** records operations; buffers passed to it must stay valid and unchanged
+** until the batch is submitted. A batch left open is submitted first.
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Open batch
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+BeginBltBatch(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+);
+
+/*
+** ===========================================================================
+** Function: QueueBlt()
+** Description: Records a BLT operation in the open batch. Single-color
+** buffers are turned into fills. Reads (EfiBltVideoToBltBuffer) flush the
+** batch and run immediately; without an open batch this is DrawBlt().
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		nMode: BLT opmode
+**		ptRect: Rectangle with info about position
+** Output: Queued BLT operation
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+QueueBlt(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN CONST RECT*  ptRect
+);
+
+/*
+** ===========================================================================
+** Function: SubmitBltBatch()
+** Description: Drops overwritten operations, merges the remaining ones and
+** sends them to the output, then closes the batch
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Queued BLT data output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SubmitBltBatch(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+);
+
+/*
+** ===========================================================================
+** Function: SetGopOutputPath()
+** Description: Forces the output path used for the current mode of a GOP.
+** GOP_OUTPUT_AUTO drops the cached choice and measures the paths again.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		nPath: GOP_OUTPUT_* path
+** Output: Updated output path
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SetGopOutputPath(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN UINTN nPath
+);
+
+/*
+** ===========================================================================
+** Function: InitGop()
+** Description: Caches the mode information of a GOP and tunes its output
+** path, so the first draw does not pay for it
+** Input:
+**		ptGraphicsOutput: Output protocol
+** Output: Cached GOP state
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+InitGop(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput
+);
+
+/*
+** ===========================================================================
+** Function: SetGopMode()
+** Description: Switches a GOP to another mode and refreshes the cached mode
+** information (and the shadow framebuffer, if enabled)
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		nModeNumber: Mode to set
+** Output: New mode
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SetGopMode(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN UINT32 nModeNumber
+);
+
+/*
+** ===========================================================================
+** Function: SetDrawTarget()
+** Description: Binds an off-screen surface to a GOP. Until it is unbound,
+** everything drawn to that GOP (DrawBlt(), batches, images, effects) goes to
+** the surface and is clipped to it, so a frame can be composed in RAM and
+** output once with PresentSurface().
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface to draw into, NULL = draw to the GOP again
+** Output: Bound draw target
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+SetDrawTarget(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN SURFACE *ptSurface OPTIONAL
+);
+
+/*
+** ===========================================================================
+** Function: GetElapsedTicks()
+** Description: Computes the distance between two performance counter values,
+** whichever direction the counter runs and across a single wrap
+** Input:
+**		nFrom: Earlier counter value
+**		nTo: Later counter value
+** Output: None
+** Return value: Elapsed counter ticks
+** ===========================================================================
+*/
+UINT64
+EFIAPI
+GetElapsedTicks(
+	IN UINT64 nFrom,
+	IN UINT64 nTo
+);
+
+/*
+** ===========================================================================
+** Function: StartFrameClock()
+** Description: Starts pacing the frames of an animation of fixed duration.
+** Frames are due on the ticks of a periodic timer event; the clock itself
+** is the performance counter, so an animation that falls behind skips
+** frames instead of running longer.
+** Input:
+**		ptClock: Frame clock to start
+**		nFrameRate: Frames per second, 0 = FRAME_RATE_DEFAULT
+**		nDurationMs: Animation duration in milliseconds
+** Output: Running frame clock
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StartFrameClock(
+	OUT FRAME_CLOCK *ptClock,
+	IN UINT32 nFrameRate,
+	IN UINT32 nDurationMs
+);
+
+/*
+** ===========================================================================
+** Function: WaitFrameClock()
+** Description: Waits until the next frame is due. A tick that passed while
+** the previous frame was drawn returns at once. The last frame is due early
+** by the draw time given to MarkFrameClockDrawn(), so that it is on the screen
+** when the duration ends.
+** Input:
+**		ptClock: Frame clock
+** Output: None
+** Return value: Microseconds since the start, at most the duration
+** ===========================================================================
+*/
+UINT64
+EFIAPI
+WaitFrameClock(
+	IN FRAME_CLOCK *ptClock
+);
+
+/*
+** ===========================================================================
+** Function: PollFrameClock()
+** Description: Checks without waiting whether the next frame is due, for
+** callers that advance an animation from their own loop or a timer callback
+** Input:
+**		ptClock: Frame clock
+**		pnElapsed: Microseconds since the start, at most the duration (set
+**		when a frame is due)
+** Output: Elapsed time
+** Return value: TRUE -> A frame is due, FALSE -> Not yet
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+PollFrameClock(
+	IN FRAME_CLOCK *ptClock,
+	OUT UINT64 *pnElapsed
+);
+
+/*
+** ===========================================================================
+** Function: MarkFrameClockDrawn()
+** Description: Records that the frame last due is on the screen, to be
+** called right after outputting it. The time it took to draw moves the
+** last frame earlier in WaitFrameClock() and PollFrameClock(); only the
+** first call after a frame was due counts.
+** Input:
+**		ptClock: Frame clock
+** Output: Draw time of the last frame
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+MarkFrameClockDrawn(
+	IN OUT FRAME_CLOCK *ptClock
+);
+
+/*
+** ===========================================================================
+** Function: StopFrameClock()
+** Description: Stops a frame clock and closes its timer event
+** Input:
+**		ptClock: Frame clock, started or zeroed
+** Output: Stopped frame clock
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+StopFrameClock(
+	IN OUT FRAME_CLOCK *ptClock
 );
 
 #ifdef __cplusplus
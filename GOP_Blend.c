@@ -0,0 +1,212 @@
+/*
+** ===========================================================================
+** File: GOP_Blend.c
+** Description: UEFI graphics-related code module (alpha compositing)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Surface.h"
+#include "GOP_Blend.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define BLEND_STRIP_ROWS	16	/* Rows read back, blended and written per BLT */
+
+enum
+{
+	ALPHA_CLEAR,	/* Every pixel fully transparent */
+	ALPHA_OPAQUE,	/* Every pixel fully opaque */
+	ALPHA_MIXED
+};
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: GetAlphaCoverage()
+** Description: Classifies the alpha of a block of pixels, stopping at the
+** first pixel that makes it mixed
+** Input:
+**		ptPixels: First pixel
+**		nStride: Pixels per row
+**		nWidth, nHeight: Block size
+** Output: None
+** Return value: ALPHA_CLEAR, ALPHA_OPAQUE or ALPHA_MIXED
+** ===========================================================================
+*/
+static
+UINTN
+GetAlphaCoverage(
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptPixels,
+	IN UINTN nStride,
+	IN UINTN nWidth,
+	IN UINTN nHeight
+)
+{
+	UINT8      nFirst = ptPixels->Reserved;
+	UINTN      nRow;
+	UINTN      nCol;
+	if (nFirst != 0 && nFirst != 0xFF)
+		return ALPHA_MIXED;
+	for (nRow = 0; nRow < nHeight; nRow++, ptPixels += nStride)
+	{
+		for (nCol = 0; nCol < nWidth; nCol++)
+		{
+			if (ptPixels[nCol].Reserved != nFirst)
+				return ALPHA_MIXED;
+		}
+	}
+	return (nFirst == 0) ? ALPHA_CLEAR : ALPHA_OPAQUE;
+}
+
+/*
+** ===========================================================================
+** Function: DrawBltAlpha()
+** Description: Composites premultiplied BGRA pixels over what is on screen
+** (or in the shadow framebuffer/draw target). Strips that are fully
+** transparent are skipped, fully opaque ones are output without reading
+** back, the rest is read back, blended and written in one BLT per strip.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: Premultiplied BGRA pixel buffer
+**		ptRect: Destination rectangle on screen
+**		ptSrcRect: Area of the BLT buffer, NULL = starts at (0, 0)
+**		nSrcStride: BLT buffer pixels per row (0 = width of the operation)
+** Output: Composited image on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBltAlpha(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN CONST RECT                                *ptRect,
+	IN CONST RECT                                *ptSrcRect OPTIONAL,
+	IN       UINTN                               nSrcStride
+)
+{
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptStrip;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptSrc;
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	RECT       tStrip;
+	RECT       tSrcStrip;
+	UINTN      nBufX = 0;
+	UINTN      nBufY = 0;
+	UINTN      nWidth;
+	UINTN      nHeight;
+	UINTN      nRow;
+	UINTN      nRows;
+	UINTN      nIndex;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptBlt != NULL && ptRect != NULL);
+	nWidth = WidthRect(ptRect);
+	nHeight = HeightRect(ptRect);
+	if (ptSrcRect != NULL)
+	{
+		nBufX = ptSrcRect->nLeft;
+		nBufY = ptSrcRect->nTop;
+		nWidth = MIN(nWidth, WidthRect(ptSrcRect));
+		nHeight = MIN(nHeight, HeightRect(ptSrcRect));
+	}
+	if (nSrcStride == 0)
+		nSrcStride = nWidth;
+	ASSERT_CHECK(nBufX + nWidth <= nSrcStride);
+	ASSERT_CHECK((ptStrip = AllocatePool(nWidth * BLEND_STRIP_ROWS * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL))) != NULL);
+	for (nRow = 0; nRow < nHeight && nStatus == EFI_SUCCESS; nRow += nRows)
+	{
+		nRows = MIN(BLEND_STRIP_ROWS, nHeight - nRow);
+		ptSrc = ptBlt + (nBufY + nRow) * nSrcStride + nBufX;
+		SetRect(&tStrip, ptRect->nLeft, ptRect->nTop + nRow, ptRect->nLeft + nWidth - 1, ptRect->nTop + nRow + nRows - 1);
+		switch (GetAlphaCoverage(ptSrc, nSrcStride, nWidth, nRows)) {
+		case ALPHA_CLEAR:
+			break;
+		case ALPHA_OPAQUE:
+			SetRect(&tSrcStrip, nBufX, nBufY + nRow, nBufX + nWidth - 1, nBufY + nRow + nRows - 1);
+			nStatus = DrawBltEx(ptGraphicsOutput, ptBlt, EfiBltBufferToVideo, &tStrip, &tSrcStrip, nSrcStride);
+			break;
+		default:
+			/* Off-screen parts of the strip are not read back, but they are
+			not written back either since DrawBltEx() clips both ways */
+			nStatus = DrawBltEx(ptGraphicsOutput, ptStrip, EfiBltVideoToBltBuffer, &tStrip, NULL, nWidth);
+			if (nStatus != EFI_SUCCESS)
+				break;
+			for (nIndex = 0; nIndex < nRows; nIndex++)
+				BlendPixelRow((UINT32 *)(ptStrip + nIndex * nWidth), (CONST UINT32 *)(ptSrc + nIndex * nSrcStride), nWidth);
+			nStatus = DrawBltEx(ptGraphicsOutput, ptStrip, EfiBltBufferToVideo, &tStrip, NULL, nWidth);
+			break;
+		}
+	}
+	FreePool(ptStrip);
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: DrawSurfaceAlpha()
+** Description: Outputs a surface, compositing it over the screen when it
+** has alpha (SURFACE_FORMAT_BGRA) and copying it otherwise
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface
+**		ptRect: Destination rectangle, the surface's top left corner is drawn
+**		at its top left corner
+** Output: Surface output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSurfaceAlpha(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptSurface,
+	IN CONST RECT                                *ptRect
+)
+{
+	RECT       tSrcRect;
+	ASSERT_ENSURE(ptSurface != NULL && ptSurface->ptPixels != NULL);
+	if (ptSurface->nFormat != SURFACE_FORMAT_BGRA)
+		return PresentSurface(ptGraphicsOutput, ptSurface, ptRect);
+	SetRect(&tSrcRect, 0, 0, ptSurface->nWidth - 1, ptSurface->nHeight - 1);
+	return DrawBltAlpha(ptGraphicsOutput, ptSurface->ptPixels, ptRect, &tSrcRect, ptSurface->nStride);
+}
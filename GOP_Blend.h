@@ -0,0 +1,95 @@
+/*
+** ===========================================================================
+** File: GOP_Blend.h
+** Description: UEFI graphics-related code module (alpha compositing)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_BLEND_H_
+#define _GRAPHICS_GOP_BLEND_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: DrawBltAlpha()
+** Description: Composites premultiplied BGRA pixels over what is on screen
+** (or in the shadow framebuffer/draw target). Strips that are fully
+** transparent are skipped, fully opaque ones are output without reading
+** back, the rest is read back, blended and written in one BLT per strip.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: Premultiplied BGRA pixel buffer
+**		ptRect: Destination rectangle on screen
+**		ptSrcRect: Area of the BLT buffer, NULL = starts at (0, 0)
+**		nSrcStride: BLT buffer pixels per row (0 = width of the operation)
+** Output: Composited image on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBltAlpha(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN CONST RECT                                *ptRect,
+	IN CONST RECT                                *ptSrcRect OPTIONAL,
+	IN       UINTN                               nSrcStride
+);
+
+/*
+** ===========================================================================
+** Function: DrawSurfaceAlpha()
+** Description: Outputs a surface, compositing it over the screen when it
+** has alpha (SURFACE_FORMAT_BGRA) and copying it otherwise
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface
+**		ptRect: Destination rectangle, the surface's top left corner is drawn
+**		at its top left corner
+** Output: Surface output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSurfaceAlpha(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptSurface,
+	IN CONST RECT                                *ptRect
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_BLEND_H_ */
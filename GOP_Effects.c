@@ -36,12 +36,16 @@
 #include "UefiDebug.h"
 #include "Rectangle.h"
 #include "GOP.h"
+#include "GOP_Raster.h"
+#include "GOP_Pixel.h"
+#include "GOP_Transition.h"
+#include "GOP_Effects.h"
 
 /*
 ** ===========================================================================
 ** Function: GopEffects_BresenhamDrawLine()
-** Description: Outputs a line on the screen using Bresenham's line drawing
-** style.
+** Description: Outputs a line of the image on the screen using Bresenham's
+** line drawing style, one BLT per run of pixels on a row.
 ** Input:
 **		ptGraphicsOutput: Output protocol
 **		ptGopBlt: BLT pixel buffer
@@ -70,76 +74,158 @@ GopEffects_BresenhamDrawLine(
 	IN UINTN nImgY2
 )
 {
-	INT16 nD;
-	INT16 nDx;
-	INT16 nDy;
-	INT16 nDx2;
-	INT16 nDy2;
-	INT16 nDxy;
-	INT16 nXinc;
-	INT16 nYinc;
-	INT16 nX1;
-	INT16 nX2;
-	INT16 nY1;
-	INT16 nY2;
-	ASSERT_ENSURE(ptGraphicsOutput != NULL || ptGopBlt != NULL | nWidth != 0 || nHeight != 0);
-	nX1 = (INT16)(nImgX1);
-	nY1 = (INT16)(nImgY1);
-	nX2 = (INT16)(nImgX2);
-	nY2 = (INT16)(nImgY2);
-	if (nX2 > nX1)
-		nDx = nX2 - nX1;
-	else
-		nDx = nX1 - nX2;
-	if (nY2 > nY1)
-		nDy = nY2 - nY1;
-	else
-		nDy = nY1 - nY2;
-	if (nX2 > nX1)
-		nXinc = 1;
-	else
-		nXinc = (nX2 == nX1) ? 0 : (-1);
-	if (nY2 > nY1)
-		nYinc = 1;
-	else
-		nYinc = (nY2 == nY1) ? 0 : (-1);
-	nDx2 = (INT16)(nDx << 1);
-	nDy2 = (INT16)(nDy << 1);
-	ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->Blt(ptGraphicsOutput, &ptGopBlt[nY * nWidth + nX], EfiBltVideoFill, 0, 0, nX + nX1, nY + nY1, 1, 1, 0));
-	if (nDx >= nDy) {
-		nD = nDy2 - nDx;
-		nDxy = nDy2 - nDx2;
-		while (nDx--) {
-			if (nD <= 0)nD += nDy2;
-			else {
-				nD += nDxy;
-				nY1 += nYinc;
-			}
-			nX1 += nXinc;
-			ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->Blt(ptGraphicsOutput, &ptGopBlt[nY1 * nWidth + nX1], EfiBltVideoFill, 0, 0, nX + nX1, nY + nY1, 1, 1, 0));
-		}
-	}
-	else {
-		nD = nDx2 - nDy;
-		nDxy = nDx2 - nDy2;
-		while (nDy--) {
-			if (nD <= 0)nD += nDx2;
-			else {
-				nD += nDxy;
-				nX1 += nXinc;
-			}
-			nY1 += nYinc;
-			ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->Blt(ptGraphicsOutput, &ptGopBlt[nY1* nWidth + nX1], EfiBltVideoFill, 0, 0, nX + nX1, nY + nY1, 1, 1, 0));
-		}
-	}
+	RASTER tRaster;
+	RECT   tArea;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptGopBlt != NULL && nWidth != 0 && nHeight != 0);
+	SetRect(&tArea, nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+	ASSERT_CHECK_EFISTATUS(InitRaster(&tRaster, ptGraphicsOutput, ptGopBlt));
+	ASSERT_CHECK_EFISTATUS(SetRasterSource(&tRaster, ptGopBlt, nWidth, &tArea));
+	ASSERT_CHECK_EFISTATUS(RasterLine(&tRaster, (INT32)nImgX1, (INT32)nImgY1, (INT32)nImgX2, (INT32)nImgY2));
+	ASSERT_CHECK_EFISTATUS(FlushRaster(&tRaster));
+	FlushShadow(ptGraphicsOutput);
 	gBS->Stall(2500); /* 2.5ms pause */
 	return EFI_SUCCESS;
 }
 
+/*
+** ===========================================================================
+** Function: InitEffect_ImageFade()
+** Description: Prepares the fade of DrawBlt_ImageFadeEx() as a transition,
+** to be run with StartTransition()/StepTransition() without blocking
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bReverse: TRUE = fade out
+**		ptRect: Rectangle with info about position
+**		nSteps: Number of steps, 0 = time based
+**		nDurationMs: Total fade time in milliseconds
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageFade(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bReverse,
+	IN RECT*  ptRect,
+	IN UINTN nSteps,
+	IN UINT32 nDurationMs
+)
+{
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptBlt != NULL && ptRect != NULL);
+	ASSERT_CHECK_EFISTATUS(InitTransition(ptEffect, ptGraphicsOutput, &gtTransitionFade, NULL, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)ptBlt, ptRect));
+	SetTransitionTiming(ptEffect, nSteps, nDurationMs, TRANSITION_EASE_LINEAR);
+	return SetTransitionOptions(ptEffect, (bReverse == TRUE) ? TRANSITION_REVERSE : 0, 0);
+}
+
+/*
+** ===========================================================================
+** Function: InitEffect_ImageCrossFade()
+** Description: Prepares the cross-fade of DrawBlt_ImageCrossFade() as a
+** transition, to be run with StartTransition()/StepTransition()
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptFromBlt: BLT pixel buffer shown at the start
+**		ptToBlt: BLT pixel buffer shown at the end, same size
+**		ptRect: Rectangle with info about position
+**		nDurationMs: Total transition time in milliseconds
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageCrossFade(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptFromBlt,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptToBlt,
+	IN RECT*  ptRect,
+	IN UINT32 nDurationMs
+)
+{
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptFromBlt != NULL && ptToBlt != NULL && ptRect != NULL);
+	ASSERT_CHECK_EFISTATUS(InitTransition(ptEffect, ptGraphicsOutput, &gtTransitionFade, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)ptFromBlt, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)ptToBlt, ptRect));
+	return SetTransitionTiming(ptEffect, 0, nDurationMs, TRANSITION_EASE_LINEAR);
+}
+
+/*
+** ===========================================================================
+** Function: InitEffect_ImageClockWipe()
+** Description: Prepares the clock wipe of DrawBlt_ImageClockWipeEx() as a
+** transition, to be run with StartTransition()/StepTransition()
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bIsCounterClockwise: TRUE = counter-clockwise order
+**		ptRect: Rectangle with info about position
+**		nFrames: Number of steps
+**		nDurationMs: Total wipe time in milliseconds, 0 = as fast as possible
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageClockWipe(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bIsCounterClockwise,
+	IN CONST RECT*  ptRect,
+	IN UINTN nFrames,
+	IN UINT32 nDurationMs
+)
+{
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptBlt != NULL && ptRect != NULL && nFrames != 0);
+	ASSERT_CHECK_EFISTATUS(InitTransition(ptEffect, ptGraphicsOutput, &gtTransitionClockWipe, NULL, ptBlt, ptRect));
+	SetTransitionTiming(ptEffect, nFrames, nDurationMs, TRANSITION_EASE_LINEAR);
+	return SetTransitionOptions(ptEffect, (bIsCounterClockwise == TRUE) ? TRANSITION_REVERSE : 0, 0);
+}
+
+/*
+** ===========================================================================
+** Function: InitEffect_ImageRainFall()
+** Description: Prepares the rainfall of DrawBlt_ImageRainFallShow() as a
+** transition, to be run with StartTransition()/StepTransition()
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bIsBottomToTop: TRUE = do the effect in reverse order
+**		ptRect: Rectangle with info about position
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageRainFall(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN bIsBottomToTop,
+	IN CONST RECT*	ptRect
+)
+{
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptBlt != NULL && ptRect != NULL);
+	ASSERT_CHECK_EFISTATUS(InitTransition(ptEffect, ptGraphicsOutput, &gtTransitionRainFall, NULL, ptBlt, ptRect));
+	/* One row per step, 2.5ms each */
+	SetTransitionTiming(ptEffect, HeightRect(ptRect), (UINT32)(HeightRect(ptRect) * 5 / 2), TRANSITION_EASE_LINEAR);
+	return SetTransitionOptions(ptEffect, (bIsBottomToTop == TRUE) ? TRANSITION_REVERSE : 0, 0);
+}
+
 /*
 ** ===========================================================================
 ** Function: DrawBlt_ImageFade()
 ** Description: Outputs graphical image to screen with a fade in/out effect
+** lasting about FADE_DURATION_DEFAULT ms, see DrawBlt_ImageFadeEx()
 ** Input:
 **		ptGraphicsOutput: Output protocol
 **		ptBlt: BLT pixel buffer
@@ -158,66 +244,84 @@ DrawBlt_ImageFade(
 	IN RECT*  ptRect
 )
 {
-	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptTempBltBuffer;
-	UINT32 nBltBufferSize;
-	UINT16 nFadeLevel;
-	UINT32 nCurrPixel;
-	UINT32 nWidth;
-	UINT32 nHeight;
-	ASSERT_ENSURE(ptGraphicsOutput != NULL || ptBlt != NULL || ptRect != NULL);
-	nWidth = (UINT32)WidthRect(ptRect);
-	nHeight = (UINT32)HeightRect(ptRect);
-	nBltBufferSize = (nWidth * nHeight * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-	ASSERT_CHECK((ptTempBltBuffer = AllocateZeroPool(nBltBufferSize)) != NULL);
-	/* The original implementation had a big oopsie. Which?
-	It checks if one value the out buffer has less color value than input's.
-	A proper fade does a percentage-like operation for every color value. 
-	Same goes with fade out, but in reverse order. */
-	if (bReverse == FALSE)
-	{
-		nFadeLevel = 0;
-		while (nFadeLevel < 256)
-		{
-			nCurrPixel = 0;
-			while (nCurrPixel < (nWidth * nHeight))
-			{
-				ptTempBltBuffer[nCurrPixel].Red = (UINT8)((ptBlt[nCurrPixel].Red * nFadeLevel) / 255);
-				ptTempBltBuffer[nCurrPixel].Green = (UINT8)((ptBlt[nCurrPixel].Green * nFadeLevel) / 255);
-				ptTempBltBuffer[nCurrPixel].Blue = (UINT8)((ptBlt[nCurrPixel].Blue * nFadeLevel) / 255);
-				nCurrPixel++;
-			}
-			DrawBlt(ptGraphicsOutput, ptTempBltBuffer, EfiBltBufferToVideo, ptRect);
-			gBS->Stall(2000);
-			nFadeLevel++;
-		}
-		
-	}
-	else
-	{
-		nFadeLevel = 255;
-		while (nFadeLevel > 0)
-		{
-			nCurrPixel = 0;
-			while (nCurrPixel < (nWidth * nHeight))
-			{
-				ptTempBltBuffer[nCurrPixel].Red = (UINT8)((ptBlt[nCurrPixel].Red * nFadeLevel) / 255);
-				ptTempBltBuffer[nCurrPixel].Green = (UINT8)((ptBlt[nCurrPixel].Green * nFadeLevel) / 255);
-				ptTempBltBuffer[nCurrPixel].Blue = (UINT8)((ptBlt[nCurrPixel].Blue * nFadeLevel) / 255);
-				nCurrPixel++;
-			}
-			DrawBlt(ptGraphicsOutput, ptTempBltBuffer, EfiBltBufferToVideo, ptRect);
-			gBS->Stall(2000);
-			nFadeLevel--;
-		}
-	}
-	FreePool(ptTempBltBuffer);
-	return EFI_SUCCESS;
+	return DrawBlt_ImageFadeEx(ptGraphicsOutput, ptBlt, bReverse, ptRect, 0, FADE_DURATION_DEFAULT);
+}
+
+/*
+** ===========================================================================
+** Function: DrawBlt_ImageFadeEx()
+** Description: Outputs graphical image to screen with a fade in/out effect.
+** Each frame scales the whole image with ScalePixelRow() (no divisions) and
+** outputs it in one BLT.
+** With nSteps == 0 the brightness follows the clock, so the fade takes
+** nDurationMs however slow the output is, with as many frames as fit.
+** Otherwise the brightness moves in nSteps steps over nDurationMs, steps
+** the output cannot keep up with are skipped (nDurationMs == 0: every step
+** as fast as possible).
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bReverse: TRUE = fade out
+**		ptRect: Rectangle with info about position
+**		nSteps: Number of steps, 0 = time based
+**		nDurationMs: Total fade time in milliseconds
+** Output: BLT data output on the screen with respecive effect
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_ImageFadeEx(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bReverse,
+	IN RECT*  ptRect,
+	IN UINTN nSteps,
+	IN UINT32 nDurationMs
+)
+{
+	TRANSITION tFade;
+	ASSERT_CHECK_EFISTATUS(InitEffect_ImageFade(&tFade, ptGraphicsOutput, ptBlt, bReverse, ptRect, nSteps, nDurationMs));
+	return RunTransition(&tFade);
+}
+
+/*
+** ===========================================================================
+** Function: DrawBlt_ImageCrossFade()
+** Description: Dissolves one image into another in place. Each frame blends
+** both images with LerpPixelRow() into one scratch buffer and outputs it in
+** one BLT; the blend weight follows the clock so the transition takes
+** nDurationMs however slow the output is.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptFromBlt: BLT pixel buffer shown at the start
+**		ptToBlt: BLT pixel buffer shown at the end, same size
+**		ptRect: Rectangle with info about position
+**		nDurationMs: Total transition time in milliseconds
+** Output: BLT data output on the screen with respecive effect
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_ImageCrossFade(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptFromBlt,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptToBlt,
+	IN RECT*  ptRect,
+	IN UINT32 nDurationMs
+)
+{
+	TRANSITION tFade;
+	ASSERT_CHECK_EFISTATUS(InitEffect_ImageCrossFade(&tFade, ptGraphicsOutput, ptFromBlt, ptToBlt, ptRect, nDurationMs));
+	return RunTransition(&tFade);
 }
 
 /*
 ** ===========================================================================
 ** Function: DrawBlt_ImageClockWipe()
 ** Description: Outputs graphical image to screen with a clock wipe effect
+** in CLOCK_WIPE_FRAMES_DEFAULT frames, see DrawBlt_ImageClockWipeEx()
 ** Input:
 **		ptGraphicsOutput: Output protocol
 **		ptBlt: BLT pixel buffer
@@ -236,40 +340,43 @@ DrawBlt_ImageClockWipe(
 	IN CONST RECT*  ptRect
 )
 {
-	UINT32 Width;
-	UINT32 Height;
-	ASSERT_ENSURE(ptGraphicsOutput != NULL || ptBlt != NULL || ptRect != NULL);
-	Width = (UINT32)WidthRect(ptRect);
-	Height = (UINT32)HeightRect(ptRect);
-	INTN i;
-	if (bIsCounterClockwise == FALSE)
-	{
-		for (i = (INTN)((Width - 1) >> 1); i < (INTN)(Width - 1 - 1); i++)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, i, 0, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = 0; i < (INTN)(Height - 1 - 1); i++)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, Width - 1 - 1, i, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = (INTN)(Width - 1); i > 0; i--)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, i, Height - 1 - 1, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = (INTN)(Height - 1); i > 0; i--)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, 0, i, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = 0; i < (INTN)((Width - 1) >> 1); i++)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, i, 0, (Width - 1) >> 1, (Height - 1) >> 1);
-	}
-	else
-	{
-		for (i = (INTN)((Width - 1) >> 1); i > 0; i--)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, i, 0, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = 0; i < (INTN)(Height - 1); i++)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, 0, i, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = 0; i < (INTN)(Width - 1); i++)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, i, Height - 1 - 1, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = (INTN)(Height - 1 - 1); i > 0; i--)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, Width - 1 - 1, i, (Width - 1) >> 1, (Height - 1) >> 1);
-		for (i = (INTN)(Width - 1 - 1); i > (INTN)((Width - 1) >> 1); i--)
-			GopEffects_BresenhamDrawLine(ptGraphicsOutput, ptBlt, ptRect->nLeft, ptRect->nTop, Width, Height, i, 0, (Width - 1) >> 1, (Height - 1) >> 1);
+	return DrawBlt_ImageClockWipeEx(ptGraphicsOutput, ptBlt, bIsCounterClockwise, ptRect, CLOCK_WIPE_FRAMES_DEFAULT, CLOCK_WIPE_DURATION_DEFAULT);
+}
 
-	}
-		
+/*
+** ===========================================================================
+** Function: DrawBlt_ImageClockWipeEx()
+** Description: Outputs graphical image to screen with a clock wipe effect.
+** The clock angle of every pixel is computed once and turned into the
+** frame revealing it; the pixels are then grouped into horizontal spans
+** sorted by frame (counting sort), so each frame outputs exactly its new
+** pixels and every pixel is output once.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bIsCounterClockwise: TRUE = counter-clockwise order
+**		ptRect: Rectangle with info about position
+**		nFrames: Number of steps, frames that fall behind the clock skip
+**		steps to keep the duration
+**		nDurationMs: Total wipe time in milliseconds, 0 = as fast as possible
+** Output: BLT data output on the screen with respecive effect
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_ImageClockWipeEx(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bIsCounterClockwise,
+	IN CONST RECT*  ptRect,
+	IN UINTN nFrames,
+	IN UINT32 nDurationMs
+)
+{
+	TRANSITION tWipe;
+	ASSERT_CHECK_EFISTATUS(InitEffect_ImageClockWipe(&tWipe, ptGraphicsOutput, ptBlt, bIsCounterClockwise, ptRect, nFrames, nDurationMs));
+	return RunTransition(&tWipe);
 }
 
 /*
@@ -294,34 +401,98 @@ DrawBlt_ImageRainFallShow(
 	IN CONST RECT*	ptRect
 )
 {
-	UINT32 nCurrRow;
-	UINT32 nCurrRowToDrawTo;
-	UINT32 nWidth;
-	UINT32 nHeight;
-	ASSERT_ENSURE(ptGraphicsOutput != NULL || ptBlt != NULL || ptRect != NULL);
-	nWidth = WidthRect(ptRect);
-	nHeight =HeightRect(ptRect);
-	if (bIsBottomToTop == FALSE)
+	TRANSITION tRain;
+	ASSERT_CHECK_EFISTATUS(InitEffect_ImageRainFall(&tRain, ptGraphicsOutput, ptBlt, bIsBottomToTop, ptRect));
+	return RunTransition(&tRain);
+}
+
+/*
+** ===========================================================================
+** Function: DrawBlt_BlurRegion()
+** Description: Blurs and darkens a screen region in place (frosted
+** background behind a modal dialog). The region is read back once, box
+** filtered with sliding windows along rows and then columns for every
+** pass (three passes come close to a Gaussian), dimmed and written back
+** once. The cost per pixel does not depend on the radius.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptRect: Screen region, clipped to the mode
+**		nRadius: Box radius per pass, 0..127 (0 = dim only)
+**		nPasses: Box passes, 0 = dim only
+**		nBrightness: Brightness kept, 0..256 (256 = no dimming)
+** Output: Blurred region on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_BlurRegion(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST RECT*  ptRect,
+	IN UINTN nRadius,
+	IN UINTN nPasses,
+	IN UINT32 nBrightness
+)
+{
+	UINT32 *pnImage;
+	UINT32 *pnWork;
+	UINT16 *pnSums;
+	UINTN  nWidth;
+	UINTN  nHeight;
+	UINTN  nPass;
+	UINTN  nRow;
+	UINTN  nIndex;
+	UINT16 nScale;
+	RECT   tScreen;
+	RECT   tArea;
+	RECT   *ptArea = &tArea;
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptRect != NULL && nRadius <= 127 && nBrightness <= 256);
+	SetRect(&tScreen, 0, 0, ptGraphicsOutput->Mode->Info->HorizontalResolution - 1, ptGraphicsOutput->Mode->Info->VerticalResolution - 1);
+	if (IntersectRect(&tArea, &tScreen, ptRect) == FALSE)
+		return EFI_SUCCESS;
+	nWidth = WidthRect(ptArea);
+	nHeight = HeightRect(ptArea);
+	if (nRadius == 0)
+		nPasses = 0;
+	ASSERT_CHECK((pnImage = AllocatePool(nWidth * nHeight * sizeof(UINT32))) != NULL);
+	pnWork = AllocatePool(nWidth * nHeight * sizeof(UINT32));
+	pnSums = AllocatePool(4 * nWidth * sizeof(UINT16));
+	if (pnWork == NULL || pnSums == NULL)
 	{
-		for (nCurrRow = 0; nCurrRow <= (nHeight - 1); nCurrRow++)
-		{
-			for (nCurrRowToDrawTo = (nHeight - 1); nCurrRowToDrawTo >= nCurrRow; nCurrRowToDrawTo--)
-			{
-				ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->Blt(ptGraphicsOutput, &(ptBlt[nCurrRow*nWidth]), EfiBltBufferToVideo, 0, 0, ptRect->nLeft, ptRect->nTop + nCurrRowToDrawTo, nWidth, 1, 0));
-			}
-			gBS->Stall(2500); /* 2.5ms pause */
-		}
+		FreePool(pnImage);
+		if (pnWork != NULL)
+			FreePool(pnWork);
+		if (pnSums != NULL)
+			FreePool(pnSums);
+		return EFI_LOAD_ERROR;
 	}
-	else
+	nStatus = DrawBltEx(ptGraphicsOutput, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)pnImage, EfiBltVideoToBltBuffer, ptArea, NULL, 0);
+	nScale = (UINT16)(65536 / (2 * nRadius + 1));
+	for (nPass = 0; nPass < nPasses && nStatus == EFI_SUCCESS; nPass++)
 	{
-		for (nCurrRow = (nHeight - 1); nCurrRow >= 0; nCurrRow--) 
-		{
-			for (nCurrRowToDrawTo = 0; nCurrRowToDrawTo <= nCurrRow; nCurrRowToDrawTo++)
-			{
-				ASSERT_CHECK_EFISTATUS(ptGraphicsOutput->Blt(ptGraphicsOutput, &(ptBlt[nCurrRow*nWidth]), EfiBltBufferToVideo, 0, 0, ptRect->nLeft, ptRect->nTop + nCurrRowToDrawTo, nWidth, 1, 0));
-			}
-			gBS->Stall(2500); /* 2.5ms pause */
-		}
+		for (nRow = 0; nRow < nHeight; nRow++)
+			BoxBlurPixelRow(pnWork + nRow * nWidth, pnImage + nRow * nWidth, nWidth, nRadius, nScale);
+		/* First column window: the top row counts for the rows above it */
+		for (nIndex = 0; nIndex < 4 * nWidth; nIndex++)
+			pnSums[nIndex] = (UINT16)nRadius;
+		for (nIndex = 0; nIndex <= 2 * nRadius; nIndex++)
+			BoxBlurColumnRow(NULL, pnSums, pnWork + ((nIndex <= nRadius) ? 0 : MIN(nIndex - nRadius, nHeight - 1)) * nWidth, NULL, nWidth, nScale);
+		for (nRow = 0; nRow < nHeight; nRow++)
+			BoxBlurColumnRow(pnImage + nRow * nWidth, pnSums, pnWork + MIN(nRow + nRadius + 1, nHeight - 1) * nWidth,
+				pnWork + ((nRow >= nRadius) ? nRow - nRadius : 0) * nWidth, nWidth, nScale);
 	}
-	return EFI_SUCCESS;
-}
\ No newline at end of file
+	if (nBrightness < 256)
+	{
+		/* The work buffer is done with, its first row serves as black */
+		ZeroMem(pnWork, nWidth * sizeof(UINT32));
+		for (nRow = 0; nRow < nHeight; nRow++)
+			LerpPixelRow(pnImage + nRow * nWidth, pnImage + nRow * nWidth, pnWork, 256 - nBrightness, nWidth);
+	}
+	if (nStatus == EFI_SUCCESS)
+		nStatus = DrawBltEx(ptGraphicsOutput, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)pnImage, EfiBltBufferToVideo, ptArea, NULL, 0);
+	FreePool(pnImage);
+	FreePool(pnWork);
+	FreePool(pnSums);
+	return nStatus;
+}
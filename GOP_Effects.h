@@ -23,6 +23,9 @@ extern "C" {
 #ifndef _GRAPHICS_RECTANGLE_H_
 #include "Rectangle.h"
 #endif
+#ifndef _GRAPHICS_GOP_TRANSITION_H_
+#include "GOP_Transition.h"
+#endif
 
 /*
 **----------------------------------------------------------------------------
@@ -30,6 +33,10 @@ extern "C" {
 **----------------------------------------------------------------------------
 */
 
+#define FADE_DURATION_DEFAULT	500	/* ms, DrawBlt_ImageFade() */
+#define CLOCK_WIPE_FRAMES_DEFAULT	60	/* DrawBlt_ImageClockWipe() */
+#define CLOCK_WIPE_DURATION_DEFAULT	1000	/* ms */
+
 /*
 **---------------------------------------------------------------------------
 **  Variable Declarations
@@ -42,10 +49,121 @@ extern "C" {
 **---------------------------------------------------------------------------
 */
 
+/*
+** ===========================================================================
+** Function: InitEffect_ImageFade()
+** Description: Prepares the fade of DrawBlt_ImageFadeEx() as a transition,
+** to be run with StartTransition()/StepTransition() without blocking
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bReverse: TRUE = fade out
+**		ptRect: Rectangle with info about position
+**		nSteps: Number of steps, 0 = time based
+**		nDurationMs: Total fade time in milliseconds
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageFade(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bReverse,
+	IN RECT*  ptRect,
+	IN UINTN nSteps,
+	IN UINT32 nDurationMs
+);
+
+/*
+** ===========================================================================
+** Function: InitEffect_ImageCrossFade()
+** Description: Prepares the cross-fade of DrawBlt_ImageCrossFade() as a
+** transition, to be run with StartTransition()/StepTransition()
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptFromBlt: BLT pixel buffer shown at the start
+**		ptToBlt: BLT pixel buffer shown at the end, same size
+**		ptRect: Rectangle with info about position
+**		nDurationMs: Total transition time in milliseconds
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageCrossFade(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptFromBlt,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptToBlt,
+	IN RECT*  ptRect,
+	IN UINT32 nDurationMs
+);
+
+/*
+** ===========================================================================
+** Function: InitEffect_ImageClockWipe()
+** Description: Prepares the clock wipe of DrawBlt_ImageClockWipeEx() as a
+** transition, to be run with StartTransition()/StepTransition()
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bIsCounterClockwise: TRUE = counter-clockwise order
+**		ptRect: Rectangle with info about position
+**		nFrames: Number of steps
+**		nDurationMs: Total wipe time in milliseconds, 0 = as fast as possible
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageClockWipe(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bIsCounterClockwise,
+	IN CONST RECT*  ptRect,
+	IN UINTN nFrames,
+	IN UINT32 nDurationMs
+);
+
+/*
+** ===========================================================================
+** Function: InitEffect_ImageRainFall()
+** Description: Prepares the rainfall of DrawBlt_ImageRainFallShow() as a
+** transition, to be run with StartTransition()/StepTransition()
+** Input:
+**		ptEffect: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bIsBottomToTop: TRUE = do the effect in reverse order
+**		ptRect: Rectangle with info about position
+** Output: Transition ready to start
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitEffect_ImageRainFall(
+	OUT TRANSITION *ptEffect,
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN bIsBottomToTop,
+	IN CONST RECT*	ptRect
+);
+
 /*
 ** ===========================================================================
 ** Function: DrawBlt_ImageFade()
 ** Description: Outputs graphical image to screen with a fade in/out effect
+** lasting about FADE_DURATION_DEFAULT ms, see DrawBlt_ImageFadeEx()
 ** Input:
 **		ptGraphicsOutput: Output protocol
 **		ptBlt: BLT pixel buffer
@@ -64,10 +182,71 @@ DrawBlt_ImageFade(
 	IN RECT*  ptRect
 );
 
+/*
+** ===========================================================================
+** Function: DrawBlt_ImageFadeEx()
+** Description: Outputs graphical image to screen with a fade in/out effect.
+** Each frame scales the whole image with ScalePixelRow() (no divisions) and
+** outputs it in one BLT.
+** With nSteps == 0 the brightness follows the clock, so the fade takes
+** nDurationMs however slow the output is, with as many frames as fit.
+** Otherwise the brightness moves in nSteps steps over nDurationMs, steps
+** the output cannot keep up with are skipped (nDurationMs == 0: every step
+** as fast as possible).
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bReverse: TRUE = fade out
+**		ptRect: Rectangle with info about position
+**		nSteps: Number of steps, 0 = time based
+**		nDurationMs: Total fade time in milliseconds
+** Output: BLT data output on the screen with respecive effect
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_ImageFadeEx(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bReverse,
+	IN RECT*  ptRect,
+	IN UINTN nSteps,
+	IN UINT32 nDurationMs
+);
+
+/*
+** ===========================================================================
+** Function: DrawBlt_ImageCrossFade()
+** Description: Dissolves one image into another in place. Each frame blends
+** both images with LerpPixelRow() into one scratch buffer and outputs it in
+** one BLT; the blend weight follows the clock so the transition takes
+** nDurationMs however slow the output is.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptFromBlt: BLT pixel buffer shown at the start
+**		ptToBlt: BLT pixel buffer shown at the end, same size
+**		ptRect: Rectangle with info about position
+**		nDurationMs: Total transition time in milliseconds
+** Output: BLT data output on the screen with respecive effect
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_ImageCrossFade(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptFromBlt,
+	IN CONST	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptToBlt,
+	IN RECT*  ptRect,
+	IN UINT32 nDurationMs
+);
+
 /*
 ** ===========================================================================
 ** Function: DrawBlt_ImageClockWipe()
 ** Description: Outputs graphical image to screen with a clock wipe effect
+** in CLOCK_WIPE_FRAMES_DEFAULT frames, see DrawBlt_ImageClockWipeEx()
 ** Input:
 **		ptGraphicsOutput: Output protocol
 **		ptBlt: BLT pixel buffer
@@ -86,6 +265,37 @@ DrawBlt_ImageClockWipe(
 	IN CONST RECT*  ptRect
 );
 
+/*
+** ===========================================================================
+** Function: DrawBlt_ImageClockWipeEx()
+** Description: Outputs graphical image to screen with a clock wipe effect.
+** The clock angle of every pixel is computed once and turned into the
+** frame revealing it; the pixels are then grouped into horizontal spans
+** sorted by frame (counting sort), so each frame outputs exactly its new
+** pixels and every pixel is output once.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		bIsCounterClockwise: TRUE = counter-clockwise order
+**		ptRect: Rectangle with info about position
+**		nFrames: Number of steps, frames that fall behind the clock skip
+**		steps to keep the duration
+**		nDurationMs: Total wipe time in milliseconds, 0 = as fast as possible
+** Output: BLT data output on the screen with respecive effect
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_ImageClockWipeEx(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN BOOLEAN	bIsCounterClockwise,
+	IN CONST RECT*  ptRect,
+	IN UINTN nFrames,
+	IN UINT32 nDurationMs
+);
+
 /*
 ** ===========================================================================
 ** Function: DrawBlt_ImageRainFallShow()
@@ -108,6 +318,34 @@ DrawBlt_ImageRainFallShow(
 	IN CONST RECT*	ptRect
 );
 
+/*
+** ===========================================================================
+** Function: DrawBlt_BlurRegion()
+** Description: Blurs and darkens a screen region in place (frosted
+** background behind a modal dialog). The region is read back once, box
+** filtered with sliding windows along rows and then columns for every
+** pass (three passes come close to a Gaussian), dimmed and written back
+** once. The cost per pixel does not depend on the radius.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptRect: Screen region, clipped to the mode
+**		nRadius: Box radius per pass, 0..127 (0 = dim only)
+**		nPasses: Box passes, 0 = dim only
+**		nBrightness: Brightness kept, 0..256 (256 = no dimming)
+** Output: Blurred region on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBlt_BlurRegion(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST RECT*  ptRect,
+	IN UINTN nRadius,
+	IN UINTN nPasses,
+	IN UINT32 nBrightness
+);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -0,0 +1,691 @@
+/*
+** ===========================================================================
+** File: GOP_Layers.c
+** Description: UEFI graphics-related code module (layered compositor)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Surface.h"
+#include "GOP_Layers.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: GetLayerRect()
+** Description: Computes the on-screen area of a layer
+** Input:
+**		ptCompositor: Compositor
+**		ptLayer: Layer
+**		ptRect: Output area, clipped to the screen
+** Output: Layer area
+** Return value: FALSE -> Layer not shown, TRUE -> Layer visible
+** ===========================================================================
+*/
+static
+BOOLEAN
+GetLayerRect(
+	IN CONST COMPOSITOR *ptCompositor,
+	IN CONST LAYER *ptLayer,
+	OUT RECT *ptRect
+)
+{
+	INTN       nRight;
+	INTN       nBottom;
+	if (ptLayer->bUsed == FALSE || ptLayer->bVisible == FALSE || ptLayer->nWidth == 0 || ptLayer->nHeight == 0)
+		return FALSE;
+	nRight = MIN(ptLayer->nX + (INTN)ptLayer->nWidth - 1, (INTN)ptCompositor->nWidth - 1);
+	nBottom = MIN(ptLayer->nY + (INTN)ptLayer->nHeight - 1, (INTN)ptCompositor->nHeight - 1);
+	if (nRight < 0 || nBottom < 0 || ptLayer->nX >= (INTN)ptCompositor->nWidth || ptLayer->nY >= (INTN)ptCompositor->nHeight)
+		return FALSE;
+	SetRect(ptRect, (UINTN)MAX(ptLayer->nX, 0), (UINTN)MAX(ptLayer->nY, 0), (UINTN)nRight, (UINTN)nBottom);
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: IsLayerOpaque()
+** Description: Checks whether a layer hides everything below it
+** Input:
+**		ptLayer: Layer
+** Output: None
+** Return value: TRUE -> Opaque, FALSE -> Has alpha
+** ===========================================================================
+*/
+static
+BOOLEAN
+IsLayerOpaque(
+	IN CONST LAYER *ptLayer
+)
+{
+	return (BOOLEAN)(ptLayer->ptImage == NULL || ptLayer->ptImage->nFormat != SURFACE_FORMAT_BGRA);
+}
+
+/*
+** ===========================================================================
+** Function: ContainsRect()
+** Description: Checks whether a rectangle lies completely inside another
+** Input:
+**		ptOuter: Containing rectangle
+**		ptInner: Contained rectangle
+** Output: None
+** Return value: TRUE -> Inside, FALSE -> Not inside
+** ===========================================================================
+*/
+static
+BOOLEAN
+ContainsRect(
+	IN CONST RECT *ptOuter,
+	IN CONST RECT *ptInner
+)
+{
+	return (BOOLEAN)(ptInner->nLeft >= ptOuter->nLeft && ptInner->nRight <= ptOuter->nRight &&
+		ptInner->nTop >= ptOuter->nTop && ptInner->nBottom <= ptOuter->nBottom);
+}
+
+/*
+** ===========================================================================
+** Function: MarkLayerDirty()
+** Description: Queues the current on-screen area of a layer for redraw
+** Input:
+**		ptCompositor: Compositor
+**		ptLayer: Layer
+** Output: Updated dirty list
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+MarkLayerDirty(
+	IN OUT COMPOSITOR *ptCompositor,
+	IN CONST LAYER *ptLayer
+)
+{
+	RECT       tRect;
+	if (GetLayerRect(ptCompositor, ptLayer, &tRect) == TRUE)
+		AddRectToList(&ptCompositor->tDirty, &tRect);
+}
+
+/*
+** ===========================================================================
+** Function: SortLayers()
+** Description: Lists the shown layers from bottom to top (z-order, then
+** creation order)
+** Input:
+**		ptCompositor: Compositor
+**		anOrder: Layer indexes, LAYER_MAX entries
+** Output: Sorted indexes
+** Return value: Number of layers listed
+** ===========================================================================
+*/
+static
+UINTN
+SortLayers(
+	IN CONST COMPOSITOR *ptCompositor,
+	OUT UINTN *anOrder
+)
+{
+	UINTN      nCount = 0;
+	UINTN      nIndex;
+	UINTN      nPos;
+	for (nIndex = 0; nIndex < LAYER_MAX; nIndex++)
+	{
+		if (ptCompositor->atLayers[nIndex].bUsed == FALSE || ptCompositor->atLayers[nIndex].bVisible == FALSE)
+			continue;
+		for (nPos = nCount; nPos > 0 &&
+			ptCompositor->atLayers[anOrder[nPos - 1]].nZOrder > ptCompositor->atLayers[nIndex].nZOrder; nPos--)
+			anOrder[nPos] = anOrder[nPos - 1];
+		anOrder[nPos] = nIndex;
+		nCount++;
+	}
+	return nCount;
+}
+
+/*
+** ===========================================================================
+** Function: ComposeRegion()
+** Description: Builds one screen region from the layers in RAM and outputs
+** it with a single BLT. Drawing starts at the topmost opaque layer covering
+** the whole region, and layer parts hidden by an opaque layer above are
+** skipped.
+** Input:
+**		ptCompositor: Compositor
+**		anOrder: Shown layers, bottom to top
+**		nCount: Number of shown layers
+**		ptRegion: Screen region
+** Output: Region output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+ComposeRegion(
+	IN OUT COMPOSITOR *ptCompositor,
+	IN CONST UINTN *anOrder,
+	IN UINTN nCount,
+	IN CONST RECT *ptRegion
+)
+{
+	CONST LAYER *ptLayer;
+	CONST SURFACE *ptImage;
+	SURFACE    tScratch;
+	RECT       tLayerRect;
+	RECT       tPart;
+	RECT       tAbove;
+	UINTN      nWidth = WidthRect(ptRegion);
+	UINTN      nHeight = HeightRect(ptRegion);
+	UINTN      nBase = 0;
+	UINTN      nIndex;
+	UINTN      nUpper;
+	UINTN      nSrcX;
+	UINTN      nSrcY;
+	UINTN      nRow;
+	BOOLEAN    bCovered = FALSE;
+	BOOLEAN    bHidden;
+	if (ptCompositor->nScratchSize < nWidth * nHeight)
+	{
+		if (ptCompositor->ptScratch != NULL)
+			FreePool(ptCompositor->ptScratch);
+		ptCompositor->nScratchSize = 0;
+		ASSERT_CHECK((ptCompositor->ptScratch = AllocatePool(nWidth * nHeight * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL))) != NULL);
+		ptCompositor->nScratchSize = nWidth * nHeight;
+	}
+	ASSERT_CHECK_EFISTATUS(InitSurface(&tScratch, ptCompositor->ptScratch, nWidth, nHeight, nWidth, SURFACE_FORMAT_BGRX));
+	for (nIndex = nCount; nIndex-- > 0;)
+	{
+		ptLayer = &ptCompositor->atLayers[anOrder[nIndex]];
+		if (IsLayerOpaque(ptLayer) && GetLayerRect(ptCompositor, ptLayer, &tLayerRect) && ContainsRect(&tLayerRect, ptRegion))
+		{
+			nBase = nIndex;
+			bCovered = TRUE;
+			break;
+		}
+	}
+	if (bCovered == FALSE)
+		SurfaceBlt(&tScratch, &ptCompositor->tBackground, EfiBltVideoFill, 0, 0, 0, 0, nWidth, nHeight, 0);
+	for (nIndex = nBase; nIndex < nCount; nIndex++)
+	{
+		ptLayer = &ptCompositor->atLayers[anOrder[nIndex]];
+		if (GetLayerRect(ptCompositor, ptLayer, &tLayerRect) == FALSE || IntersectRect(&tPart, &tLayerRect, ptRegion) == FALSE)
+			continue;
+		bHidden = FALSE;
+		for (nUpper = nIndex + 1; nUpper < nCount && bHidden == FALSE; nUpper++)
+		{
+			if (IsLayerOpaque(&ptCompositor->atLayers[anOrder[nUpper]]) &&
+				GetLayerRect(ptCompositor, &ptCompositor->atLayers[anOrder[nUpper]], &tAbove))
+				bHidden = ContainsRect(&tAbove, &tPart);
+		}
+		if (bHidden)
+			continue;
+		ptImage = ptLayer->ptImage;
+		if (ptImage == NULL)
+		{
+			SurfaceBlt(&tScratch, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)&ptLayer->tColor, EfiBltVideoFill, 0, 0,
+				tPart.nLeft - ptRegion->nLeft, tPart.nTop - ptRegion->nTop, WidthRect((&tPart)), HeightRect((&tPart)), 0);
+			continue;
+		}
+		nSrcX = (UINTN)((INTN)tPart.nLeft - ptLayer->nX);
+		nSrcY = (UINTN)((INTN)tPart.nTop - ptLayer->nY);
+		if (IsLayerOpaque(ptLayer))
+		{
+			SurfaceBlt(&tScratch, ptImage->ptPixels, EfiBltBufferToVideo, nSrcX, nSrcY,
+				tPart.nLeft - ptRegion->nLeft, tPart.nTop - ptRegion->nTop, WidthRect((&tPart)), HeightRect((&tPart)),
+				ptImage->nStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+			continue;
+		}
+		for (nRow = 0; nRow < HeightRect((&tPart)); nRow++)
+			BlendPixelRow((UINT32 *)SurfacePixel(&tScratch, tPart.nLeft - ptRegion->nLeft, tPart.nTop - ptRegion->nTop + nRow),
+				(CONST UINT32 *)SurfacePixel(ptImage, nSrcX, nSrcY + nRow), WidthRect((&tPart)));
+	}
+	return DrawBltEx(ptCompositor->ptGraphicsOutput, tScratch.ptPixels, EfiBltBufferToVideo, ptRegion, NULL, nWidth);
+}
+
+/*
+** ===========================================================================
+** Function: GetLayer()
+** Description: Looks up a layer by its index
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+** Output: None
+** Return value: Layer, NULL when the index is not in use
+** ===========================================================================
+*/
+static
+LAYER *
+GetLayer(
+	IN COMPOSITOR *ptCompositor,
+	IN UINTN nLayer
+)
+{
+	if (ptCompositor == NULL || nLayer >= LAYER_MAX || ptCompositor->atLayers[nLayer].bUsed == FALSE)
+		return NULL;
+	return &ptCompositor->atLayers[nLayer];
+}
+
+/*
+** ===========================================================================
+** Function: NewLayer()
+** Description: Takes a free layer slot
+** Input:
+**		ptCompositor: Compositor
+**		pnLayer: Index of the new layer
+** Output: Cleared layer
+** Return value: Layer, NULL when all slots are used
+** ===========================================================================
+*/
+static
+LAYER *
+NewLayer(
+	IN COMPOSITOR *ptCompositor,
+	OUT UINTN *pnLayer
+)
+{
+	UINTN      nIndex;
+	for (nIndex = 0; nIndex < LAYER_MAX; nIndex++)
+	{
+		if (ptCompositor->atLayers[nIndex].bUsed == FALSE)
+		{
+			ZeroMem(&ptCompositor->atLayers[nIndex], sizeof(LAYER));
+			ptCompositor->atLayers[nIndex].bUsed = TRUE;
+			ptCompositor->atLayers[nIndex].bVisible = TRUE;
+			*pnLayer = nIndex;
+			return &ptCompositor->atLayers[nIndex];
+		}
+	}
+	return NULL;
+}
+
+/*
+** ===========================================================================
+** Function: InitCompositor()
+** Description: Prepares a compositor for a GOP. The whole screen is marked
+** dirty, so the first ComposeLayers() paints everything.
+** Input:
+**		ptCompositor: Compositor to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBackground: Color where no layer is, NULL = black
+** Output: Empty compositor
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitCompositor(
+	OUT      COMPOSITOR                          *ptCompositor,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBackground OPTIONAL
+)
+{
+	RECT       tScreen;
+	ASSERT_ENSURE(ptCompositor != NULL && ptGraphicsOutput != NULL);
+	ZeroMem(ptCompositor, sizeof(COMPOSITOR));
+	ptCompositor->ptGraphicsOutput = ptGraphicsOutput;
+	ptCompositor->nWidth = ptGraphicsOutput->Mode->Info->HorizontalResolution;
+	ptCompositor->nHeight = ptGraphicsOutput->Mode->Info->VerticalResolution;
+	if (ptBackground != NULL)
+		CopyMem(&ptCompositor->tBackground, ptBackground, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	SetRect(&tScreen, 0, 0, ptCompositor->nWidth - 1, ptCompositor->nHeight - 1);
+	AddRectToList(&ptCompositor->tDirty, &tScreen);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: FreeCompositor()
+** Description: Releases the work buffer of a compositor. Layer images
+** belong to the caller and are not freed.
+** Input:
+**		ptCompositor: Compositor
+** Output: Freed compositor
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+FreeCompositor(
+	IN OUT   COMPOSITOR                          *ptCompositor
+)
+{
+	ASSERT_ENSURE(ptCompositor != NULL);
+	if (ptCompositor->ptScratch != NULL)
+		FreePool(ptCompositor->ptScratch);
+	ZeroMem(ptCompositor, sizeof(COMPOSITOR));
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: AddImageLayer()
+** Description: Adds a layer showing an image. The surface must stay valid
+** while the layer exists; call InvalidateLayer() after changing its pixels.
+** Input:
+**		ptCompositor: Compositor
+**		ptImage: Image (SURFACE_FORMAT_BGRA images are blended)
+**		nX, nY: Position of the top left corner, may be off-screen
+**		nZOrder: Stacking order, higher is on top
+**		pnLayer: Index of the new layer
+** Output: New layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+AddImageLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN CONST SURFACE                             *ptImage,
+	IN       INTN                                nX,
+	IN       INTN                                nY,
+	IN       INTN                                nZOrder,
+	OUT      UINTN                               *pnLayer
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_ENSURE(ptCompositor != NULL && ptImage != NULL && ptImage->ptPixels != NULL && pnLayer != NULL);
+	ASSERT_CHECK((ptLayer = NewLayer(ptCompositor, pnLayer)) != NULL);
+	ptLayer->ptImage = ptImage;
+	ptLayer->nX = nX;
+	ptLayer->nY = nY;
+	ptLayer->nWidth = ptImage->nWidth;
+	ptLayer->nHeight = ptImage->nHeight;
+	ptLayer->nZOrder = nZOrder;
+	MarkLayerDirty(ptCompositor, ptLayer);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: AddFillLayer()
+** Description: Adds a layer filled with one color
+** Input:
+**		ptCompositor: Compositor
+**		ptColor: Fill color
+**		nX, nY: Position of the top left corner, may be off-screen
+**		nWidth, nHeight: Layer size
+**		nZOrder: Stacking order, higher is on top
+**		pnLayer: Index of the new layer
+** Output: New layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+AddFillLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptColor,
+	IN       INTN                                nX,
+	IN       INTN                                nY,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       INTN                                nZOrder,
+	OUT      UINTN                               *pnLayer
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_ENSURE(ptCompositor != NULL && ptColor != NULL && pnLayer != NULL);
+	ASSERT_CHECK((ptLayer = NewLayer(ptCompositor, pnLayer)) != NULL);
+	CopyMem(&ptLayer->tColor, ptColor, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	ptLayer->nX = nX;
+	ptLayer->nY = nY;
+	ptLayer->nWidth = nWidth;
+	ptLayer->nHeight = nHeight;
+	ptLayer->nZOrder = nZOrder;
+	MarkLayerDirty(ptCompositor, ptLayer);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: RemoveLayer()
+** Description: Removes a layer, uncovering what was below it
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+** Output: Freed layer slot
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RemoveLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_CHECK((ptLayer = GetLayer(ptCompositor, nLayer)) != NULL);
+	MarkLayerDirty(ptCompositor, ptLayer);
+	ptLayer->bUsed = FALSE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: MoveLayer()
+** Description: Moves a layer; its old and new areas are redrawn
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		nX, nY: New position of the top left corner
+** Output: Moved layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+MoveLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN       INTN                                nX,
+	IN       INTN                                nY
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_CHECK((ptLayer = GetLayer(ptCompositor, nLayer)) != NULL);
+	if (ptLayer->nX == nX && ptLayer->nY == nY)
+		return EFI_SUCCESS;
+	MarkLayerDirty(ptCompositor, ptLayer);
+	ptLayer->nX = nX;
+	ptLayer->nY = nY;
+	MarkLayerDirty(ptCompositor, ptLayer);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetLayerZOrder()
+** Description: Changes the stacking order of a layer
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		nZOrder: Stacking order, higher is on top
+** Output: Restacked layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetLayerZOrder(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN       INTN                                nZOrder
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_CHECK((ptLayer = GetLayer(ptCompositor, nLayer)) != NULL);
+	if (ptLayer->nZOrder == nZOrder)
+		return EFI_SUCCESS;
+	ptLayer->nZOrder = nZOrder;
+	MarkLayerDirty(ptCompositor, ptLayer);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: ShowLayer()
+** Description: Shows or hides a layer
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		bVisible: TRUE = shown, FALSE = hidden
+** Output: Updated layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+ShowLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN       BOOLEAN                             bVisible
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_CHECK((ptLayer = GetLayer(ptCompositor, nLayer)) != NULL);
+	if (ptLayer->bVisible == bVisible)
+		return EFI_SUCCESS;
+	/* Marked while shown, so both directions record the area */
+	ptLayer->bVisible = TRUE;
+	MarkLayerDirty(ptCompositor, ptLayer);
+	ptLayer->bVisible = bVisible;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetLayerImage()
+** Description: Replaces the image of an image layer (e.g. normal and
+** highlighted button states)
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		ptImage: New image
+** Output: Updated layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetLayerImage(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN CONST SURFACE                             *ptImage
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_CHECK((ptLayer = GetLayer(ptCompositor, nLayer)) != NULL);
+	ASSERT_ENSURE(ptImage != NULL && ptImage->ptPixels != NULL && ptLayer->ptImage != NULL);
+	MarkLayerDirty(ptCompositor, ptLayer);
+	ptLayer->ptImage = ptImage;
+	ptLayer->nWidth = ptImage->nWidth;
+	ptLayer->nHeight = ptImage->nHeight;
+	MarkLayerDirty(ptCompositor, ptLayer);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: InvalidateLayer()
+** Description: Marks a layer for redraw after its image or color changed
+** in place
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+** Output: Updated dirty list
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InvalidateLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer
+)
+{
+	LAYER      *ptLayer;
+	ASSERT_CHECK((ptLayer = GetLayer(ptCompositor, nLayer)) != NULL);
+	MarkLayerDirty(ptCompositor, ptLayer);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: ComposeLayers()
+** Description: Redraws the areas changed since the last call, each one
+** composed in RAM and output with a single BLT. Areas left undrawn by a
+** failure stay dirty.
+** Input:
+**		ptCompositor: Compositor
+** Output: Updated screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+ComposeLayers(
+	IN OUT   COMPOSITOR                          *ptCompositor
+)
+{
+	UINTN      anOrder[LAYER_MAX];
+	UINTN      nCount;
+	UINTN      nIndex;
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptCompositor != NULL);
+	nCount = SortLayers(ptCompositor, anOrder);
+	for (nIndex = 0; nIndex < ptCompositor->tDirty.nCount; nIndex++)
+	{
+		nStatus = ComposeRegion(ptCompositor, anOrder, nCount, &ptCompositor->tDirty.atRects[nIndex]);
+		if (nStatus != EFI_SUCCESS)
+		{
+			/* Keep the areas not composed, the next call repaints them */
+			ptCompositor->tDirty.nCount -= nIndex;
+			CopyMem(ptCompositor->tDirty.atRects, &ptCompositor->tDirty.atRects[nIndex], ptCompositor->tDirty.nCount * sizeof(RECT));
+			return nStatus;
+		}
+	}
+	ClearRectList(&ptCompositor->tDirty);
+	return EFI_SUCCESS;
+}
@@ -0,0 +1,300 @@
+/*
+** ===========================================================================
+** File: GOP_Layers.h
+** Description: UEFI graphics-related code module (layered compositor)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_LAYERS_H_
+#define _GRAPHICS_GOP_LAYERS_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define LAYER_MAX	32
+
+typedef struct {
+	BOOLEAN                                      bUsed;
+	BOOLEAN                                      bVisible;
+	INTN                                         nZOrder;	/* Higher is drawn on top */
+	INTN                                         nX;		/* Position, may be off-screen */
+	INTN                                         nY;
+	UINTN                                        nWidth;
+	UINTN                                        nHeight;
+	CONST SURFACE                                *ptImage;	/* NULL = solid fill with tColor */
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                tColor;
+} LAYER;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;
+	UINTN                                        nWidth;		/* Screen size */
+	UINTN                                        nHeight;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                tBackground;	/* Shown where no layer is */
+	LAYER                                        atLayers[LAYER_MAX];
+	RECT_LIST                                    tDirty;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                *ptScratch;	/* Region being composed */
+	UINTN                                        nScratchSize;	/* In pixels */
+} COMPOSITOR;
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: InitCompositor()
+** Description: Prepares a compositor for a GOP. The whole screen is marked
+** dirty, so the first ComposeLayers() paints everything.
+** Input:
+**		ptCompositor: Compositor to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptBackground: Color where no layer is, NULL = black
+** Output: Empty compositor
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitCompositor(
+	OUT      COMPOSITOR                          *ptCompositor,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBackground OPTIONAL
+);
+
+/*
+** ===========================================================================
+** Function: FreeCompositor()
+** Description: Releases the work buffer of a compositor. Layer images
+** belong to the caller and are not freed.
+** Input:
+**		ptCompositor: Compositor
+** Output: Freed compositor
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+FreeCompositor(
+	IN OUT   COMPOSITOR                          *ptCompositor
+);
+
+/*
+** ===========================================================================
+** Function: AddImageLayer()
+** Description: Adds a layer showing an image. The surface must stay valid
+** while the layer exists; call InvalidateLayer() after changing its pixels.
+** Input:
+**		ptCompositor: Compositor
+**		ptImage: Image (SURFACE_FORMAT_BGRA images are blended)
+**		nX, nY: Position of the top left corner, may be off-screen
+**		nZOrder: Stacking order, higher is on top
+**		pnLayer: Index of the new layer
+** Output: New layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+AddImageLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN CONST SURFACE                             *ptImage,
+	IN       INTN                                nX,
+	IN       INTN                                nY,
+	IN       INTN                                nZOrder,
+	OUT      UINTN                               *pnLayer
+);
+
+/*
+** ===========================================================================
+** Function: AddFillLayer()
+** Description: Adds a layer filled with one color
+** Input:
+**		ptCompositor: Compositor
+**		ptColor: Fill color
+**		nX, nY: Position of the top left corner, may be off-screen
+**		nWidth, nHeight: Layer size
+**		nZOrder: Stacking order, higher is on top
+**		pnLayer: Index of the new layer
+** Output: New layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+AddFillLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptColor,
+	IN       INTN                                nX,
+	IN       INTN                                nY,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       INTN                                nZOrder,
+	OUT      UINTN                               *pnLayer
+);
+
+/*
+** ===========================================================================
+** Function: RemoveLayer()
+** Description: Removes a layer, uncovering what was below it
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+** Output: Freed layer slot
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RemoveLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer
+);
+
+/*
+** ===========================================================================
+** Function: MoveLayer()
+** Description: Moves a layer; its old and new areas are redrawn
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		nX, nY: New position of the top left corner
+** Output: Moved layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+MoveLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN       INTN                                nX,
+	IN       INTN                                nY
+);
+
+/*
+** ===========================================================================
+** Function: SetLayerZOrder()
+** Description: Changes the stacking order of a layer
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		nZOrder: Stacking order, higher is on top
+** Output: Restacked layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetLayerZOrder(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN       INTN                                nZOrder
+);
+
+/*
+** ===========================================================================
+** Function: ShowLayer()
+** Description: Shows or hides a layer
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		bVisible: TRUE = shown, FALSE = hidden
+** Output: Updated layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+ShowLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN       BOOLEAN                             bVisible
+);
+
+/*
+** ===========================================================================
+** Function: SetLayerImage()
+** Description: Replaces the image of an image layer (e.g. normal and
+** highlighted button states)
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+**		ptImage: New image
+** Output: Updated layer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetLayerImage(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer,
+	IN CONST SURFACE                             *ptImage
+);
+
+/*
+** ===========================================================================
+** Function: InvalidateLayer()
+** Description: Marks a layer for redraw after its image or color changed
+** in place
+** Input:
+**		ptCompositor: Compositor
+**		nLayer: Layer index
+** Output: Updated dirty list
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InvalidateLayer(
+	IN OUT   COMPOSITOR                          *ptCompositor,
+	IN       UINTN                               nLayer
+);
+
+/*
+** ===========================================================================
+** Function: ComposeLayers()
+** Description: Redraws the areas changed since the last call, each one
+** composed in RAM and output with a single BLT. Areas left undrawn by a
+** failure stay dirty.
+** Input:
+**		ptCompositor: Compositor
+** Output: Updated screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+ComposeLayers(
+	IN OUT   COMPOSITOR                          *ptCompositor
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_LAYERS_H_ */
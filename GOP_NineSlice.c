@@ -0,0 +1,330 @@
+/*
+** ===========================================================================
+** File: GOP_NineSlice.c
+** Description: UEFI graphics-related code module (nine-slice frames)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Surface.h"
+#include "GOP_Scale.h"
+#include "GOP_Blend.h"
+#include "GOP_NineSlice.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: OutputPixels()
+** Description: Outputs part of a BLT buffer, blended when the frame has
+** alpha
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		bAlpha: TRUE = premultiplied BGRA
+**		ptBlt: BLT pixel buffer
+**		ptRect: Destination rectangle on screen
+**		ptSrcRect: Area of the BLT buffer
+**		nSrcStride: BLT buffer pixels per row
+** Output: Pixels output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+OutputPixels(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN BOOLEAN bAlpha,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN CONST RECT *ptRect,
+	IN CONST RECT *ptSrcRect,
+	IN UINTN nSrcStride
+)
+{
+	if (bAlpha)
+		return DrawBltAlpha(ptGraphicsOutput, ptBlt, ptRect, ptSrcRect, nSrcStride);
+	return DrawBltEx(ptGraphicsOutput, ptBlt, EfiBltBufferToVideo, ptRect, ptSrcRect, nSrcStride);
+}
+
+/*
+** ===========================================================================
+** Function: GetSolidColor()
+** Description: Checks whether every pixel of a slice has the same value
+** Input:
+**		ptImage: Frame image
+**		ptSrcRect: Slice
+**		ptColor: The common pixel value
+** Output: Slice color
+** Return value: TRUE -> Single color, FALSE -> Several colors
+** ===========================================================================
+*/
+static
+BOOLEAN
+GetSolidColor(
+	IN CONST SURFACE *ptImage,
+	IN CONST RECT *ptSrcRect,
+	OUT UINT32 *pnColor
+)
+{
+	CONST UINT32 *pnRow;
+	UINTN      nX;
+	UINTN      nY;
+	*pnColor = *(CONST UINT32 *)SurfacePixel(ptImage, ptSrcRect->nLeft, ptSrcRect->nTop);
+	for (nY = ptSrcRect->nTop; nY <= ptSrcRect->nBottom; nY++)
+	{
+		pnRow = (CONST UINT32 *)SurfacePixel(ptImage, 0, nY);
+		for (nX = ptSrcRect->nLeft; nX <= ptSrcRect->nRight; nX++)
+		{
+			if (pnRow[nX] != *pnColor)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: FillTileRows()
+** Description: Builds the rows of one tile row of a slice, repeating the
+** source across the destination width
+** Input:
+**		ptImage: Frame image
+**		ptSrcRect: Slice
+**		pnStrip: Output rows, nDestWidth pixels each
+**		nDestWidth: Destination width of the slice
+**		nRows: Rows to build, at most the slice height
+** Output: Built rows
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+FillTileRows(
+	IN CONST SURFACE *ptImage,
+	IN CONST RECT *ptSrcRect,
+	OUT UINT32 *pnStrip,
+	IN UINTN nDestWidth,
+	IN UINTN nRows
+)
+{
+	CONST UINT32 *pnSrc;
+	UINTN      nSrcWidth = WidthRect(ptSrcRect);
+	UINTN      nRow;
+	UINTN      nCol;
+	for (nRow = 0; nRow < nRows; nRow++, pnStrip += nDestWidth)
+	{
+		pnSrc = (CONST UINT32 *)SurfacePixel(ptImage, ptSrcRect->nLeft, ptSrcRect->nTop + nRow);
+		for (nCol = 0; nCol < nDestWidth; nCol += nSrcWidth)
+			CopyMem(pnStrip + nCol, pnSrc, MIN(nSrcWidth, nDestWidth - nCol) * sizeof(UINT32));
+	}
+}
+
+/*
+** ===========================================================================
+** Function: OutputSlice()
+** Description: Outputs one of the nine slices. Single-color slices become
+** a fill (or nothing when transparent), same-size slices are copied,
+** stretched slices are scaled bilinear (composited when the frame has
+** alpha). Tiled slices are built one tile row high once and output once
+** per tile row.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSlice: Nine-slice frame
+**		ptSrcRect: Slice in the frame image
+**		ptRect: Destination rectangle on screen
+** Output: Slice output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+OutputSlice(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST NINE_SLICE *ptSlice,
+	IN CONST RECT *ptSrcRect,
+	IN CONST RECT *ptRect
+)
+{
+	CONST SURFACE *ptImage = ptSlice->ptImage;
+	UINT32     *pnStrip;
+	RECT       tBand;
+	RECT       tBandSrc;
+	UINTN      nDestWidth;
+	UINTN      nDestHeight;
+	UINTN      nBandRows;
+	UINTN      nRow;
+	UINT32     nColor;
+	BOOLEAN    bAlpha = (BOOLEAN)(ptImage->nFormat == SURFACE_FORMAT_BGRA);
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	nDestWidth = WidthRect(ptRect);
+	nDestHeight = HeightRect(ptRect);
+	if (GetSolidColor(ptImage, ptSrcRect, &nColor))
+	{
+		if (bAlpha && (nColor >> 24) == 0)
+			return EFI_SUCCESS;
+		if (bAlpha == FALSE || (nColor >> 24) == 0xFF)
+			return DrawBltEx(ptGraphicsOutput, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)&nColor, EfiBltVideoFill, ptRect, NULL, 0);
+	}
+	if (nDestWidth == WidthRect(ptSrcRect) && nDestHeight == HeightRect(ptSrcRect))
+		return OutputPixels(ptGraphicsOutput, bAlpha, ptImage->ptPixels, ptRect, ptSrcRect, ptImage->nStride);
+	if (ptSlice->nMode == NINE_SLICE_STRETCH)
+	{
+		if (bAlpha)
+			return DrawBltScaledAlpha(ptGraphicsOutput, ptImage->ptPixels, ptSrcRect, ptImage->nStride, ptRect, SCALE_FILTER_BILINEAR);
+		return DrawBltScaled(ptGraphicsOutput, ptImage->ptPixels, ptSrcRect, ptImage->nStride, ptRect, SCALE_FILTER_BILINEAR);
+	}
+	/* A tile row repeats unchanged down the slice */
+	nBandRows = MIN(HeightRect(ptSrcRect), nDestHeight);
+	ASSERT_CHECK((pnStrip = AllocatePool(nDestWidth * nBandRows * sizeof(UINT32))) != NULL);
+	FillTileRows(ptImage, ptSrcRect, pnStrip, nDestWidth, nBandRows);
+	for (nRow = 0; nRow < nDestHeight && nStatus == EFI_SUCCESS; nRow += nBandRows)
+	{
+		SetRect(&tBand, ptRect->nLeft, ptRect->nTop + nRow, ptRect->nRight, ptRect->nTop + MIN(nRow + nBandRows, nDestHeight) - 1);
+		SetRect(&tBandSrc, 0, 0, nDestWidth - 1, HeightRect((&tBand)) - 1);
+		nStatus = OutputPixels(ptGraphicsOutput, bAlpha, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)pnStrip, &tBand, &tBandSrc, nDestWidth);
+	}
+	FreePool(pnStrip);
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: InitNineSlice()
+** Description: Describes a nine-slice frame: corners of the border sizes
+** are drawn as they are, edges and center are stretched or tiled to fill
+** any destination size. One small decoded BMP/QOI covers every size.
+** Input:
+**		ptSlice: Nine-slice frame to initialize
+**		ptImage: Frame image, must stay valid while the frame is used
+**		nLeft, nTop, nRight, nBottom: Border sizes, at least one pixel of
+**		the image must be left for the center in each direction
+**		nMode: NINE_SLICE_*
+** Output: Nine-slice frame
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitNineSlice(
+	OUT      NINE_SLICE                          *ptSlice,
+	IN CONST SURFACE                             *ptImage,
+	IN       UINTN                               nLeft,
+	IN       UINTN                               nTop,
+	IN       UINTN                               nRight,
+	IN       UINTN                               nBottom,
+	IN       UINTN                               nMode
+)
+{
+	ASSERT_ENSURE(ptSlice != NULL && ptImage != NULL && ptImage->ptPixels != NULL && nMode <= NINE_SLICE_TILE);
+	ASSERT_CHECK(nLeft + nRight < ptImage->nWidth && nTop + nBottom < ptImage->nHeight);
+	ptSlice->ptImage = ptImage;
+	ptSlice->nLeft = nLeft;
+	ptSlice->nTop = nTop;
+	ptSlice->nRight = nRight;
+	ptSlice->nBottom = nBottom;
+	ptSlice->nMode = nMode;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: DrawNineSlice()
+** Description: Outputs a nine-slice frame at any size. Destinations
+** smaller than both borders keep the borders and drop the middle.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSlice: Nine-slice frame
+**		ptRect: Destination rectangle
+** Output: Frame output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawNineSlice(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST NINE_SLICE                          *ptSlice,
+	IN CONST RECT                                *ptRect
+)
+{
+	UINTN      anSrcX[4];
+	UINTN      anSrcY[4];
+	UINTN      anDestX[4];
+	UINTN      anDestY[4];
+	UINTN      nColumn;
+	UINTN      nRow;
+	RECT       tSrc;
+	RECT       tDest;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptSlice != NULL && ptSlice->ptImage != NULL && ptRect != NULL);
+	ASSERT_CHECK(WidthRect(ptRect) >= ptSlice->nLeft + ptSlice->nRight && HeightRect(ptRect) >= ptSlice->nTop + ptSlice->nBottom);
+	/* Column and row starts of the three slices, plus one past the end */
+	anSrcX[0] = 0;
+	anSrcX[1] = ptSlice->nLeft;
+	anSrcX[2] = ptSlice->ptImage->nWidth - ptSlice->nRight;
+	anSrcX[3] = ptSlice->ptImage->nWidth;
+	anSrcY[0] = 0;
+	anSrcY[1] = ptSlice->nTop;
+	anSrcY[2] = ptSlice->ptImage->nHeight - ptSlice->nBottom;
+	anSrcY[3] = ptSlice->ptImage->nHeight;
+	anDestX[0] = ptRect->nLeft;
+	anDestX[1] = ptRect->nLeft + ptSlice->nLeft;
+	anDestX[2] = ptRect->nRight + 1 - ptSlice->nRight;
+	anDestX[3] = ptRect->nRight + 1;
+	anDestY[0] = ptRect->nTop;
+	anDestY[1] = ptRect->nTop + ptSlice->nTop;
+	anDestY[2] = ptRect->nBottom + 1 - ptSlice->nBottom;
+	anDestY[3] = ptRect->nBottom + 1;
+	for (nRow = 0; nRow < 3; nRow++)
+	{
+		for (nColumn = 0; nColumn < 3; nColumn++)
+		{
+			/* Zero borders and a middle with no room give empty slices */
+			if (anDestX[nColumn] == anDestX[nColumn + 1] || anDestY[nRow] == anDestY[nRow + 1])
+				continue;
+			SetRect(&tSrc, anSrcX[nColumn], anSrcY[nRow], anSrcX[nColumn + 1] - 1, anSrcY[nRow + 1] - 1);
+			SetRect(&tDest, anDestX[nColumn], anDestY[nRow], anDestX[nColumn + 1] - 1, anDestY[nRow + 1] - 1);
+			ASSERT_CHECK_EFISTATUS(OutputSlice(ptGraphicsOutput, ptSlice, &tSrc, &tDest));
+		}
+	}
+	return EFI_SUCCESS;
+}
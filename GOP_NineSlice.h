@@ -0,0 +1,110 @@
+/*
+** ===========================================================================
+** File: GOP_NineSlice.h
+** Description: UEFI graphics-related code module (nine-slice frames)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_NINESLICE_H_
+#define _GRAPHICS_GOP_NINESLICE_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+enum
+{
+	NINE_SLICE_STRETCH,	/* Edges and center scaled to size */
+	NINE_SLICE_TILE		/* Edges and center repeated, cut at the far end */
+};
+
+typedef struct {
+	CONST SURFACE                                *ptImage;	/* Source frame, e.g. a decoded 48x48 BMP/QOI */
+	UINTN                                        nLeft;		/* Border sizes in pixels */
+	UINTN                                        nTop;
+	UINTN                                        nRight;
+	UINTN                                        nBottom;
+	UINTN                                        nMode;		/* NINE_SLICE_* */
+} NINE_SLICE;
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: InitNineSlice()
+** Description: Describes a nine-slice frame: corners of the border sizes
+** are drawn as they are, edges and center are stretched or tiled to fill
+** any destination size. One small decoded BMP/QOI covers every size.
+** Input:
+**		ptSlice: Nine-slice frame to initialize
+**		ptImage: Frame image, must stay valid while the frame is used
+**		nLeft, nTop, nRight, nBottom: Border sizes, at least one pixel of
+**		the image must be left for the center in each direction
+**		nMode: NINE_SLICE_*
+** Output: Nine-slice frame
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitNineSlice(
+	OUT      NINE_SLICE                          *ptSlice,
+	IN CONST SURFACE                             *ptImage,
+	IN       UINTN                               nLeft,
+	IN       UINTN                               nTop,
+	IN       UINTN                               nRight,
+	IN       UINTN                               nBottom,
+	IN       UINTN                               nMode
+);
+
+/*
+** ===========================================================================
+** Function: DrawNineSlice()
+** Description: Outputs a nine-slice frame at any size. Destinations
+** smaller than both borders keep the borders and drop the middle.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSlice: Nine-slice frame
+**		ptRect: Destination rectangle
+** Output: Frame output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawNineSlice(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST NINE_SLICE                          *ptSlice,
+	IN CONST RECT                                *ptRect
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_NINESLICE_H_ */
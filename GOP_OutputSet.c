@@ -0,0 +1,328 @@
+/*
+** ===========================================================================
+** File: GOP_OutputSet.c
+** Description: UEFI graphics-related code module (mirrored output to every
+** GOP in the system)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/TimerLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Surface.h"
+#include "GOP_Scale.h"
+#include "GOP_Transform.h"
+#include "GOP_OutputSet.h"
+#include "Image_Bmp.h"
+#include "Image_Qoi.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define GOP_OUTPUT_SKIP_MAX	8	/* A slow head still shows every n-th frame */
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: GetFitSize()
+** Description: Computes the size an image gets on a mode
+** Input:
+**		ptImage: Image
+**		nModeWidth, nModeHeight: Mode resolution
+**		nFit: OUTPUT_FIT_*
+**		pnWidth, pnHeight: Output size
+** Output: Output size
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+GetFitSize(
+	IN CONST SURFACE *ptImage,
+	IN UINTN nModeWidth,
+	IN UINTN nModeHeight,
+	IN UINTN nFit,
+	OUT UINTN *pnWidth,
+	OUT UINTN *pnHeight
+)
+{
+	*pnWidth = ptImage->nWidth;
+	*pnHeight = ptImage->nHeight;
+	if (nFit == OUTPUT_FIT_CLIP)
+		return;
+	if (nFit == OUTPUT_FIT_SHRINK && ptImage->nWidth <= nModeWidth && ptImage->nHeight <= nModeHeight)
+		return;
+	/* Limit by whichever side hits the mode first */
+	if ((UINT64)nModeWidth * ptImage->nHeight <= (UINT64)nModeHeight * ptImage->nWidth)
+	{
+		*pnWidth = nModeWidth;
+		*pnHeight = (UINTN)DivU64x64Remainder((UINT64)ptImage->nHeight * nModeWidth, ptImage->nWidth, NULL);
+	}
+	else
+	{
+		*pnHeight = nModeHeight;
+		*pnWidth = (UINTN)DivU64x64Remainder((UINT64)ptImage->nWidth * nModeHeight, ptImage->nHeight, NULL);
+	}
+	*pnWidth = MAX(*pnWidth, 1);
+	*pnHeight = MAX(*pnHeight, 1);
+}
+
+/*
+** ===========================================================================
+** Function: PresentToOutput()
+** Description: Outputs an image on one GOP of the set, scaling it for the
+** current mode if needed (area average when shrinking, bilinear otherwise)
+** Input:
+**		ptOutput: Output of the set
+**		ptImage: Image
+**		nFrontStyle: FRONT_STYLE_* placement on the screen
+**		nFit: OUTPUT_FIT_*
+** Output: Image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+PresentToOutput(
+	IN OUT GOP_OUTPUT *ptOutput,
+	IN CONST SURFACE *ptImage,
+	IN UINTN nFrontStyle,
+	IN UINTN nFit
+)
+{
+	EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *ptInfo = ptOutput->ptGraphicsOutput->Mode->Info;
+	UINTN      nWidth;
+	UINTN      nHeight;
+	INTN       nX;
+	INTN       nY;
+	RECT       tRect;
+	GetFitSize(ptImage, ptInfo->HorizontalResolution, ptInfo->VerticalResolution, nFit, &nWidth, &nHeight);
+	/* FRONT_STYLE_* is ordered left/middle/right, then top/center/bottom */
+	nX = ((INTN)ptInfo->HorizontalResolution - (INTN)nWidth) * (INTN)(nFrontStyle / 3) / 2;
+	nY = ((INTN)ptInfo->VerticalResolution - (INTN)nHeight) * (INTN)(nFrontStyle % 3) / 2;
+	SetRect(&tRect, (UINTN)nX, (UINTN)nY, (UINTN)nX + nWidth - 1, (UINTN)nY + nHeight - 1);
+	if (nWidth == ptImage->nWidth && nHeight == ptImage->nHeight)
+		return PresentSurface(ptOutput->ptGraphicsOutput, ptImage, &tRect);
+	return DrawSurfaceScaled(ptOutput->ptGraphicsOutput, ptImage, &tRect,
+		(nWidth < ptImage->nWidth && nHeight < ptImage->nHeight) ? SCALE_FILTER_BOX : SCALE_FILTER_BILINEAR);
+}
+
+/*
+** ===========================================================================
+** Function: OpenGopOutputSet()
+** Description: Collects every GOP in the system into an output set. The
+** console splitter's virtual GOP is only used when no physical one exists,
+** it mirrors to the same heads by itself.
+** Input:
+**		ptSet: Output set to fill
+** Output: Output set
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+OpenGopOutputSet(
+	OUT      GOP_OUTPUT_SET                      *ptSet
+)
+{
+	EFI_HANDLE *ptHandles;
+	EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput;
+	EFI_GRAPHICS_OUTPUT_PROTOCOL *ptSplitter = NULL;
+	UINTN      nHandles;
+	UINTN      nIndex;
+	UINTN      nOutput;
+	ASSERT_ENSURE(ptSet != NULL);
+	ZeroMem(ptSet, sizeof(GOP_OUTPUT_SET));
+	ASSERT_CHECK_EFISTATUS(gBS->LocateHandleBuffer(ByProtocol, &gEfiGraphicsOutputProtocolGuid, NULL, &nHandles, &ptHandles));
+	for (nIndex = 0; nIndex < nHandles && ptSet->nCount < GOP_OUTPUT_SET_MAX; nIndex++)
+	{
+		if (gBS->HandleProtocol(ptHandles[nIndex], &gEfiGraphicsOutputProtocolGuid, (VOID **)&ptGraphicsOutput) != EFI_SUCCESS ||
+			ptGraphicsOutput->Mode == NULL || ptGraphicsOutput->Mode->Info == NULL)
+			continue;
+		if (ptHandles[nIndex] == gST->ConsoleOutHandle)
+		{
+			ptSplitter = ptGraphicsOutput;
+			continue;
+		}
+		for (nOutput = 0; nOutput < ptSet->nCount; nOutput++)
+		{
+			if (ptSet->atOutputs[nOutput].ptGraphicsOutput == ptGraphicsOutput)
+				break;
+		}
+		if (nOutput == ptSet->nCount)
+			ptSet->atOutputs[ptSet->nCount++].ptGraphicsOutput = ptGraphicsOutput;
+	}
+	FreePool(ptHandles);
+	if (ptSet->nCount == 0 && ptSplitter != NULL)
+		ptSet->atOutputs[ptSet->nCount++].ptGraphicsOutput = ptSplitter;
+	ASSERT_CHECK(ptSet->nCount != 0);
+	for (nOutput = 0; nOutput < ptSet->nCount; nOutput++)
+		InitGop(ptSet->atOutputs[nOutput].ptGraphicsOutput);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: CloseGopOutputSet()
+** Description: Releases an output set
+** Input:
+**		ptSet: Output set
+** Output: Empty output set
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CloseGopOutputSet(
+	IN OUT   GOP_OUTPUT_SET                      *ptSet
+)
+{
+	ASSERT_ENSURE(ptSet != NULL);
+	ZeroMem(ptSet, sizeof(GOP_OUTPUT_SET));
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: PresentOutputSet()
+** Description: Outputs one decoded image on every GOP of the set, placed
+** and scaled or clipped per mode. Each head's frame cost is measured; with
+** bMaySkip a head slower than the fastest one skips frames in proportion,
+** so it does not hold the others back.
+** Input:
+**		ptSet: Output set
+**		ptImage: Image
+**		nFrontStyle: FRONT_STYLE_* placement on the screen
+**		nFit: OUTPUT_FIT_*
+**		bMaySkip: TRUE = animation frame that slow heads may drop, FALSE =
+**		frame every head must show (first/last frame, static splash)
+** Output: Image output on the screens
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+PresentOutputSet(
+	IN OUT   GOP_OUTPUT_SET                      *ptSet,
+	IN CONST SURFACE                             *ptImage,
+	IN       UINTN                               nFrontStyle,
+	IN       UINTN                               nFit,
+	IN       BOOLEAN                             bMaySkip
+)
+{
+	GOP_OUTPUT *ptOutput;
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	UINT64     nStart;
+	UINT64     nFastest = (UINT64)~0;
+	UINT64     nSkip;
+	UINTN      nOutput;
+	ASSERT_ENSURE(ptSet != NULL && ptImage != NULL && ptImage->ptPixels != NULL);
+	for (nOutput = 0; nOutput < ptSet->nCount; nOutput++)
+	{
+		ptOutput = &ptSet->atOutputs[nOutput];
+		if (bMaySkip == TRUE && ptOutput->nSkip != 0)
+		{
+			ptOutput->nSkip--;
+			continue;
+		}
+		nStart = GetPerformanceCounter();
+		if (PresentToOutput(ptOutput, ptImage, nFrontStyle, nFit) != EFI_SUCCESS ||
+			FlushShadow(ptOutput->ptGraphicsOutput) != EFI_SUCCESS)
+			nStatus = EFI_LOAD_ERROR;
+		ptOutput->nFrameTicks = MAX(GetElapsedTicks(nStart, GetPerformanceCounter()), 1);
+	}
+	for (nOutput = 0; nOutput < ptSet->nCount; nOutput++)
+		nFastest = MIN(nFastest, ptSet->atOutputs[nOutput].nFrameTicks);
+	for (nOutput = 0; nOutput < ptSet->nCount; nOutput++)
+	{
+		ptOutput = &ptSet->atOutputs[nOutput];
+		if (ptOutput->nSkip != 0 || ptOutput->nFrameTicks == 0)
+			continue;
+		nSkip = DivU64x64Remainder(ptOutput->nFrameTicks, nFastest, NULL) - 1;
+		ptOutput->nSkip = (UINTN)MIN(nSkip, GOP_OUTPUT_SKIP_MAX);
+	}
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: DrawImageToOutputSet()
+** Description: Decodes a BMP or QOI image once, applies the image
+** transform set with SetImageTransform() and outputs it on every GOP of
+** the set
+** Input:
+**		ptSet: Output set
+**		pImage: Image itself
+**		nImageSize: Image size
+**		nFrontStyle: FRONT_STYLE_* placement on the screen
+**		nFit: OUTPUT_FIT_*
+** Output: Image output on the screens
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawImageToOutputSet(
+	IN OUT   GOP_OUTPUT_SET                      *ptSet,
+	IN       UINT8                               *pImage,
+	IN       UINTN                               nImageSize,
+	IN       UINTN                               nFrontStyle,
+	IN       UINTN                               nFit
+)
+{
+	SURFACE    tImage;
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptSet != NULL && pImage != NULL && nImageSize >= 4);
+	if (pImage[0] == 'B' && pImage[1] == 'M')
+	{
+		ASSERT_CHECK_EFISTATUS(DecodeBmpImage(pImage, nImageSize, &tImage));
+	}
+	else
+	{
+		ASSERT_CHECK_EFISTATUS(DecodeQoiImage(pImage, nImageSize, &tImage));
+	}
+	nStatus = ApplyImageTransform(&tImage);
+	if (nStatus == EFI_SUCCESS)
+		nStatus = PresentOutputSet(ptSet, &tImage, nFrontStyle, nFit, FALSE);
+	DestroySurface(&tImage);
+	return nStatus;
+}
@@ -0,0 +1,155 @@
+/*
+** ===========================================================================
+** File: GOP_OutputSet.h
+** Description: UEFI graphics-related code module (mirrored output to every
+** GOP in the system)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_OUTPUTSET_H_
+#define _GRAPHICS_GOP_OUTPUTSET_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define GOP_OUTPUT_SET_MAX	8
+
+enum
+{
+	OUTPUT_FIT_CLIP,	/* Native size, clipped to the mode */
+	OUTPUT_FIT_SHRINK,	/* Scaled down to fit the mode if larger, keeping aspect ratio */
+	OUTPUT_FIT_SCALE	/* Scaled up or down to fit the mode, keeping aspect ratio */
+};
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;
+	UINT64                                       nFrameTicks;	/* Cost of the last frame */
+	UINTN                                        nSkip;			/* Frames left to skip */
+} GOP_OUTPUT;
+
+typedef struct {
+	UINTN                                        nCount;
+	GOP_OUTPUT                                   atOutputs[GOP_OUTPUT_SET_MAX];
+} GOP_OUTPUT_SET;
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: OpenGopOutputSet()
+** Description: Collects every GOP in the system into an output set. The
+** console splitter's virtual GOP is only used when no physical one exists,
+** it mirrors to the same heads by itself.
+** Input:
+**		ptSet: Output set to fill
+** Output: Output set
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+OpenGopOutputSet(
+	OUT      GOP_OUTPUT_SET                      *ptSet
+);
+
+/*
+** ===========================================================================
+** Function: CloseGopOutputSet()
+** Description: Releases an output set
+** Input:
+**		ptSet: Output set
+** Output: Empty output set
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CloseGopOutputSet(
+	IN OUT   GOP_OUTPUT_SET                      *ptSet
+);
+
+/*
+** ===========================================================================
+** Function: PresentOutputSet()
+** Description: Outputs one decoded image on every GOP of the set, placed
+** and scaled or clipped per mode. Each head's frame cost is measured; with
+** bMaySkip a head slower than the fastest one skips frames in proportion,
+** so it does not hold the others back.
+** Input:
+**		ptSet: Output set
+**		ptImage: Image
+**		nFrontStyle: FRONT_STYLE_* placement on the screen
+**		nFit: OUTPUT_FIT_*
+**		bMaySkip: TRUE = animation frame that slow heads may drop, FALSE =
+**		frame every head must show (first/last frame, static splash)
+** Output: Image output on the screens
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+PresentOutputSet(
+	IN OUT   GOP_OUTPUT_SET                      *ptSet,
+	IN CONST SURFACE                             *ptImage,
+	IN       UINTN                               nFrontStyle,
+	IN       UINTN                               nFit,
+	IN       BOOLEAN                             bMaySkip
+);
+
+/*
+** ===========================================================================
+** Function: DrawImageToOutputSet()
+** Description: Decodes a BMP or QOI image once, applies the image
+** transform set with SetImageTransform() and outputs it on every GOP of
+** the set
+** Input:
+**		ptSet: Output set
+**		pImage: Image itself
+**		nImageSize: Image size
+**		nFrontStyle: FRONT_STYLE_* placement on the screen
+**		nFit: OUTPUT_FIT_*
+** Output: Image output on the screens
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawImageToOutputSet(
+	IN OUT   GOP_OUTPUT_SET                      *ptSet,
+	IN       UINT8                               *pImage,
+	IN       UINTN                               nImageSize,
+	IN       UINTN                               nFrontStyle,
+	IN       UINTN                               nFit
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_OUTPUTSET_H_ */
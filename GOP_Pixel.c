@@ -0,0 +1,1011 @@
+/*
+** ===========================================================================
+** File: GOP_Pixel.c
+** Description: UEFI graphics-related code module (pixel row kernels)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "GOP_Pixel.h"
+#if defined(GOP_PIXEL_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(GOP_PIXEL_AVX2)
+#include <immintrin.h>
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: GetMaskLayout()
+** Description: Finds position and width of a channel bit mask
+** Input:
+**		nMask: Channel mask
+**		pnShift: Lowest bit of the mask
+**		pnBits: Number of bits in the mask
+** Output: Shift and width
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+GetMaskLayout(
+	IN  UINT32 nMask,
+	OUT UINT8  *pnShift,
+	OUT UINT8  *pnBits
+)
+{
+	*pnShift = 0;
+	*pnBits = 0;
+	if (nMask == 0)
+		return;
+	while ((nMask & 1) == 0)
+	{
+		nMask >>= 1;
+		(*pnShift)++;
+	}
+	while ((nMask & 1) != 0)
+	{
+		nMask >>= 1;
+		(*pnBits)++;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: PackChannel()
+** Description: Scales an 8-bit channel into a bit mask field
+** Input:
+**		nValue: 8-bit value
+**		nShift, nBits: Field layout
+** Output: None
+** Return value: Field value in place
+** ===========================================================================
+*/
+static
+UINT32
+PackChannel(
+	IN UINT8 nValue,
+	IN UINT8 nShift,
+	IN UINT8 nBits
+)
+{
+	if (nBits == 0)
+		return 0;
+	if (nBits <= 8)
+		return ((UINT32)nValue >> (8 - nBits)) << nShift;
+	return ((UINT32)nValue << (nBits - 8)) << nShift;
+}
+
+/*
+** ===========================================================================
+** Function: UnpackChannel()
+** Description: Extracts a bit mask field as an 8-bit channel
+** Input:
+**		nPixel: Packed pixel
+**		nShift, nBits: Field layout
+** Output: None
+** Return value: 8-bit value
+** ===========================================================================
+*/
+static
+UINT8
+UnpackChannel(
+	IN UINT32 nPixel,
+	IN UINT8  nShift,
+	IN UINT8  nBits
+)
+{
+	UINT32 nValue;
+	if (nBits == 0)
+		return 0;
+	nValue = (nPixel >> nShift) & ((1u << nBits) - 1);
+	if (nBits >= 8)
+		return (UINT8)(nValue >> (nBits - 8));
+	/* Replicate the top bits so full intensity stays 0xff */
+	nValue <<= (8 - nBits);
+	return (UINT8)(nValue | (nValue >> nBits));
+}
+
+/*
+** ===========================================================================
+** Function: StreamRow()
+** Description: Writes 32-bit pixels with non-temporal stores, optionally
+** swapping red and blue. Falls back to plain stores without SSE2.
+** Input:
+**		pnDest: Destination (4-byte aligned)
+**		pnSrc: Source pixels
+**		nCount: Number of pixels
+**		bSwizzle: TRUE = swap bytes 0 and 2 of every pixel
+** Output: Written row
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+StreamRow(
+	OUT      UINT32 *pnDest,
+	IN CONST UINT32 *pnSrc,
+	IN       UINTN  nCount,
+	IN       BOOLEAN bSwizzle
+)
+{
+	UINT32 nPixel;
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tMaskGA = _mm_set1_epi32((INT32)0xFF00FF00);
+	__m128i tMaskRB = _mm_set1_epi32(0x00FF00FF);
+	__m128i tPixels;
+	__m128i tRB;
+	/* Scalar head until the destination is 16-byte aligned */
+	while (nCount > 0 && ((UINTN)pnDest & 15) != 0)
+	{
+		nPixel = *pnSrc++;
+		*pnDest++ = bSwizzle ? ((nPixel & 0xFF00FF00) | ((nPixel >> 16) & 0xFF) | ((nPixel & 0xFF) << 16)) : nPixel;
+		nCount--;
+	}
+	for (; nCount >= 4; nCount -= 4, pnSrc += 4, pnDest += 4)
+	{
+		tPixels = _mm_loadu_si128((CONST __m128i *)pnSrc);
+		if (bSwizzle)
+		{
+			tRB = _mm_and_si128(tPixels, tMaskRB);
+			tPixels = _mm_or_si128(_mm_and_si128(tPixels, tMaskGA), _mm_or_si128(_mm_slli_epi32(tRB, 16), _mm_srli_epi32(tRB, 16)));
+		}
+		_mm_stream_si128((__m128i *)pnDest, tPixels);
+	}
+	_mm_sfence();
+#endif
+	while (nCount-- > 0)
+	{
+		nPixel = *pnSrc++;
+		*pnDest++ = bSwizzle ? ((nPixel & 0xFF00FF00) | ((nPixel >> 16) & 0xFF) | ((nPixel & 0xFF) << 16)) : nPixel;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: SwizzleRow()
+** Description: Copies 32-bit pixels swapping red and blue (BGRX <-> RGBX)
+** Input:
+**		pnDest: Destination
+**		pnSrc: Source pixels
+**		nCount: Number of pixels
+** Output: Written row
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+SwizzleRow(
+	OUT      UINT32 *pnDest,
+	IN CONST UINT32 *pnSrc,
+	IN       UINTN  nCount
+)
+{
+	UINT32 nPixel;
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tMaskGA = _mm_set1_epi32((INT32)0xFF00FF00);
+	__m128i tMaskRB = _mm_set1_epi32(0x00FF00FF);
+	__m128i tPixels;
+	__m128i tRB;
+	for (; nCount >= 4; nCount -= 4, pnSrc += 4, pnDest += 4)
+	{
+		tPixels = _mm_loadu_si128((CONST __m128i *)pnSrc);
+		tRB = _mm_and_si128(tPixels, tMaskRB);
+		tPixels = _mm_or_si128(_mm_and_si128(tPixels, tMaskGA), _mm_or_si128(_mm_slli_epi32(tRB, 16), _mm_srli_epi32(tRB, 16)));
+		_mm_storeu_si128((__m128i *)pnDest, tPixels);
+	}
+#endif
+	while (nCount-- > 0)
+	{
+		nPixel = *pnSrc++;
+		*pnDest++ = (nPixel & 0xFF00FF00) | ((nPixel >> 16) & 0xFF) | ((nPixel & 0xFF) << 16);
+	}
+}
+
+/*
+** ===========================================================================
+** Function: InitPixelLayout()
+** Description: Describes how BLT pixels map to the framebuffer of a mode
+** Input:
+**		ptLayout: Layout to fill
+**		ptInfo: GOP mode information
+** Output: Filled layout
+** Return value: FALSE -> No linear framebuffer (PixelBltOnly) or pixels
+** other than 32-bit, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+InitPixelLayout(
+	OUT      PIXEL_LAYOUT                        *ptLayout,
+	IN CONST EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *ptInfo
+)
+{
+	UINT32     nMasks;
+	UINTN      nBits;
+	if (ptLayout == NULL || ptInfo == NULL)
+		return FALSE;
+	ptLayout->nFormat = ptInfo->PixelFormat;
+	ptLayout->nPixelBytes = sizeof(UINT32);
+	switch (ptInfo->PixelFormat) {
+	case PixelBlueGreenRedReserved8BitPerColor:
+		ptLayout->nBlueShift = 0;
+		ptLayout->nGreenShift = 8;
+		ptLayout->nRedShift = 16;
+		ptLayout->nRedBits = ptLayout->nGreenBits = ptLayout->nBlueBits = 8;
+		return TRUE;
+	case PixelRedGreenBlueReserved8BitPerColor:
+		ptLayout->nRedShift = 0;
+		ptLayout->nGreenShift = 8;
+		ptLayout->nBlueShift = 16;
+		ptLayout->nRedBits = ptLayout->nGreenBits = ptLayout->nBlueBits = 8;
+		return TRUE;
+	case PixelBitMask:
+		GetMaskLayout(ptInfo->PixelInformation.RedMask, &ptLayout->nRedShift, &ptLayout->nRedBits);
+		GetMaskLayout(ptInfo->PixelInformation.GreenMask, &ptLayout->nGreenShift, &ptLayout->nGreenBits);
+		GetMaskLayout(ptInfo->PixelInformation.BlueMask, &ptLayout->nBlueShift, &ptLayout->nBlueBits);
+		/* The pixel size is given by the highest mask bit (e.g. 16 for 5:6:5),
+		only 32-bit pixels are written directly */
+		nMasks = ptInfo->PixelInformation.RedMask | ptInfo->PixelInformation.GreenMask |
+			ptInfo->PixelInformation.BlueMask | ptInfo->PixelInformation.ReservedMask;
+		for (nBits = 0; nMasks != 0; nBits++)
+			nMasks >>= 1;
+		ptLayout->nPixelBytes = (UINT8)((nBits + 7) / 8);
+		return (BOOLEAN)(ptLayout->nPixelBytes == sizeof(UINT32));
+	default:
+		return FALSE;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: PackPixel()
+** Description: Converts one BLT pixel to its framebuffer representation
+** Input:
+**		ptLayout: Framebuffer layout
+**		ptPixel: BLT pixel
+** Output: None
+** Return value: Framebuffer pixel value
+** ===========================================================================
+*/
+UINT32
+EFIAPI
+PackPixel(
+	IN CONST PIXEL_LAYOUT                        *ptLayout,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptPixel
+)
+{
+	return PackChannel(ptPixel->Red, ptLayout->nRedShift, ptLayout->nRedBits) |
+		PackChannel(ptPixel->Green, ptLayout->nGreenShift, ptLayout->nGreenBits) |
+		PackChannel(ptPixel->Blue, ptLayout->nBlueShift, ptLayout->nBlueBits);
+}
+
+/*
+** ===========================================================================
+** Function: WritePixelRow()
+** Description: Writes a row of BLT pixels to framebuffer memory using the
+** kernel that matches the pixel format: plain copy for BGR, SIMD swizzle for
+** RGB, per-field packing for bit masks
+** Input:
+**		ptLayout: Framebuffer layout
+**		pDest: Framebuffer address of the first pixel
+**		ptSrc: BLT pixels
+**		nCount: Number of pixels
+**		bStream: TRUE = use non-temporal stores (BGR/RGB only)
+** Output: Written framebuffer row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+WritePixelRow(
+	IN CONST PIXEL_LAYOUT                        *ptLayout,
+	OUT      VOID                                *pDest,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptSrc,
+	IN       UINTN                               nCount,
+	IN       BOOLEAN                             bStream
+)
+{
+	UINT32  *pnDest = (UINT32 *)pDest;
+	switch (ptLayout->nFormat) {
+	case PixelBlueGreenRedReserved8BitPerColor:
+		if (bStream)
+			StreamRow(pnDest, (CONST UINT32 *)ptSrc, nCount, FALSE);
+		else
+			CopyMem(pnDest, ptSrc, nCount * sizeof(UINT32));
+		break;
+	case PixelRedGreenBlueReserved8BitPerColor:
+		if (bStream)
+			StreamRow(pnDest, (CONST UINT32 *)ptSrc, nCount, TRUE);
+		else
+			SwizzleRow(pnDest, (CONST UINT32 *)ptSrc, nCount);
+		break;
+	default:
+		while (nCount-- > 0)
+			*pnDest++ = PackPixel(ptLayout, ptSrc++);
+		break;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: ReadPixelRow()
+** Description: Reads a row of framebuffer memory back as BLT pixels
+** Input:
+**		ptLayout: Framebuffer layout
+**		ptDest: BLT pixels
+**		pSrc: Framebuffer address of the first pixel
+**		nCount: Number of pixels
+** Output: Filled BLT row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+ReadPixelRow(
+	IN CONST PIXEL_LAYOUT                        *ptLayout,
+	OUT      EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptDest,
+	IN CONST VOID                                *pSrc,
+	IN       UINTN                               nCount
+)
+{
+	CONST UINT32 *pnSrc = (CONST UINT32 *)pSrc;
+	switch (ptLayout->nFormat) {
+	case PixelBlueGreenRedReserved8BitPerColor:
+		CopyMem(ptDest, pnSrc, nCount * sizeof(UINT32));
+		break;
+	case PixelRedGreenBlueReserved8BitPerColor:
+		SwizzleRow((UINT32 *)ptDest, pnSrc, nCount);
+		break;
+	default:
+		for (; nCount > 0; nCount--, pnSrc++, ptDest++)
+		{
+			ptDest->Red = UnpackChannel(*pnSrc, ptLayout->nRedShift, ptLayout->nRedBits);
+			ptDest->Green = UnpackChannel(*pnSrc, ptLayout->nGreenShift, ptLayout->nGreenBits);
+			ptDest->Blue = UnpackChannel(*pnSrc, ptLayout->nBlueShift, ptLayout->nBlueBits);
+			ptDest->Reserved = 0;
+		}
+		break;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: FillPixelRow()
+** Description: Fills a framebuffer row with one packed pixel value
+** Input:
+**		pDest: Framebuffer address of the first pixel
+**		nValue: Packed pixel (see PackPixel())
+**		nCount: Number of pixels
+**		bStream: TRUE = use non-temporal stores
+** Output: Filled framebuffer row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+FillPixelRow(
+	OUT      VOID                                *pDest,
+	IN       UINT32                              nValue,
+	IN       UINTN                               nCount,
+	IN       BOOLEAN                             bStream
+)
+{
+	UINT32  *pnDest = (UINT32 *)pDest;
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tValue;
+	if (bStream)
+	{
+		tValue = _mm_set1_epi32((INT32)nValue);
+		while (nCount > 0 && ((UINTN)pnDest & 15) != 0)
+		{
+			*pnDest++ = nValue;
+			nCount--;
+		}
+		for (; nCount >= 4; nCount -= 4, pnDest += 4)
+			_mm_stream_si128((__m128i *)pnDest, tValue);
+		_mm_sfence();
+	}
+#endif
+	SetMem32(pnDest, nCount * sizeof(UINT32), nValue);
+}
+
+/*
+** ===========================================================================
+** Function: LerpPixelRow()
+** Description: Blends two pixel rows channel by channel (all four bytes),
+** Dest = (A * (256 - nWeight) + B * nWeight + 128) / 256
+** Input:
+**		pnDest: Destination pixels (may be pnA or pnB)
+**		pnA, pnB: Source pixels
+**		nWeight: Weight of B, 0..256
+**		nCount: Number of pixels
+** Output: Blended row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+LerpPixelRow(
+	OUT      UINT32                              *pnDest,
+	IN CONST UINT32                              *pnA,
+	IN CONST UINT32                              *pnB,
+	IN       UINT32                              nWeight,
+	IN       UINTN                               nCount
+)
+{
+	UINT32     nInverse = 256 - nWeight;
+	UINT32     nA;
+	UINT32     nB;
+#if defined(GOP_PIXEL_AVX2)
+	__m256i tZero8 = _mm256_setzero_si256();
+	__m256i tWeightA8 = _mm256_set1_epi16((INT16)nInverse);
+	__m256i tWeightB8 = _mm256_set1_epi16((INT16)nWeight);
+	__m256i tRound8 = _mm256_set1_epi16(128);
+	__m256i tA8;
+	__m256i tB8;
+	__m256i tLo8;
+	__m256i tHi8;
+	/* Every 16-bit lane holds at most 255 * 256 + 128, so the sums cannot
+	carry into the neighbouring channel */
+	for (; nCount >= 8; nCount -= 8, pnA += 8, pnB += 8, pnDest += 8)
+	{
+		tA8 = _mm256_loadu_si256((CONST __m256i *)pnA);
+		tB8 = _mm256_loadu_si256((CONST __m256i *)pnB);
+		tLo8 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(tA8, tZero8), tWeightA8),
+			_mm256_mullo_epi16(_mm256_unpacklo_epi8(tB8, tZero8), tWeightB8));
+		tHi8 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(tA8, tZero8), tWeightA8),
+			_mm256_mullo_epi16(_mm256_unpackhi_epi8(tB8, tZero8), tWeightB8));
+		tLo8 = _mm256_srli_epi16(_mm256_add_epi16(tLo8, tRound8), 8);
+		tHi8 = _mm256_srli_epi16(_mm256_add_epi16(tHi8, tRound8), 8);
+		_mm256_storeu_si256((__m256i *)pnDest, _mm256_packus_epi16(tLo8, tHi8));
+	}
+#endif
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tZero = _mm_setzero_si128();
+	__m128i tWeightA = _mm_set1_epi16((INT16)nInverse);
+	__m128i tWeightB = _mm_set1_epi16((INT16)nWeight);
+	__m128i tRound = _mm_set1_epi16(128);
+	__m128i tA;
+	__m128i tB;
+	__m128i tLo;
+	__m128i tHi;
+	for (; nCount >= 4; nCount -= 4, pnA += 4, pnB += 4, pnDest += 4)
+	{
+		tA = _mm_loadu_si128((CONST __m128i *)pnA);
+		tB = _mm_loadu_si128((CONST __m128i *)pnB);
+		tLo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(tA, tZero), tWeightA),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(tB, tZero), tWeightB));
+		tHi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(tA, tZero), tWeightA),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(tB, tZero), tWeightB));
+		tLo = _mm_srli_epi16(_mm_add_epi16(tLo, tRound), 8);
+		tHi = _mm_srli_epi16(_mm_add_epi16(tHi, tRound), 8);
+		_mm_storeu_si128((__m128i *)pnDest, _mm_packus_epi16(tLo, tHi));
+	}
+#endif
+	for (; nCount > 0; nCount--)
+	{
+		nA = *pnA++;
+		nB = *pnB++;
+		*pnDest++ = ((((nA & 0x00FF00FF) * nInverse + (nB & 0x00FF00FF) * nWeight + 0x00800080) >> 8) & 0x00FF00FF) |
+			((((nA >> 8) & 0x00FF00FF) * nInverse + ((nB >> 8) & 0x00FF00FF) * nWeight + 0x00800080) & 0xFF00FF00);
+	}
+}
+
+/*
+** ===========================================================================
+** Function: ScalePixelRow()
+** Description: Multiplies all four channels of a pixel row by nAlpha / 255,
+** rounded to nearest. The division is done as (x * a + 128) * 257 >> 16,
+** which is exact for 8-bit values.
+** Input:
+**		pnDest: Destination pixels (may be pnSrc)
+**		pnSrc: Source pixels
+**		nAlpha: Factor, 0..255
+**		nCount: Number of pixels
+** Output: Scaled row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+ScalePixelRow(
+	OUT      UINT32                              *pnDest,
+	IN CONST UINT32                              *pnSrc,
+	IN       UINT32                              nAlpha,
+	IN       UINTN                               nCount
+)
+{
+	UINT32     nPixel;
+	UINT32     nEven;
+	UINT32     nOdd;
+#if defined(GOP_PIXEL_AVX2)
+	__m256i tZero8 = _mm256_setzero_si256();
+	__m256i tAlpha8 = _mm256_set1_epi16((INT16)nAlpha);
+	__m256i tRound8 = _mm256_set1_epi16(128);
+	__m256i tScale8 = _mm256_set1_epi16(257);
+	__m256i tSrc8;
+	__m256i tLo8;
+	__m256i tHi8;
+	/* x * a + 128 stays below 65536, the high half of the product with 257
+	is the shifted result */
+	for (; nCount >= 8; nCount -= 8, pnSrc += 8, pnDest += 8)
+	{
+		tSrc8 = _mm256_loadu_si256((CONST __m256i *)pnSrc);
+		tLo8 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(tSrc8, tZero8), tAlpha8), tRound8);
+		tHi8 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(tSrc8, tZero8), tAlpha8), tRound8);
+		tLo8 = _mm256_mulhi_epu16(tLo8, tScale8);
+		tHi8 = _mm256_mulhi_epu16(tHi8, tScale8);
+		_mm256_storeu_si256((__m256i *)pnDest, _mm256_packus_epi16(tLo8, tHi8));
+	}
+#endif
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tZero = _mm_setzero_si128();
+	__m128i tAlpha = _mm_set1_epi16((INT16)nAlpha);
+	__m128i tRound = _mm_set1_epi16(128);
+	__m128i tScale = _mm_set1_epi16(257);
+	__m128i tSrc;
+	__m128i tLo;
+	__m128i tHi;
+	for (; nCount >= 4; nCount -= 4, pnSrc += 4, pnDest += 4)
+	{
+		tSrc = _mm_loadu_si128((CONST __m128i *)pnSrc);
+		tLo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(tSrc, tZero), tAlpha), tRound);
+		tHi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(tSrc, tZero), tAlpha), tRound);
+		tLo = _mm_mulhi_epu16(tLo, tScale);
+		tHi = _mm_mulhi_epu16(tHi, tScale);
+		_mm_storeu_si128((__m128i *)pnDest, _mm_packus_epi16(tLo, tHi));
+	}
+#endif
+	/* Two channels per multiply, (t + (t >> 8)) >> 8 equals t * 257 >> 16
+	for every t reached here */
+	for (; nCount > 0; nCount--)
+	{
+		nPixel = *pnSrc++;
+		nEven = (nPixel & 0x00FF00FF) * nAlpha + 0x00800080;
+		nOdd = ((nPixel >> 8) & 0x00FF00FF) * nAlpha + 0x00800080;
+		nEven = ((nEven + ((nEven >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+		nOdd = (nOdd + ((nOdd >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+		*pnDest++ = nEven | nOdd;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: AccumulatePixelRow()
+** Description: Adds the channels of a pixel row to per-channel sums, four
+** sums per pixel in memory order (blue, green, red, reserved)
+** Input:
+**		pnSums: Channel sums, 4 * nCount entries
+**		ptSrc: Source pixels
+**		nCount: Number of pixels
+** Output: Updated sums
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+AccumulatePixelRow(
+	IN OUT   UINT32                              *pnSums,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptSrc,
+	IN       UINTN                               nCount
+)
+{
+	CONST UINT8 *pSrc = (CONST UINT8 *)ptSrc;
+	UINTN      nIndex;
+#if defined(GOP_PIXEL_AVX2)
+	__m256i tSums8;
+	for (; nCount >= 2; nCount -= 2, pSrc += 8, pnSums += 8)
+	{
+		tSums8 = _mm256_loadu_si256((CONST __m256i *)pnSums);
+		tSums8 = _mm256_add_epi32(tSums8, _mm256_cvtepu8_epi32(_mm_loadl_epi64((CONST __m128i *)pSrc)));
+		_mm256_storeu_si256((__m256i *)pnSums, tSums8);
+	}
+#elif defined(GOP_PIXEL_SSE2)
+	__m128i tZero = _mm_setzero_si128();
+	__m128i tPixels;
+	__m128i tLo;
+	__m128i tHi;
+	for (; nCount >= 4; nCount -= 4, pSrc += 16, pnSums += 16)
+	{
+		tPixels = _mm_loadu_si128((CONST __m128i *)pSrc);
+		tLo = _mm_unpacklo_epi8(tPixels, tZero);
+		tHi = _mm_unpackhi_epi8(tPixels, tZero);
+		_mm_storeu_si128((__m128i *)pnSums, _mm_add_epi32(_mm_loadu_si128((CONST __m128i *)pnSums), _mm_unpacklo_epi16(tLo, tZero)));
+		_mm_storeu_si128((__m128i *)(pnSums + 4), _mm_add_epi32(_mm_loadu_si128((CONST __m128i *)(pnSums + 4)), _mm_unpackhi_epi16(tLo, tZero)));
+		_mm_storeu_si128((__m128i *)(pnSums + 8), _mm_add_epi32(_mm_loadu_si128((CONST __m128i *)(pnSums + 8)), _mm_unpacklo_epi16(tHi, tZero)));
+		_mm_storeu_si128((__m128i *)(pnSums + 12), _mm_add_epi32(_mm_loadu_si128((CONST __m128i *)(pnSums + 12)), _mm_unpackhi_epi16(tHi, tZero)));
+	}
+#endif
+	for (nIndex = 0; nIndex < nCount * 4; nIndex++)
+		pnSums[nIndex] += pSrc[nIndex];
+}
+
+/*
+** ===========================================================================
+** Function: PremultiplyPixelRow()
+** Description: Multiplies the color channels of a row by its alpha (the
+** Reserved byte), optionally converting RGBA byte order to BGRA first
+** Input:
+**		ptPixels: Pixels, converted in place
+**		nCount: Number of pixels
+**		bSwapRedBlue: TRUE = input is RGBA (e.g. from qoi_decode())
+** Output: Premultiplied BGRA row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+PremultiplyPixelRow(
+	IN OUT   EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptPixels,
+	IN       UINTN                               nCount,
+	IN       BOOLEAN                             bSwapRedBlue
+)
+{
+	UINT32     *pnPixels = (UINT32 *)ptPixels;
+	UINT32     nPixel;
+	UINT32     nAlpha;
+	UINT32     nRB;
+	UINT32     nG;
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tZero = _mm_setzero_si128();
+	__m128i tRound = _mm_set1_epi16(128);
+	__m128i tAlphaOnly = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	__m128i tMaskGA = _mm_set1_epi32((INT32)0xFF00FF00);
+	__m128i tMaskRB = _mm_set1_epi32(0x00FF00FF);
+	__m128i tPixels;
+	__m128i tRB;
+	__m128i tLo;
+	__m128i tHi;
+	__m128i tAlphaLo;
+	__m128i tAlphaHi;
+	for (; nCount >= 4; nCount -= 4, pnPixels += 4)
+	{
+		tPixels = _mm_loadu_si128((CONST __m128i *)pnPixels);
+		if (bSwapRedBlue)
+		{
+			tRB = _mm_and_si128(tPixels, tMaskRB);
+			tPixels = _mm_or_si128(_mm_and_si128(tPixels, tMaskGA), _mm_or_si128(_mm_slli_epi32(tRB, 16), _mm_srli_epi32(tRB, 16)));
+		}
+		tLo = _mm_unpacklo_epi8(tPixels, tZero);
+		tHi = _mm_unpackhi_epi8(tPixels, tZero);
+		tAlphaLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(tLo, 0xFF), 0xFF);
+		tAlphaHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(tHi, 0xFF), 0xFF);
+		/* Alpha lanes multiply by 255 so they come out unchanged */
+		tAlphaLo = _mm_or_si128(_mm_andnot_si128(tAlphaOnly, tAlphaLo), _mm_and_si128(tAlphaOnly, _mm_set1_epi16(255)));
+		tAlphaHi = _mm_or_si128(_mm_andnot_si128(tAlphaOnly, tAlphaHi), _mm_and_si128(tAlphaOnly, _mm_set1_epi16(255)));
+		/* x * a / 255 as (t + (t >> 8)) >> 8 with t = x * a + 128 */
+		tLo = _mm_add_epi16(_mm_mullo_epi16(tLo, tAlphaLo), tRound);
+		tHi = _mm_add_epi16(_mm_mullo_epi16(tHi, tAlphaHi), tRound);
+		tLo = _mm_srli_epi16(_mm_add_epi16(tLo, _mm_srli_epi16(tLo, 8)), 8);
+		tHi = _mm_srli_epi16(_mm_add_epi16(tHi, _mm_srli_epi16(tHi, 8)), 8);
+		_mm_storeu_si128((__m128i *)pnPixels, _mm_packus_epi16(tLo, tHi));
+	}
+#endif
+	for (; nCount > 0; nCount--, pnPixels++)
+	{
+		nPixel = *pnPixels;
+		if (bSwapRedBlue)
+			nPixel = (nPixel & 0xFF00FF00) | ((nPixel >> 16) & 0xFF) | ((nPixel & 0xFF) << 16);
+		nAlpha = nPixel >> 24;
+		nRB = (nPixel & 0x00FF00FF) * nAlpha + 0x00800080;
+		nRB = ((nRB + ((nRB >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+		nG = ((nPixel >> 8) & 0xFF) * nAlpha + 0x80;
+		nG = ((nG + (nG >> 8)) >> 8) & 0xFF;
+		*pnPixels = (nAlpha << 24) | (nG << 8) | nRB;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: BlendPixelRow()
+** Description: Composites premultiplied BGRA pixels over a row ("source
+** over": Dest = Src + Dest * (255 - SrcAlpha) / 255). Groups of fully
+** opaque pixels are copied and fully transparent ones skipped.
+** Input:
+**		pnDest: Destination pixels
+**		pnSrc: Premultiplied source pixels
+**		nCount: Number of pixels
+** Output: Composited row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+BlendPixelRow(
+	IN OUT   UINT32                              *pnDest,
+	IN CONST UINT32                              *pnSrc,
+	IN       UINTN                               nCount
+)
+{
+	UINT32     nPixel;
+	UINT32     nInverse;
+	UINT32     nRB;
+	UINT32     nGA;
+#if defined(GOP_PIXEL_AVX2)
+	__m256i tZero8 = _mm256_setzero_si256();
+	__m256i tRound8 = _mm256_set1_epi16(128);
+	__m256i tAlphaMask8 = _mm256_set1_epi32((INT32)0xFF000000);
+	__m256i tOnes8 = _mm256_set1_epi16(255);
+	__m256i tSrc8;
+	__m256i tDest8;
+	__m256i tAlpha8;
+	__m256i tLo8;
+	__m256i tHi8;
+	for (; nCount >= 8; nCount -= 8, pnSrc += 8, pnDest += 8)
+	{
+		tSrc8 = _mm256_loadu_si256((CONST __m256i *)pnSrc);
+		tAlpha8 = _mm256_and_si256(tSrc8, tAlphaMask8);
+		if (_mm256_testz_si256(tAlpha8, tAlpha8))
+			continue;
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(tAlpha8, tAlphaMask8)) == -1)
+		{
+			_mm256_storeu_si256((__m256i *)pnDest, tSrc8);
+			continue;
+		}
+		tDest8 = _mm256_loadu_si256((CONST __m256i *)pnDest);
+		tLo8 = _mm256_unpacklo_epi8(tSrc8, tZero8);
+		tHi8 = _mm256_unpackhi_epi8(tSrc8, tZero8);
+		tLo8 = _mm256_sub_epi16(tOnes8, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(tLo8, 0xFF), 0xFF));
+		tHi8 = _mm256_sub_epi16(tOnes8, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(tHi8, 0xFF), 0xFF));
+		tLo8 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(tDest8, tZero8), tLo8), tRound8);
+		tHi8 = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(tDest8, tZero8), tHi8), tRound8);
+		tLo8 = _mm256_srli_epi16(_mm256_add_epi16(tLo8, _mm256_srli_epi16(tLo8, 8)), 8);
+		tHi8 = _mm256_srli_epi16(_mm256_add_epi16(tHi8, _mm256_srli_epi16(tHi8, 8)), 8);
+		_mm256_storeu_si256((__m256i *)pnDest, _mm256_adds_epu8(tSrc8, _mm256_packus_epi16(tLo8, tHi8)));
+	}
+#endif
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tZero = _mm_setzero_si128();
+	__m128i tRound = _mm_set1_epi16(128);
+	__m128i tAlphaMask = _mm_set1_epi32((INT32)0xFF000000);
+	__m128i tOnes = _mm_set1_epi16(255);
+	__m128i tSrc;
+	__m128i tDest;
+	__m128i tAlpha;
+	__m128i tLo;
+	__m128i tHi;
+	for (; nCount >= 4; nCount -= 4, pnSrc += 4, pnDest += 4)
+	{
+		tSrc = _mm_loadu_si128((CONST __m128i *)pnSrc);
+		tAlpha = _mm_and_si128(tSrc, tAlphaMask);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(tAlpha, tZero)) == 0xFFFF)
+			continue;
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(tAlpha, tAlphaMask)) == 0xFFFF)
+		{
+			_mm_storeu_si128((__m128i *)pnDest, tSrc);
+			continue;
+		}
+		tDest = _mm_loadu_si128((CONST __m128i *)pnDest);
+		tLo = _mm_unpacklo_epi8(tSrc, tZero);
+		tHi = _mm_unpackhi_epi8(tSrc, tZero);
+		tLo = _mm_sub_epi16(tOnes, _mm_shufflehi_epi16(_mm_shufflelo_epi16(tLo, 0xFF), 0xFF));
+		tHi = _mm_sub_epi16(tOnes, _mm_shufflehi_epi16(_mm_shufflelo_epi16(tHi, 0xFF), 0xFF));
+		tLo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(tDest, tZero), tLo), tRound);
+		tHi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(tDest, tZero), tHi), tRound);
+		tLo = _mm_srli_epi16(_mm_add_epi16(tLo, _mm_srli_epi16(tLo, 8)), 8);
+		tHi = _mm_srli_epi16(_mm_add_epi16(tHi, _mm_srli_epi16(tHi, 8)), 8);
+		_mm_storeu_si128((__m128i *)pnDest, _mm_adds_epu8(tSrc, _mm_packus_epi16(tLo, tHi)));
+	}
+#endif
+	for (; nCount > 0; nCount--, pnSrc++, pnDest++)
+	{
+		nPixel = *pnSrc;
+		if (nPixel < 0x01000000)
+			continue;
+		if (nPixel >= 0xFF000000)
+		{
+			*pnDest = nPixel;
+			continue;
+		}
+		nInverse = 255 - (nPixel >> 24);
+		nRB = (*pnDest & 0x00FF00FF) * nInverse + 0x00800080;
+		nRB = ((nRB + ((nRB >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+		nGA = ((*pnDest >> 8) & 0x00FF00FF) * nInverse + 0x00800080;
+		nGA = (nGA + ((nGA >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+		*pnDest = nPixel + (nRB | nGA);
+	}
+}
+
+/*
+** ===========================================================================
+** Function: BoxBlurPixelRow()
+** Description: Box-filters a pixel row with a sliding window, so the cost
+** per pixel does not depend on the radius. Edge pixels are repeated past
+** both ends. Channel sums are kept in 16 bits, which bounds the window to
+** 255 pixels.
+** Input:
+**		pnDest: Destination pixels (not pnSrc)
+**		pnSrc: Source pixels
+**		nCount: Number of pixels
+**		nRadius: Window radius, 1..127
+**		nScale: 65536 / (2 * nRadius + 1), rounded down
+** Output: Blurred row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+BoxBlurPixelRow(
+	OUT      UINT32                              *pnDest,
+	IN CONST UINT32                              *pnSrc,
+	IN       UINTN                               nCount,
+	IN       UINTN                               nRadius,
+	IN       UINT16                              nScale
+)
+{
+	UINTN      nX;
+	UINTN      nIndex;
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tZero = _mm_setzero_si128();
+	__m128i tScale = _mm_set1_epi16((INT16)nScale);
+	__m128i tSum;
+	/* Half the window as rounding bias, one pixel in the low four lanes */
+	tSum = _mm_set1_epi16((INT16)nRadius);
+	for (nIndex = 0; nIndex <= 2 * nRadius; nIndex++)
+		tSum = _mm_add_epi16(tSum, _mm_unpacklo_epi8(_mm_cvtsi32_si128((INT32)pnSrc[(nIndex <= nRadius) ? 0 : MIN(nIndex - nRadius, nCount - 1)]), tZero));
+	for (nX = 0; nX < nCount; nX++)
+	{
+		pnDest[nX] = (UINT32)_mm_cvtsi128_si32(_mm_packus_epi16(_mm_mulhi_epu16(tSum, tScale), tZero));
+		tSum = _mm_add_epi16(tSum, _mm_unpacklo_epi8(_mm_cvtsi32_si128((INT32)pnSrc[MIN(nX + nRadius + 1, nCount - 1)]), tZero));
+		tSum = _mm_sub_epi16(tSum, _mm_unpacklo_epi8(_mm_cvtsi32_si128((INT32)pnSrc[(nX >= nRadius) ? nX - nRadius : 0]), tZero));
+	}
+#else
+	UINT32     anSum[4];
+	UINT32     nPixel;
+	UINTN      nChannel;
+	for (nChannel = 0; nChannel < 4; nChannel++)
+		anSum[nChannel] = (UINT32)nRadius;
+	for (nIndex = 0; nIndex <= 2 * nRadius; nIndex++)
+	{
+		nPixel = pnSrc[(nIndex <= nRadius) ? 0 : MIN(nIndex - nRadius, nCount - 1)];
+		for (nChannel = 0; nChannel < 4; nChannel++)
+			anSum[nChannel] += (nPixel >> (8 * nChannel)) & 0xFF;
+	}
+	for (nX = 0; nX < nCount; nX++)
+	{
+		pnDest[nX] = ((anSum[0] * nScale) >> 16) | (((anSum[1] * nScale) >> 16) << 8) |
+			(((anSum[2] * nScale) >> 16) << 16) | (((anSum[3] * nScale) >> 16) << 24);
+		nPixel = pnSrc[MIN(nX + nRadius + 1, nCount - 1)];
+		for (nChannel = 0; nChannel < 4; nChannel++)
+			anSum[nChannel] += (nPixel >> (8 * nChannel)) & 0xFF;
+		nPixel = pnSrc[(nX >= nRadius) ? nX - nRadius : 0];
+		for (nChannel = 0; nChannel < 4; nChannel++)
+			anSum[nChannel] -= (nPixel >> (8 * nChannel)) & 0xFF;
+	}
+#endif
+}
+
+/*
+** ===========================================================================
+** Function: BoxBlurColumnRow()
+** Description: One step of a vertical sliding-window box filter over a
+** whole row at once: outputs the row for the current window sums, then
+** slides the window by adding the row entering it and subtracting the row
+** leaving it
+** Input:
+**		pnDest: Output row, NULL = none (while filling the first window)
+**		pnSums: 16-bit channel sums, 4 * nCount entries, in pixel memory
+**		order; start them at the rounding bias (window / 2)
+**		pnAdd: Row entering the window
+**		pnSub: Row leaving the window, NULL = none
+**		nCount: Number of pixels
+**		nScale: 65536 / window, rounded down
+** Output: Output row, updated sums
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+BoxBlurColumnRow(
+	OUT      UINT32                              *pnDest OPTIONAL,
+	IN OUT   UINT16                              *pnSums,
+	IN CONST UINT32                              *pnAdd,
+	IN CONST UINT32                              *pnSub OPTIONAL,
+	IN       UINTN                               nCount,
+	IN       UINT16                              nScale
+)
+{
+	UINTN      nX = 0;
+	UINTN      nChannel;
+#if defined(GOP_PIXEL_AVX2)
+	__m256i tScale8 = _mm256_set1_epi16((INT16)nScale);
+	__m256i tSum8;
+	__m256i tOut8;
+	/* Four pixels widened to sixteen 16-bit lanes in memory order */
+	for (; nX + 4 <= nCount; nX += 4)
+	{
+		tSum8 = _mm256_loadu_si256((CONST __m256i *)(pnSums + 4 * nX));
+		if (pnDest != NULL)
+		{
+			tOut8 = _mm256_mulhi_epu16(tSum8, tScale8);
+			_mm_storeu_si128((__m128i *)(pnDest + nX),
+				_mm_packus_epi16(_mm256_castsi256_si128(tOut8), _mm256_extracti128_si256(tOut8, 1)));
+		}
+		tSum8 = _mm256_add_epi16(tSum8, _mm256_cvtepu8_epi16(_mm_loadu_si128((CONST __m128i *)(pnAdd + nX))));
+		if (pnSub != NULL)
+			tSum8 = _mm256_sub_epi16(tSum8, _mm256_cvtepu8_epi16(_mm_loadu_si128((CONST __m128i *)(pnSub + nX))));
+		_mm256_storeu_si256((__m256i *)(pnSums + 4 * nX), tSum8);
+	}
+#endif
+#if defined(GOP_PIXEL_SSE2)
+	__m128i tZero = _mm_setzero_si128();
+	__m128i tScale = _mm_set1_epi16((INT16)nScale);
+	__m128i tPixels;
+	__m128i tLo;
+	__m128i tHi;
+	for (; nX + 4 <= nCount; nX += 4)
+	{
+		tLo = _mm_loadu_si128((CONST __m128i *)(pnSums + 4 * nX));
+		tHi = _mm_loadu_si128((CONST __m128i *)(pnSums + 4 * nX + 8));
+		if (pnDest != NULL)
+			_mm_storeu_si128((__m128i *)(pnDest + nX), _mm_packus_epi16(_mm_mulhi_epu16(tLo, tScale), _mm_mulhi_epu16(tHi, tScale)));
+		tPixels = _mm_loadu_si128((CONST __m128i *)(pnAdd + nX));
+		tLo = _mm_add_epi16(tLo, _mm_unpacklo_epi8(tPixels, tZero));
+		tHi = _mm_add_epi16(tHi, _mm_unpackhi_epi8(tPixels, tZero));
+		if (pnSub != NULL)
+		{
+			tPixels = _mm_loadu_si128((CONST __m128i *)(pnSub + nX));
+			tLo = _mm_sub_epi16(tLo, _mm_unpacklo_epi8(tPixels, tZero));
+			tHi = _mm_sub_epi16(tHi, _mm_unpackhi_epi8(tPixels, tZero));
+		}
+		_mm_storeu_si128((__m128i *)(pnSums + 4 * nX), tLo);
+		_mm_storeu_si128((__m128i *)(pnSums + 4 * nX + 8), tHi);
+	}
+#endif
+	for (; nX < nCount; nX++)
+	{
+		if (pnDest != NULL)
+		{
+			pnDest[nX] = 0;
+			for (nChannel = 0; nChannel < 4; nChannel++)
+				pnDest[nX] |= (((UINT32)pnSums[4 * nX + nChannel] * nScale) >> 16) << (8 * nChannel);
+		}
+		for (nChannel = 0; nChannel < 4; nChannel++)
+		{
+			pnSums[4 * nX + nChannel] += (UINT16)((pnAdd[nX] >> (8 * nChannel)) & 0xFF);
+			if (pnSub != NULL)
+				pnSums[4 * nX + nChannel] -= (UINT16)((pnSub[nX] >> (8 * nChannel)) & 0xFF);
+		}
+	}
+}
@@ -0,0 +1,348 @@
+/*
+** ===========================================================================
+** File: GOP_Pixel.h
+** Description: UEFI graphics-related code module (pixel row kernels)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_PIXEL_H_
+#define _GRAPHICS_GOP_PIXEL_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Protocol/GraphicsOutput.h>
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/* SSE2 kernels are used when the compiler targets it (always true on X64),
+define GOP_PIXEL_NO_SIMD to build the portable C kernels only */
+#if !defined(GOP_PIXEL_NO_SIMD) && (defined(MDE_CPU_X64) || defined(MDE_CPU_IA32))
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define GOP_PIXEL_SSE2 1
+#endif
+#if defined(__AVX2__)
+#define GOP_PIXEL_AVX2 1
+#endif
+#endif
+/* Rows at least this long are written with non-temporal stores on the
+streaming output path */
+#define GOP_PIXEL_STREAM_MIN_BYTES	2048
+
+#pragma pack(1)
+typedef struct {
+	EFI_GRAPHICS_PIXEL_FORMAT	nFormat;
+	UINT8						nRedShift;
+	UINT8						nRedBits;
+	UINT8						nGreenShift;
+	UINT8						nGreenBits;
+	UINT8						nBlueShift;
+	UINT8						nBlueBits;
+	UINT8						nPixelBytes;	/* Framebuffer bytes per pixel */
+} PIXEL_LAYOUT;
+#pragma pack()
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: InitPixelLayout()
+** Description: Describes how BLT pixels map to the framebuffer of a mode
+** Input:
+**		ptLayout: Layout to fill
+**		ptInfo: GOP mode information
+** Output: Filled layout
+** Return value: FALSE -> No linear framebuffer (PixelBltOnly) or pixels
+** other than 32-bit, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+InitPixelLayout(
+	OUT      PIXEL_LAYOUT                        *ptLayout,
+	IN CONST EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *ptInfo
+);
+
+/*
+** ===========================================================================
+** Function: PackPixel()
+** Description: Converts one BLT pixel to its framebuffer representation
+** Input:
+**		ptLayout: Framebuffer layout
+**		ptPixel: BLT pixel
+** Output: None
+** Return value: Framebuffer pixel value
+** ===========================================================================
+*/
+UINT32
+EFIAPI
+PackPixel(
+	IN CONST PIXEL_LAYOUT                        *ptLayout,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptPixel
+);
+
+/*
+** ===========================================================================
+** Function: WritePixelRow()
+** Description: Writes a row of BLT pixels to framebuffer memory using the
+** kernel that matches the pixel format: plain copy for BGR, SIMD swizzle for
+** RGB, per-field packing for bit masks
+** Input:
+**		ptLayout: Framebuffer layout
+**		pDest: Framebuffer address of the first pixel
+**		ptSrc: BLT pixels
+**		nCount: Number of pixels
+**		bStream: TRUE = use non-temporal stores (BGR/RGB only)
+** Output: Written framebuffer row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+WritePixelRow(
+	IN CONST PIXEL_LAYOUT                        *ptLayout,
+	OUT      VOID                                *pDest,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptSrc,
+	IN       UINTN                               nCount,
+	IN       BOOLEAN                             bStream
+);
+
+/*
+** ===========================================================================
+** Function: ReadPixelRow()
+** Description: Reads a row of framebuffer memory back as BLT pixels
+** Input:
+**		ptLayout: Framebuffer layout
+**		ptDest: BLT pixels
+**		pSrc: Framebuffer address of the first pixel
+**		nCount: Number of pixels
+** Output: Filled BLT row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+ReadPixelRow(
+	IN CONST PIXEL_LAYOUT                        *ptLayout,
+	OUT      EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptDest,
+	IN CONST VOID                                *pSrc,
+	IN       UINTN                               nCount
+);
+
+/*
+** ===========================================================================
+** Function: FillPixelRow()
+** Description: Fills a framebuffer row with one packed pixel value
+** Input:
+**		pDest: Framebuffer address of the first pixel
+**		nValue: Packed pixel (see PackPixel())
+**		nCount: Number of pixels
+**		bStream: TRUE = use non-temporal stores
+** Output: Filled framebuffer row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+FillPixelRow(
+	OUT      VOID                                *pDest,
+	IN       UINT32                              nValue,
+	IN       UINTN                               nCount,
+	IN       BOOLEAN                             bStream
+);
+
+/*
+** ===========================================================================
+** Function: LerpPixelRow()
+** Description: Blends two pixel rows channel by channel (all four bytes),
+** Dest = (A * (256 - nWeight) + B * nWeight + 128) / 256
+** Input:
+**		pnDest: Destination pixels (may be pnA or pnB)
+**		pnA, pnB: Source pixels
+**		nWeight: Weight of B, 0..256
+**		nCount: Number of pixels
+** Output: Blended row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+LerpPixelRow(
+	OUT      UINT32                              *pnDest,
+	IN CONST UINT32                              *pnA,
+	IN CONST UINT32                              *pnB,
+	IN       UINT32                              nWeight,
+	IN       UINTN                               nCount
+);
+
+/*
+** ===========================================================================
+** Function: ScalePixelRow()
+** Description: Multiplies all four channels of a pixel row by nAlpha / 255,
+** rounded to nearest. The division is done as (x * a + 128) * 257 >> 16,
+** which is exact for 8-bit values.
+** Input:
+**		pnDest: Destination pixels (may be pnSrc)
+**		pnSrc: Source pixels
+**		nAlpha: Factor, 0..255
+**		nCount: Number of pixels
+** Output: Scaled row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+ScalePixelRow(
+	OUT      UINT32                              *pnDest,
+	IN CONST UINT32                              *pnSrc,
+	IN       UINT32                              nAlpha,
+	IN       UINTN                               nCount
+);
+
+/*
+** ===========================================================================
+** Function: AccumulatePixelRow()
+** Description: Adds the channels of a pixel row to per-channel sums, four
+** sums per pixel in memory order (blue, green, red, reserved)
+** Input:
+**		pnSums: Channel sums, 4 * nCount entries
+**		ptSrc: Source pixels
+**		nCount: Number of pixels
+** Output: Updated sums
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+AccumulatePixelRow(
+	IN OUT   UINT32                              *pnSums,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptSrc,
+	IN       UINTN                               nCount
+);
+
+/*
+** ===========================================================================
+** Function: PremultiplyPixelRow()
+** Description: Multiplies the color channels of a row by its alpha (the
+** Reserved byte), optionally converting RGBA byte order to BGRA first
+** Input:
+**		ptPixels: Pixels, converted in place
+**		nCount: Number of pixels
+**		bSwapRedBlue: TRUE = input is RGBA (e.g. from qoi_decode())
+** Output: Premultiplied BGRA row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+PremultiplyPixelRow(
+	IN OUT   EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptPixels,
+	IN       UINTN                               nCount,
+	IN       BOOLEAN                             bSwapRedBlue
+);
+
+/*
+** ===========================================================================
+** Function: BlendPixelRow()
+** Description: Composites premultiplied BGRA pixels over a row ("source
+** over": Dest = Src + Dest * (255 - SrcAlpha) / 255). Groups of fully
+** opaque pixels are copied and fully transparent ones skipped.
+** Input:
+**		pnDest: Destination pixels
+**		pnSrc: Premultiplied source pixels
+**		nCount: Number of pixels
+** Output: Composited row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+BlendPixelRow(
+	IN OUT   UINT32                              *pnDest,
+	IN CONST UINT32                              *pnSrc,
+	IN       UINTN                               nCount
+);
+
+/*
+** ===========================================================================
+** Function: BoxBlurPixelRow()
+** Description: Box-filters a pixel row with a sliding window, so the cost
+** per pixel does not depend on the radius. Edge pixels are repeated past
+** both ends. Channel sums are kept in 16 bits, which bounds the window to
+** 255 pixels.
+** Input:
+**		pnDest: Destination pixels (not pnSrc)
+**		pnSrc: Source pixels
+**		nCount: Number of pixels
+**		nRadius: Window radius, 1..127
+**		nScale: 65536 / (2 * nRadius + 1), rounded down
+** Output: Blurred row
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+BoxBlurPixelRow(
+	OUT      UINT32                              *pnDest,
+	IN CONST UINT32                              *pnSrc,
+	IN       UINTN                               nCount,
+	IN       UINTN                               nRadius,
+	IN       UINT16                              nScale
+);
+
+/*
+** ===========================================================================
+** Function: BoxBlurColumnRow()
+** Description: One step of a vertical sliding-window box filter over a
+** whole row at once: outputs the row for the current window sums, then
+** slides the window by adding the row entering it and subtracting the row
+** leaving it
+** Input:
+**		pnDest: Output row, NULL = none (while filling the first window)
+**		pnSums: 16-bit channel sums, 4 * nCount entries, in pixel memory
+**		order; start them at the rounding bias (window / 2)
+**		pnAdd: Row entering the window
+**		pnSub: Row leaving the window, NULL = none
+**		nCount: Number of pixels
+**		nScale: 65536 / window, rounded down
+** Output: Output row, updated sums
+** Return value: None
+** ===========================================================================
+*/
+VOID
+EFIAPI
+BoxBlurColumnRow(
+	OUT      UINT32                              *pnDest OPTIONAL,
+	IN OUT   UINT16                              *pnSums,
+	IN CONST UINT32                              *pnAdd,
+	IN CONST UINT32                              *pnSub OPTIONAL,
+	IN       UINTN                               nCount,
+	IN       UINT16                              nScale
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_PIXEL_H_ */
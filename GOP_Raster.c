@@ -0,0 +1,515 @@
+/*
+** ===========================================================================
+** File: GOP_Raster.c
+** Description: UEFI graphics-related code module (span rasterizer)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Raster.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: AddSpan()
+** Description: Clips a block of spans and queues it. A block right below
+** the last one with the same columns extends it, so vertical runs and
+** filled rectangles leave as one BLT. A full queue is flushed first.
+** Input:
+**		ptRaster: Raster
+**		nLeft, nTop, nRight, nBottom: Inclusive block in raster coordinates
+** Output: Queued span
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+AddSpan(
+	IN OUT RASTER *ptRaster,
+	IN INT32 nLeft,
+	IN INT32 nTop,
+	IN INT32 nRight,
+	IN INT32 nBottom
+)
+{
+	RASTER_SPAN *ptLast;
+	nLeft = MAX(nLeft, 0);
+	nTop = MAX(nTop, 0);
+	nRight = MIN(nRight, ptRaster->nClipWidth - 1);
+	nBottom = MIN(nBottom, ptRaster->nClipHeight - 1);
+	if (nLeft > nRight || nTop > nBottom)
+		return EFI_SUCCESS;
+	if (ptRaster->nCount != 0)
+	{
+		ptLast = &ptRaster->atSpans[ptRaster->nCount - 1];
+		if (ptLast->nLeft == nLeft && ptLast->nRight == nRight && ptLast->nBottom + 1 == nTop)
+		{
+			ptLast->nBottom = nBottom;
+			return EFI_SUCCESS;
+		}
+	}
+	if (ptRaster->nCount == RASTER_SPAN_MAX)
+		ASSERT_CHECK_EFISTATUS(FlushRaster(ptRaster));
+	ptLast = &ptRaster->atSpans[ptRaster->nCount++];
+	ptLast->nLeft = nLeft;
+	ptLast->nTop = nTop;
+	ptLast->nRight = nRight;
+	ptLast->nBottom = nBottom;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: CeilDiv()
+** Description: Divides rounding towards positive infinity
+** Input:
+**		nDividend: Dividend
+**		nDivisor: Divisor, positive
+** Output: None
+** Return value: Quotient rounded up
+** ===========================================================================
+*/
+static
+INT64
+CeilDiv(
+	IN INT64 nDividend,
+	IN INT64 nDivisor
+)
+{
+	INT64      nRemainder;
+	INT64      nQuotient;
+	/* Truncates towards zero, which only rounds positive quotients down */
+	nQuotient = DivS64x64Remainder(nDividend, nDivisor, &nRemainder);
+	return (nRemainder > 0) ? nQuotient + 1 : nQuotient;
+}
+
+/*
+** ===========================================================================
+** Function: CircleHalfWidth()
+** Description: Walks the half width of a circle one row outwards, as the
+** midpoint algorithm would (x*x + y*y <= r*r + r)
+** Input:
+**		nRadius: Radius
+**		nY: Row distance from the center
+**		nX: Half width at the previous row (start with nRadius)
+** Output: None
+** Return value: Half width at row nY, -1 past the circle
+** ===========================================================================
+*/
+static
+INT32
+CircleHalfWidth(
+	IN INT32 nRadius,
+	IN INT32 nY,
+	IN INT32 nX
+)
+{
+	INT64      nLimit = (INT64)nRadius * nRadius + nRadius - (INT64)nY * nY;
+	while (nX >= 0 && (INT64)nX * nX > nLimit)
+		nX--;
+	return nX;
+}
+
+/*
+** ===========================================================================
+** Function: InitRaster()
+** Description: Prepares a raster filling with one color in screen
+** coordinates, clipped to the current mode
+** Input:
+**		ptRaster: Raster to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptColor: Fill color
+** Output: Empty raster
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitRaster(
+	OUT      RASTER                              *ptRaster,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptColor
+)
+{
+	ASSERT_ENSURE(ptRaster != NULL && ptGraphicsOutput != NULL && ptColor != NULL);
+	ZeroMem(ptRaster, sizeof(RASTER));
+	ptRaster->ptGraphicsOutput = ptGraphicsOutput;
+	CopyMem(&ptRaster->tColor, ptColor, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	ptRaster->nClipWidth = (INT32)ptGraphicsOutput->Mode->Info->HorizontalResolution;
+	ptRaster->nClipHeight = (INT32)ptGraphicsOutput->Mode->Info->VerticalResolution;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetRasterSource()
+** Description: Makes spans copy pixels from an image instead of filling.
+** Raster coordinates become image coordinates, clipped to the image, and
+** the image is placed at a rectangle on screen (used to reveal an image
+** shape by shape).
+** Input:
+**		ptRaster: Raster, pending spans are flushed first
+**		ptSource: Image pixels
+**		nSourceStride: Image pixels per row (0 = rectangle width)
+**		ptRect: Where the image is on screen
+** Output: Raster drawing from the image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetRasterSource(
+	IN OUT   RASTER                              *ptRaster,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptSource,
+	IN       UINTN                               nSourceStride,
+	IN CONST RECT                                *ptRect
+)
+{
+	ASSERT_ENSURE(ptRaster != NULL && ptSource != NULL && ptRect != NULL);
+	ASSERT_CHECK_EFISTATUS(FlushRaster(ptRaster));
+	ptRaster->ptSource = ptSource;
+	ptRaster->nSourceStride = (nSourceStride == 0) ? WidthRect(ptRect) : nSourceStride;
+	ptRaster->nOriginX = (INT32)ptRect->nLeft;
+	ptRaster->nOriginY = (INT32)ptRect->nTop;
+	ptRaster->nClipWidth = (INT32)WidthRect(ptRect);
+	ptRaster->nClipHeight = (INT32)HeightRect(ptRect);
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: FlushRaster()
+** Description: Outputs the pending spans, one BLT per span block
+** Input:
+**		ptRaster: Raster
+** Output: Spans output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+FlushRaster(
+	IN OUT   RASTER                              *ptRaster
+)
+{
+	RASTER_SPAN *ptSpan;
+	RECT       tDest;
+	RECT       tSrc;
+	UINTN      nIndex;
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	ASSERT_ENSURE(ptRaster != NULL && ptRaster->ptGraphicsOutput != NULL);
+	for (nIndex = 0; nIndex < ptRaster->nCount && nStatus == EFI_SUCCESS; nIndex++)
+	{
+		ptSpan = &ptRaster->atSpans[nIndex];
+		SetRect(&tDest, (UINTN)(ptRaster->nOriginX + ptSpan->nLeft), (UINTN)(ptRaster->nOriginY + ptSpan->nTop),
+			(UINTN)(ptRaster->nOriginX + ptSpan->nRight), (UINTN)(ptRaster->nOriginY + ptSpan->nBottom));
+		if (ptRaster->ptSource == NULL)
+		{
+			nStatus = DrawBltEx(ptRaster->ptGraphicsOutput, &ptRaster->tColor, EfiBltVideoFill, &tDest, NULL, 0);
+			continue;
+		}
+		SetRect(&tSrc, (UINTN)ptSpan->nLeft, (UINTN)ptSpan->nTop, (UINTN)ptSpan->nRight, (UINTN)ptSpan->nBottom);
+		nStatus = DrawBltEx(ptRaster->ptGraphicsOutput, ptRaster->ptSource, EfiBltBufferToVideo, &tDest, &tSrc, ptRaster->nSourceStride);
+	}
+	ptRaster->nCount = 0;
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: RasterRect()
+** Description: Fills a rectangle, queued as one span block
+** Input:
+**		ptRaster: Raster
+**		nLeft, nTop, nRight, nBottom: Inclusive corners
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterRect(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nLeft,
+	IN       INT32                               nTop,
+	IN       INT32                               nRight,
+	IN       INT32                               nBottom
+)
+{
+	ASSERT_ENSURE(ptRaster != NULL);
+	return AddSpan(ptRaster, MIN(nLeft, nRight), MIN(nTop, nBottom), MAX(nLeft, nRight), MAX(nTop, nBottom));
+}
+
+/*
+** ===========================================================================
+** Function: RasterLine()
+** Description: Draws a line with Bresenham's algorithm, queuing each run of
+** pixels on a row as one span instead of one BLT per pixel
+** Input:
+**		ptRaster: Raster
+**		nX1, nY1: Start point
+**		nX2, nY2: End point, included
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterLine(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nX1,
+	IN       INT32                               nY1,
+	IN       INT32                               nX2,
+	IN       INT32                               nY2
+)
+{
+	INT64      nDx;
+	INT64      nDy;
+	INT64      nD;
+	INT32      nXinc;
+	INT32      nYinc;
+	INT32      nRunStart;
+	ASSERT_ENSURE(ptRaster != NULL);
+	nDx = (nX2 > nX1) ? (INT64)nX2 - nX1 : (INT64)nX1 - nX2;
+	nDy = (nY2 > nY1) ? (INT64)nY2 - nY1 : (INT64)nY1 - nY2;
+	nXinc = (nX2 > nX1) ? 1 : -1;
+	nYinc = (nY2 > nY1) ? 1 : -1;
+	if (nDx >= nDy)
+	{
+		/* X-major: pixels on one row form a run */
+		nD = 2 * nDy - nDx;
+		nRunStart = nX1;
+		while (nX1 != nX2)
+		{
+			if (nD > 0)
+			{
+				ASSERT_CHECK_EFISTATUS(AddSpan(ptRaster, MIN(nRunStart, nX1), nY1, MAX(nRunStart, nX1), nY1));
+				nY1 += nYinc;
+				nD -= 2 * nDx;
+				nRunStart = nX1 + nXinc;
+			}
+			nD += 2 * nDy;
+			nX1 += nXinc;
+		}
+		return AddSpan(ptRaster, MIN(nRunStart, nX1), nY1, MAX(nRunStart, nX1), nY1);
+	}
+	/* Y-major: one pixel per row, rows on the same column merge */
+	nD = 2 * nDx - nDy;
+	while (nY1 != nY2)
+	{
+		ASSERT_CHECK_EFISTATUS(AddSpan(ptRaster, nX1, nY1, nX1, nY1));
+		if (nD > 0)
+		{
+			nX1 += nXinc;
+			nD -= 2 * nDy;
+		}
+		nD += 2 * nDx;
+		nY1 += nYinc;
+	}
+	return AddSpan(ptRaster, nX1, nY1, nX1, nY1);
+}
+
+/*
+** ===========================================================================
+** Function: RasterPolygon()
+** Description: Fills a polygon (even-odd rule) one scanline span at a time.
+** Pixel centers on the left and top edges are inside, those on the right
+** and bottom edges outside, so shapes sharing an edge never overlap.
+** Input:
+**		ptRaster: Raster
+**		anPoints: Vertices as X, Y pairs
+**		nPoints: Number of vertices (at least 3)
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterPolygon(
+	IN OUT   RASTER                              *ptRaster,
+	IN CONST INT32                               *anPoints,
+	IN       UINTN                               nPoints
+)
+{
+	INT32      *anCrossings;
+	INT32      nTop;
+	INT32      nBottom;
+	INT32      nY;
+	INT32      nX1;
+	INT32      nY1;
+	INT32      nX2;
+	INT32      nY2;
+	INT32      nCrossing;
+	UINTN      nCount;
+	UINTN      nIndex;
+	UINTN      nPos;
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	ASSERT_ENSURE(ptRaster != NULL && anPoints != NULL && nPoints >= 3);
+	ASSERT_CHECK((anCrossings = AllocatePool(nPoints * sizeof(INT32))) != NULL);
+	nTop = nBottom = anPoints[1];
+	for (nIndex = 1; nIndex < nPoints; nIndex++)
+	{
+		nTop = MIN(nTop, anPoints[2 * nIndex + 1]);
+		nBottom = MAX(nBottom, anPoints[2 * nIndex + 1]);
+	}
+	nTop = MAX(nTop, 0);
+	nBottom = MIN(nBottom, ptRaster->nClipHeight);
+	for (nY = nTop; nY < nBottom && nStatus == EFI_SUCCESS; nY++)
+	{
+		nCount = 0;
+		for (nIndex = 0; nIndex < nPoints; nIndex++)
+		{
+			nX1 = anPoints[2 * nIndex];
+			nY1 = anPoints[2 * nIndex + 1];
+			nX2 = anPoints[2 * ((nIndex + 1) % nPoints)];
+			nY2 = anPoints[2 * ((nIndex + 1) % nPoints) + 1];
+			if (nY1 > nY2)
+			{
+				nCrossing = nX1; nX1 = nX2; nX2 = nCrossing;
+				nCrossing = nY1; nY1 = nY2; nY2 = nCrossing;
+			}
+			/* Edges own their top row but not their bottom one */
+			if (nY < nY1 || nY >= nY2)
+				continue;
+			nCrossing = nX1 + (INT32)CeilDiv((INT64)(nY - nY1) * (nX2 - nX1), nY2 - nY1);
+			for (nPos = nCount; nPos > 0 && anCrossings[nPos - 1] > nCrossing; nPos--)
+				anCrossings[nPos] = anCrossings[nPos - 1];
+			anCrossings[nPos] = nCrossing;
+			nCount++;
+		}
+		for (nIndex = 0; nIndex + 1 < nCount && nStatus == EFI_SUCCESS; nIndex += 2)
+			nStatus = AddSpan(ptRaster, anCrossings[nIndex], nY, anCrossings[nIndex + 1] - 1, nY);
+	}
+	FreePool(anCrossings);
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: RasterTriangle()
+** Description: Fills a triangle, see RasterPolygon()
+** Input:
+**		ptRaster: Raster
+**		nX1, nY1, nX2, nY2, nX3, nY3: Vertices
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterTriangle(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nX1,
+	IN       INT32                               nY1,
+	IN       INT32                               nX2,
+	IN       INT32                               nY2,
+	IN       INT32                               nX3,
+	IN       INT32                               nY3
+)
+{
+	INT32      anPoints[6];
+	anPoints[0] = nX1;
+	anPoints[1] = nY1;
+	anPoints[2] = nX2;
+	anPoints[3] = nY2;
+	anPoints[4] = nX3;
+	anPoints[5] = nY3;
+	return RasterPolygon(ptRaster, anPoints, 3);
+}
+
+/*
+** ===========================================================================
+** Function: RasterCircle()
+** Description: Draws a circle outline or disc with the midpoint algorithm.
+** Each row costs one span for a disc and at most two for an outline.
+** Input:
+**		ptRaster: Raster
+**		nCenterX, nCenterY: Center
+**		nRadius: Radius
+**		bFilled: TRUE = disc, FALSE = outline
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterCircle(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nCenterX,
+	IN       INT32                               nCenterY,
+	IN       INT32                               nRadius,
+	IN       BOOLEAN                             bFilled
+)
+{
+	INT32      nY;
+	INT32      nHalf;
+	INT32      nNextHalf;
+	INT32      nInner;
+	INT32      nSign;
+	ASSERT_ENSURE(ptRaster != NULL && nRadius >= 0);
+	nHalf = CircleHalfWidth(nRadius, 0, nRadius);
+	for (nY = 0; nY <= nRadius; nY++)
+	{
+		nNextHalf = CircleHalfWidth(nRadius, nY + 1, nHalf);
+		/* An outline row covers the columns the next row outwards does not
+		reach, and at least its last pixel */
+		nInner = bFilled ? 0 : MIN(nNextHalf + 1, nHalf);
+		for (nSign = 1; nSign >= -1; nSign -= 2)
+		{
+			if (nY == 0 && nSign == -1)
+				break;
+			if (nInner == 0)
+			{
+				ASSERT_CHECK_EFISTATUS(AddSpan(ptRaster, nCenterX - nHalf, nCenterY + nSign * nY, nCenterX + nHalf, nCenterY + nSign * nY));
+				continue;
+			}
+			ASSERT_CHECK_EFISTATUS(AddSpan(ptRaster, nCenterX - nHalf, nCenterY + nSign * nY, nCenterX - nInner, nCenterY + nSign * nY));
+			ASSERT_CHECK_EFISTATUS(AddSpan(ptRaster, nCenterX + nInner, nCenterY + nSign * nY, nCenterX + nHalf, nCenterY + nSign * nY));
+		}
+		nHalf = nNextHalf;
+	}
+	return EFI_SUCCESS;
+}
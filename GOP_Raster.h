@@ -0,0 +1,244 @@
+/*
+** ===========================================================================
+** File: GOP_Raster.h
+** Description: UEFI graphics-related code module (span rasterizer)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_RASTER_H_
+#define _GRAPHICS_GOP_RASTER_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <Protocol/GraphicsOutput.h>
+#ifndef _GRAPHICS_RECTANGLE_H_
+#include "Rectangle.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define RASTER_SPAN_MAX		128	/* Pending spans before an automatic flush */
+
+typedef struct {
+	INT32                                        nLeft;		/* Inclusive, raster coordinates */
+	INT32                                        nTop;
+	INT32                                        nRight;
+	INT32                                        nBottom;
+} RASTER_SPAN;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                tColor;		/* Fill color without a source */
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                *ptSource;		/* NULL = fill, else spans copy these pixels */
+	UINTN                                        nSourceStride;	/* Source pixels per row */
+	INT32                                        nOriginX;		/* Screen position of raster (0, 0) */
+	INT32                                        nOriginY;
+	INT32                                        nClipWidth;	/* Drawable raster area from (0, 0) */
+	INT32                                        nClipHeight;
+	UINTN                                        nCount;
+	RASTER_SPAN                                  atSpans[RASTER_SPAN_MAX];	/* Spans stacked on equal columns merge */
+} RASTER;
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: InitRaster()
+** Description: Prepares a raster filling with one color in screen
+** coordinates, clipped to the current mode
+** Input:
+**		ptRaster: Raster to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptColor: Fill color
+** Output: Empty raster
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitRaster(
+	OUT      RASTER                              *ptRaster,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptColor
+);
+
+/*
+** ===========================================================================
+** Function: SetRasterSource()
+** Description: Makes spans copy pixels from an image instead of filling.
+** Raster coordinates become image coordinates, clipped to the image, and
+** the image is placed at a rectangle on screen (used to reveal an image
+** shape by shape).
+** Input:
+**		ptRaster: Raster, pending spans are flushed first
+**		ptSource: Image pixels
+**		nSourceStride: Image pixels per row (0 = rectangle width)
+**		ptRect: Where the image is on screen
+** Output: Raster drawing from the image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetRasterSource(
+	IN OUT   RASTER                              *ptRaster,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptSource,
+	IN       UINTN                               nSourceStride,
+	IN CONST RECT                                *ptRect
+);
+
+/*
+** ===========================================================================
+** Function: FlushRaster()
+** Description: Outputs the pending spans, one BLT per span block
+** Input:
+**		ptRaster: Raster
+** Output: Spans output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+FlushRaster(
+	IN OUT   RASTER                              *ptRaster
+);
+
+/*
+** ===========================================================================
+** Function: RasterRect()
+** Description: Fills a rectangle, queued as one span block
+** Input:
+**		ptRaster: Raster
+**		nLeft, nTop, nRight, nBottom: Inclusive corners
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterRect(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nLeft,
+	IN       INT32                               nTop,
+	IN       INT32                               nRight,
+	IN       INT32                               nBottom
+);
+
+/*
+** ===========================================================================
+** Function: RasterLine()
+** Description: Draws a line with Bresenham's algorithm, queuing each run of
+** pixels on a row as one span instead of one BLT per pixel
+** Input:
+**		ptRaster: Raster
+**		nX1, nY1: Start point
+**		nX2, nY2: End point, included
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterLine(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nX1,
+	IN       INT32                               nY1,
+	IN       INT32                               nX2,
+	IN       INT32                               nY2
+);
+
+/*
+** ===========================================================================
+** Function: RasterPolygon()
+** Description: Fills a polygon (even-odd rule) one scanline span at a time.
+** Pixel centers on the left and top edges are inside, those on the right
+** and bottom edges outside, so shapes sharing an edge never overlap.
+** Input:
+**		ptRaster: Raster
+**		anPoints: Vertices as X, Y pairs
+**		nPoints: Number of vertices (at least 3)
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterPolygon(
+	IN OUT   RASTER                              *ptRaster,
+	IN CONST INT32                               *anPoints,
+	IN       UINTN                               nPoints
+);
+
+/*
+** ===========================================================================
+** Function: RasterTriangle()
+** Description: Fills a triangle, see RasterPolygon()
+** Input:
+**		ptRaster: Raster
+**		nX1, nY1, nX2, nY2, nX3, nY3: Vertices
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterTriangle(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nX1,
+	IN       INT32                               nY1,
+	IN       INT32                               nX2,
+	IN       INT32                               nY2,
+	IN       INT32                               nX3,
+	IN       INT32                               nY3
+);
+
+/*
+** ===========================================================================
+** Function: RasterCircle()
+** Description: Draws a circle outline or disc with the midpoint algorithm.
+** Each row costs one span for a disc and at most two for an outline.
+** Input:
+**		ptRaster: Raster
+**		nCenterX, nCenterY: Center
+**		nRadius: Radius
+**		bFilled: TRUE = disc, FALSE = outline
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RasterCircle(
+	IN OUT   RASTER                              *ptRaster,
+	IN       INT32                               nCenterX,
+	IN       INT32                               nCenterY,
+	IN       INT32                               nRadius,
+	IN       BOOLEAN                             bFilled
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_RASTER_H_ */
@@ -0,0 +1,546 @@
+/*
+** ===========================================================================
+** File: GOP_Scale.c
+** Description: UEFI graphics-related code module (image scaling)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Surface.h"
+#include "GOP_Blend.h"
+#include "GOP_Scale.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define SCALE_STRIP_ROWS	16	/* Scaled rows output per BLT */
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL	*ptPixels;	/* First source pixel */
+	UINTN							nStride;	/* Source pixels per row */
+	UINTN							nSrcWidth;
+	UINTN							nSrcHeight;
+	UINTN							nDestWidth;
+	UINTN							nDestHeight;
+	UINTN							nFilter;	/* SCALE_FILTER_* */
+	UINT32							nStepX;		/* 16.16 source step per destination pixel */
+	UINT32							nStepY;
+	UINT32							*apnRows[2];	/* Bilinear: horizontally scaled source rows */
+	UINTN							anRowIndex[2];	/* Bilinear: source row held by apnRows[] */
+	UINT32							*pnSums;	/* Box: channel sums per source column */
+	UINTN							*pnColumns;	/* Box: source column range per destination column */
+} SCALE_JOB;
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: GetFilterStart()
+** Description: Computes the 16.16 source position of the first destination
+** pixel, sampling at pixel centers
+** Input:
+**		nStep: 16.16 source step per destination pixel
+** Output: None
+** Return value: Start position (may be negative)
+** ===========================================================================
+*/
+static
+INT32
+GetFilterStart(
+	IN UINT32 nStep
+)
+{
+	return (INT32)(nStep >> 1) - 0x8000;
+}
+
+/*
+** ===========================================================================
+** Function: ScaleRowNearest()
+** Description: Resamples one source row to the destination width (nearest)
+** Input:
+**		ptDest: Destination row
+**		ptSrc: Source row
+**		nDestWidth: Destination width
+**		nStep: 16.16 source step per destination pixel
+** Output: Scaled row
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+ScaleRowNearest(
+	OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptDest,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptSrc,
+	IN UINTN nDestWidth,
+	IN UINT32 nStep
+)
+{
+	UINT32     nPos;
+	UINTN      nCol;
+	for (nCol = 0, nPos = nStep >> 1; nCol < nDestWidth; nCol++, nPos += nStep)
+		ptDest[nCol] = ptSrc[nPos >> 16];
+}
+
+/*
+** ===========================================================================
+** Function: ScaleRowBilinear()
+** Description: Resamples one source row to the destination width, blending
+** the two nearest source pixels (two channels per multiply)
+** Input:
+**		pnDest: Destination row
+**		pnSrc: Source row
+**		nSrcWidth: Source width
+**		nDestWidth: Destination width
+**		nStep: 16.16 source step per destination pixel
+** Output: Scaled row
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+ScaleRowBilinear(
+	OUT UINT32 *pnDest,
+	IN CONST UINT32 *pnSrc,
+	IN UINTN nSrcWidth,
+	IN UINTN nDestWidth,
+	IN UINT32 nStep
+)
+{
+	INT32      nPos;
+	UINT32     nFrac;
+	UINT32     nA;
+	UINT32     nB;
+	UINTN      nX;
+	UINTN      nCol;
+	for (nCol = 0, nPos = GetFilterStart(nStep); nCol < nDestWidth; nCol++, nPos += (INT32)nStep)
+	{
+		if (nPos <= 0)
+		{
+			pnDest[nCol] = pnSrc[0];
+			continue;
+		}
+		nX = (UINTN)nPos >> 16;
+		if (nX >= nSrcWidth - 1)
+		{
+			pnDest[nCol] = pnSrc[nSrcWidth - 1];
+			continue;
+		}
+		nFrac = ((UINT32)nPos >> 8) & 0xFF;
+		nA = pnSrc[nX];
+		nB = pnSrc[nX + 1];
+		pnDest[nCol] = ((((nA & 0x00FF00FF) * (256 - nFrac) + (nB & 0x00FF00FF) * nFrac + 0x00800080) >> 8) & 0x00FF00FF) |
+			((((nA >> 8) & 0x00FF00FF) * (256 - nFrac) + ((nB >> 8) & 0x00FF00FF) * nFrac + 0x00800080) & 0xFF00FF00);
+	}
+}
+
+/*
+** ===========================================================================
+** Function: GetBilinearRow()
+** Description: Returns a source row scaled horizontally, reusing the two
+** rows kept from the previous destination row
+** Input:
+**		ptJob: Scale job
+**		nSrcRow: Source row
+**		nOther: Slot holding the other row needed now, never replaced
+** Output: Updated row cache
+** Return value: Scaled row
+** ===========================================================================
+*/
+static
+UINT32 *
+GetBilinearRow(
+	IN OUT SCALE_JOB *ptJob,
+	IN UINTN nSrcRow,
+	IN UINTN nOther
+)
+{
+	UINTN      nSlot;
+	for (nSlot = 0; nSlot < 2; nSlot++)
+	{
+		if (ptJob->anRowIndex[nSlot] == nSrcRow)
+			return ptJob->apnRows[nSlot];
+	}
+	nSlot = (nOther == 0) ? 1 : 0;
+	ScaleRowBilinear(ptJob->apnRows[nSlot], (CONST UINT32 *)(ptJob->ptPixels + nSrcRow * ptJob->nStride),
+		ptJob->nSrcWidth, ptJob->nDestWidth, ptJob->nStepX);
+	ptJob->anRowIndex[nSlot] = nSrcRow;
+	return ptJob->apnRows[nSlot];
+}
+
+/*
+** ===========================================================================
+** Function: ScaleRowBox()
+** Description: Produces one destination row as the average of the source
+** area it covers
+** Input:
+**		ptJob: Scale job
+**		nRow: Destination row
+**		ptDest: Destination row pixels
+** Output: Scaled row
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+ScaleRowBox(
+	IN OUT SCALE_JOB *ptJob,
+	IN UINTN nRow,
+	OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptDest
+)
+{
+	UINT8      *pDest = (UINT8 *)ptDest;
+	UINT32     anSum[4];
+	UINT32     nRecip;
+	UINTN      nArea;
+	UINTN      nFirst;
+	UINTN      nLast;
+	UINTN      nSrcRow;
+	UINTN      nCol;
+	UINTN      nSrcCol;
+	UINTN      nChannel;
+	nFirst = nRow * ptJob->nSrcHeight / ptJob->nDestHeight;
+	nLast = MAX((nRow + 1) * ptJob->nSrcHeight / ptJob->nDestHeight, nFirst + 1);
+	ZeroMem(ptJob->pnSums, ptJob->nSrcWidth * 4 * sizeof(UINT32));
+	for (nSrcRow = nFirst; nSrcRow < nLast; nSrcRow++)
+		AccumulatePixelRow(ptJob->pnSums, ptJob->ptPixels + nSrcRow * ptJob->nStride, ptJob->nSrcWidth);
+	for (nCol = 0; nCol < ptJob->nDestWidth; nCol++)
+	{
+		anSum[0] = anSum[1] = anSum[2] = anSum[3] = 0;
+		for (nSrcCol = ptJob->pnColumns[nCol * 2]; nSrcCol < ptJob->pnColumns[nCol * 2 + 1]; nSrcCol++)
+		{
+			for (nChannel = 0; nChannel < 4; nChannel++)
+				anSum[nChannel] += ptJob->pnSums[nSrcCol * 4 + nChannel];
+		}
+		/* 2^23 / area keeps sum * nRecip below 2^32 for any box */
+		nArea = (ptJob->pnColumns[nCol * 2 + 1] - ptJob->pnColumns[nCol * 2]) * (nLast - nFirst);
+		nRecip = (UINT32)(((1u << 23) + nArea / 2) / nArea);
+		for (nChannel = 0; nChannel < 4; nChannel++)
+			pDest[nCol * 4 + nChannel] = (UINT8)MIN((anSum[nChannel] * nRecip + (1u << 22)) >> 23, 255);
+	}
+}
+
+/*
+** ===========================================================================
+** Function: ScaleRow()
+** Description: Produces one destination row with the job's filter
+** Input:
+**		ptJob: Scale job
+**		nRow: Destination row (rows are requested in increasing order)
+**		ptDest: Destination row pixels
+** Output: Scaled row
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+ScaleRow(
+	IN OUT SCALE_JOB *ptJob,
+	IN UINTN nRow,
+	OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptDest
+)
+{
+	INT32      nPos;
+	UINTN      nSrcRow;
+	UINT32     *pnTop;
+	UINT32     *pnBottom;
+	switch (ptJob->nFilter) {
+	case SCALE_FILTER_BILINEAR:
+		nPos = GetFilterStart(ptJob->nStepY) + (INT32)(nRow * ptJob->nStepY);
+		nSrcRow = (nPos <= 0) ? 0 : MIN((UINTN)nPos >> 16, ptJob->nSrcHeight - 1);
+		pnTop = GetBilinearRow(ptJob, nSrcRow, 2);
+		if (nPos <= 0 || nSrcRow == ptJob->nSrcHeight - 1)
+		{
+			CopyMem(ptDest, pnTop, ptJob->nDestWidth * sizeof(UINT32));
+			break;
+		}
+		pnBottom = GetBilinearRow(ptJob, nSrcRow + 1, (pnTop == ptJob->apnRows[0]) ? 0 : 1);
+		LerpPixelRow((UINT32 *)ptDest, pnTop, pnBottom, ((UINT32)nPos >> 8) & 0xFF, ptJob->nDestWidth);
+		break;
+	case SCALE_FILTER_BOX:
+		ScaleRowBox(ptJob, nRow, ptDest);
+		break;
+	default:
+		nSrcRow = (UINTN)(((ptJob->nStepY >> 1) + nRow * ptJob->nStepY) >> 16);
+		ScaleRowNearest(ptDest, ptJob->ptPixels + nSrcRow * ptJob->nStride, ptJob->nDestWidth, ptJob->nStepX);
+		break;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: FreeScaleJob()
+** Description: Releases the work buffers of a scale job
+** Input:
+**		ptJob: Scale job
+** Output: Freed buffers
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+FreeScaleJob(
+	IN OUT SCALE_JOB *ptJob
+)
+{
+	if (ptJob->apnRows[0] != NULL)
+		FreePool(ptJob->apnRows[0]);
+	if (ptJob->pnSums != NULL)
+		FreePool(ptJob->pnSums);
+	if (ptJob->pnColumns != NULL)
+		FreePool(ptJob->pnColumns);
+}
+
+/*
+** ===========================================================================
+** Function: InitScaleJob()
+** Description: Sets up steps and work buffers for a scale job
+** Input:
+**		ptJob: Scale job with source, sizes and filter filled in
+** Output: Ready scale job
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+InitScaleJob(
+	IN OUT SCALE_JOB *ptJob
+)
+{
+	UINTN      nCol;
+	/* 16.16 positions must fit an INT32 */
+	ASSERT_CHECK(ptJob->nSrcWidth < 0x8000 && ptJob->nSrcHeight < 0x8000 &&
+		ptJob->nDestWidth < 0x8000 && ptJob->nDestHeight < 0x8000);
+	ptJob->nStepX = (UINT32)((ptJob->nSrcWidth << 16) / ptJob->nDestWidth);
+	ptJob->nStepY = (UINT32)((ptJob->nSrcHeight << 16) / ptJob->nDestHeight);
+	ptJob->apnRows[0] = ptJob->apnRows[1] = NULL;
+	ptJob->anRowIndex[0] = ptJob->anRowIndex[1] = (UINTN)~0;
+	ptJob->pnSums = NULL;
+	ptJob->pnColumns = NULL;
+	switch (ptJob->nFilter) {
+	case SCALE_FILTER_BILINEAR:
+		ASSERT_CHECK((ptJob->apnRows[0] = AllocatePool(ptJob->nDestWidth * 2 * sizeof(UINT32))) != NULL);
+		ptJob->apnRows[1] = ptJob->apnRows[0] + ptJob->nDestWidth;
+		break;
+	case SCALE_FILTER_BOX:
+		ptJob->pnSums = AllocatePool(ptJob->nSrcWidth * 4 * sizeof(UINT32));
+		ptJob->pnColumns = AllocatePool(ptJob->nDestWidth * 2 * sizeof(UINTN));
+		if (ptJob->pnSums == NULL || ptJob->pnColumns == NULL)
+		{
+			FreeScaleJob(ptJob);
+			return EFI_LOAD_ERROR;
+		}
+		/* When enlarging, every column still takes one source pixel */
+		for (nCol = 0; nCol < ptJob->nDestWidth; nCol++)
+		{
+			ptJob->pnColumns[nCol * 2] = nCol * ptJob->nSrcWidth / ptJob->nDestWidth;
+			ptJob->pnColumns[nCol * 2 + 1] = MAX((nCol + 1) * ptJob->nSrcWidth / ptJob->nDestWidth, ptJob->pnColumns[nCol * 2] + 1);
+		}
+		break;
+	default:
+		ptJob->nFilter = SCALE_FILTER_NEAREST;
+		break;
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: ScaleBlt()
+** Description: Scales part of a BLT buffer to a destination rectangle strip
+** by strip, copying or compositing the strips
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		ptSrcRect: Area of the BLT buffer to scale
+**		nSrcStride: BLT buffer pixels per row (0 = ptSrcRect->nRight + 1)
+**		ptDestRect: Destination rectangle on screen (clipped to the mode)
+**		nFilter: SCALE_FILTER_*
+**		bAlpha: TRUE = premultiplied BGRA, composited with DrawBltAlpha()
+** Output: Scaled image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+ScaleBlt(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBlt,
+	IN CONST RECT *ptSrcRect,
+	IN UINTN nSrcStride,
+	IN CONST RECT *ptDestRect,
+	IN UINTN nFilter,
+	IN BOOLEAN bAlpha
+)
+{
+	SCALE_JOB  tJob;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptStrip;
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	RECT       tStrip;
+	UINTN      nRow;
+	UINTN      nStripRow;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptBlt != NULL && ptSrcRect != NULL && ptDestRect != NULL);
+	if (nSrcStride == 0)
+		nSrcStride = ptSrcRect->nRight + 1;
+	ASSERT_CHECK(ptSrcRect->nRight < nSrcStride);
+	tJob.ptPixels = ptBlt + ptSrcRect->nTop * nSrcStride + ptSrcRect->nLeft;
+	tJob.nStride = nSrcStride;
+	tJob.nSrcWidth = WidthRect(ptSrcRect);
+	tJob.nSrcHeight = HeightRect(ptSrcRect);
+	tJob.nDestWidth = WidthRect(ptDestRect);
+	tJob.nDestHeight = HeightRect(ptDestRect);
+	tJob.nFilter = nFilter;
+	if (tJob.nSrcWidth == tJob.nDestWidth && tJob.nSrcHeight == tJob.nDestHeight)
+	{
+		if (bAlpha)
+			return DrawBltAlpha(ptGraphicsOutput, ptBlt, ptDestRect, ptSrcRect, nSrcStride);
+		return DrawBltEx(ptGraphicsOutput, ptBlt, EfiBltBufferToVideo, ptDestRect, ptSrcRect, nSrcStride);
+	}
+	ASSERT_CHECK_EFISTATUS(InitScaleJob(&tJob));
+	if ((ptStrip = AllocatePool(tJob.nDestWidth * SCALE_STRIP_ROWS * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL))) == NULL)
+	{
+		FreeScaleJob(&tJob);
+		return EFI_LOAD_ERROR;
+	}
+	for (nRow = 0; nRow < tJob.nDestHeight && nStatus == EFI_SUCCESS; nRow += nStripRow)
+	{
+		for (nStripRow = 0; nStripRow < SCALE_STRIP_ROWS && nRow + nStripRow < tJob.nDestHeight; nStripRow++)
+			ScaleRow(&tJob, nRow + nStripRow, ptStrip + nStripRow * tJob.nDestWidth);
+		SetRect(&tStrip, ptDestRect->nLeft, ptDestRect->nTop + nRow, ptDestRect->nRight, ptDestRect->nTop + nRow + nStripRow - 1);
+		if (bAlpha)
+			nStatus = DrawBltAlpha(ptGraphicsOutput, ptStrip, &tStrip, NULL, tJob.nDestWidth);
+		else
+			nStatus = DrawBltEx(ptGraphicsOutput, ptStrip, EfiBltBufferToVideo, &tStrip, NULL, tJob.nDestWidth);
+	}
+	FreePool(ptStrip);
+	FreeScaleJob(&tJob);
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: DrawBltScaled()
+** Description: Outputs part of a BLT buffer scaled to fit a destination
+** rectangle. Rows are produced and output in strips, so the scaled image is
+** never held in memory as a whole.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		ptSrcRect: Area of the BLT buffer to scale
+**		nSrcStride: BLT buffer pixels per row (0 = ptSrcRect->nRight + 1)
+**		ptDestRect: Destination rectangle on screen (clipped to the mode)
+**		nFilter: SCALE_FILTER_*
+** Output: Scaled image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBltScaled(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN CONST RECT                                *ptSrcRect,
+	IN       UINTN                               nSrcStride,
+	IN CONST RECT                                *ptDestRect,
+	IN       UINTN                               nFilter
+)
+{
+	return ScaleBlt(ptGraphicsOutput, ptBlt, ptSrcRect, nSrcStride, ptDestRect, nFilter, FALSE);
+}
+
+/*
+** ===========================================================================
+** Function: DrawBltScaledAlpha()
+** Description: Same as DrawBltScaled() for premultiplied BGRA pixels, the
+** scaled strips are composited over the screen with DrawBltAlpha()
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: Premultiplied BGRA pixel buffer
+**		ptSrcRect: Area of the BLT buffer to scale
+**		nSrcStride: BLT buffer pixels per row (0 = ptSrcRect->nRight + 1)
+**		ptDestRect: Destination rectangle on screen (clipped to the mode)
+**		nFilter: SCALE_FILTER_*
+** Output: Scaled image composited on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBltScaledAlpha(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN CONST RECT                                *ptSrcRect,
+	IN       UINTN                               nSrcStride,
+	IN CONST RECT                                *ptDestRect,
+	IN       UINTN                               nFilter
+)
+{
+	return ScaleBlt(ptGraphicsOutput, ptBlt, ptSrcRect, nSrcStride, ptDestRect, nFilter, TRUE);
+}
+
+/*
+** ===========================================================================
+** Function: DrawSurfaceScaled()
+** Description: Outputs a whole surface (e.g. a decoded image) scaled to fit
+** a destination rectangle
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface
+**		ptDestRect: Destination rectangle on screen
+**		nFilter: SCALE_FILTER_*
+** Output: Scaled image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSurfaceScaled(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptSurface,
+	IN CONST RECT                                *ptDestRect,
+	IN       UINTN                               nFilter
+)
+{
+	RECT       tSrcRect;
+	ASSERT_ENSURE(ptSurface != NULL && ptSurface->ptPixels != NULL);
+	SetRect(&tSrcRect, 0, 0, ptSurface->nWidth - 1, ptSurface->nHeight - 1);
+	return DrawBltScaled(ptGraphicsOutput, ptSurface->ptPixels, &tSrcRect, ptSurface->nStride, ptDestRect, nFilter);
+}
@@ -0,0 +1,131 @@
+/*
+** ===========================================================================
+** File: GOP_Scale.h
+** Description: UEFI graphics-related code module (image scaling)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_SCALE_H_
+#define _GRAPHICS_GOP_SCALE_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+enum
+{
+	SCALE_FILTER_NEAREST,
+	SCALE_FILTER_BILINEAR,
+	SCALE_FILTER_BOX		/* Area average, for shrinking (nearest when enlarging) */
+};
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: DrawBltScaled()
+** Description: Outputs part of a BLT buffer scaled to fit a destination
+** rectangle. Rows are produced and output in strips, so the scaled image is
+** never held in memory as a whole.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: BLT pixel buffer
+**		ptSrcRect: Area of the BLT buffer to scale
+**		nSrcStride: BLT buffer pixels per row (0 = ptSrcRect->nRight + 1)
+**		ptDestRect: Destination rectangle on screen (clipped to the mode)
+**		nFilter: SCALE_FILTER_*
+** Output: Scaled image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBltScaled(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN CONST RECT                                *ptSrcRect,
+	IN       UINTN                               nSrcStride,
+	IN CONST RECT                                *ptDestRect,
+	IN       UINTN                               nFilter
+);
+
+/*
+** ===========================================================================
+** Function: DrawBltScaledAlpha()
+** Description: Same as DrawBltScaled() for premultiplied BGRA pixels, the
+** scaled strips are composited over the screen with DrawBltAlpha()
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptBlt: Premultiplied BGRA pixel buffer
+**		ptSrcRect: Area of the BLT buffer to scale
+**		nSrcStride: BLT buffer pixels per row (0 = ptSrcRect->nRight + 1)
+**		ptDestRect: Destination rectangle on screen (clipped to the mode)
+**		nFilter: SCALE_FILTER_*
+** Output: Scaled image composited on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawBltScaledAlpha(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN CONST RECT                                *ptSrcRect,
+	IN       UINTN                               nSrcStride,
+	IN CONST RECT                                *ptDestRect,
+	IN       UINTN                               nFilter
+);
+
+/*
+** ===========================================================================
+** Function: DrawSurfaceScaled()
+** Description: Outputs a whole surface (e.g. a decoded image) scaled to fit
+** a destination rectangle
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface
+**		ptDestRect: Destination rectangle on screen
+**		nFilter: SCALE_FILTER_*
+** Output: Scaled image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSurfaceScaled(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptSurface,
+	IN CONST RECT                                *ptDestRect,
+	IN       UINTN                               nFilter
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_SCALE_H_ */
@@ -0,0 +1,452 @@
+/*
+** ===========================================================================
+** File: GOP_Sprite.c
+** Description: UEFI graphics-related code module (sprites and pointer)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Protocol/SimplePointer.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Surface.h"
+#include "GOP_Sprite.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/* Screen rectangle of a sprite-sized area at (nX, nY); negative positions
+wrap around in the UINTN fields and DrawBltEx() takes them back as signed */
+#define SetSpriteRect(ptRect, nX, nY, nWidth, nHeight) \
+	SetRect((ptRect), (UINTN)(nX), (UINTN)(nY), (UINTN)(nX) + (nWidth) - 1, (UINTN)(nY) + (nHeight) - 1)
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: ComposeSprite()
+** Description: Draws the sprite image over a background buffer
+** Input:
+**		ptSprite: Sprite
+**		ptDest: Background, changed in place
+**		nX, nY: Sprite position inside the background
+** Output: Background with the sprite on it
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+ComposeSprite(
+	IN CONST SPRITE *ptSprite,
+	IN OUT SURFACE *ptDest,
+	IN UINTN nX,
+	IN UINTN nY
+)
+{
+	CONST SURFACE *ptImage = ptSprite->ptImage;
+	UINT32     *pnDest;
+	CONST UINT32 *pnSrc;
+	UINT32     nKey;
+	UINTN      nRow;
+	UINTN      nCol;
+	if (ptImage->nFormat == SURFACE_FORMAT_BGRA)
+	{
+		for (nRow = 0; nRow < ptImage->nHeight; nRow++)
+			BlendPixelRow((UINT32 *)SurfacePixel(ptDest, nX, nY + nRow), (CONST UINT32 *)SurfacePixel(ptImage, 0, nRow), ptImage->nWidth);
+		return;
+	}
+	if (ptSprite->bColorKey == FALSE)
+	{
+		SurfaceBlt(ptDest, ptImage->ptPixels, EfiBltBufferToVideo, 0, 0, nX, nY, ptImage->nWidth, ptImage->nHeight,
+			ptImage->nStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+		return;
+	}
+	/* The reserved byte is not part of the key */
+	nKey = *(CONST UINT32 *)&ptSprite->tColorKey & 0x00FFFFFF;
+	for (nRow = 0; nRow < ptImage->nHeight; nRow++)
+	{
+		pnDest = (UINT32 *)SurfacePixel(ptDest, nX, nY + nRow);
+		pnSrc = (CONST UINT32 *)SurfacePixel(ptImage, 0, nRow);
+		for (nCol = 0; nCol < ptImage->nWidth; nCol++)
+		{
+			if ((pnSrc[nCol] & 0x00FFFFFF) != nKey)
+				pnDest[nCol] = pnSrc[nCol];
+		}
+	}
+}
+
+/*
+** ===========================================================================
+** Function: DrawSpriteAt()
+** Description: Saves the screen under a position and draws the sprite
+** there, one read and one write of the sprite's size
+** Input:
+**		ptSprite: Hidden sprite
+**		nX, nY: Position
+** Output: Sprite on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+DrawSpriteAt(
+	IN OUT SPRITE *ptSprite,
+	IN INTN nX,
+	IN INTN nY
+)
+{
+	RECT       tRect;
+	UINTN      nWidth = ptSprite->tSaveUnder.nWidth;
+	UINTN      nHeight = ptSprite->tSaveUnder.nHeight;
+	SetSpriteRect(&tRect, nX, nY, nWidth, nHeight);
+	ASSERT_CHECK_EFISTATUS(DrawBltEx(ptSprite->ptGraphicsOutput, ptSprite->tSaveUnder.ptPixels, EfiBltVideoToBltBuffer, &tRect, NULL, nWidth));
+	/* The work buffer is at least twice the sprite's width */
+	SurfaceBlt(&ptSprite->tWork, ptSprite->tSaveUnder.ptPixels, EfiBltBufferToVideo, 0, 0, 0, 0, nWidth, nHeight, 0);
+	ComposeSprite(ptSprite, &ptSprite->tWork, 0, 0);
+	ASSERT_CHECK_EFISTATUS(DrawBltEx(ptSprite->ptGraphicsOutput, ptSprite->tWork.ptPixels, EfiBltBufferToVideo, &tRect, NULL, ptSprite->tWork.nStride));
+	ptSprite->nX = nX;
+	ptSprite->nY = nY;
+	ptSprite->bShown = TRUE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: CreateSprite()
+** Description: Prepares a hidden sprite. Its save-under and work buffers
+** are allocated once here, so showing and moving it never allocates.
+** Input:
+**		ptSprite: Sprite to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptImage: Sprite image, must stay valid while the sprite exists.
+**		SURFACE_FORMAT_BGRA images are blended.
+**		ptColorKey: Transparent color of a BGRX image, NULL = none
+** Output: Hidden sprite
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CreateSprite(
+	OUT      SPRITE                              *ptSprite,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptImage,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptColorKey OPTIONAL
+)
+{
+	ASSERT_ENSURE(ptSprite != NULL && ptGraphicsOutput != NULL && ptImage != NULL && ptImage->ptPixels != NULL);
+	ZeroMem(ptSprite, sizeof(SPRITE));
+	ASSERT_CHECK_EFISTATUS(CreateSurface(&ptSprite->tSaveUnder, ptImage->nWidth, ptImage->nHeight, SURFACE_FORMAT_BGRX));
+	/* Room for a save-under and a composed sprite side by side */
+	if (CreateSurface(&ptSprite->tWork, 2 * ptImage->nWidth, ptImage->nHeight, SURFACE_FORMAT_BGRX) != EFI_SUCCESS)
+	{
+		DestroySurface(&ptSprite->tSaveUnder);
+		return EFI_LOAD_ERROR;
+	}
+	ptSprite->ptGraphicsOutput = ptGraphicsOutput;
+	ptSprite->ptImage = ptImage;
+	if (ptColorKey != NULL)
+	{
+		ptSprite->bColorKey = TRUE;
+		CopyMem(&ptSprite->tColorKey, ptColorKey, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: DestroySprite()
+** Description: Hides a sprite and frees its buffers
+** Input:
+**		ptSprite: Sprite
+** Output: Freed sprite
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DestroySprite(
+	IN OUT   SPRITE                              *ptSprite
+)
+{
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptSprite != NULL);
+	nStatus = HideSprite(ptSprite);
+	DestroySurface(&ptSprite->tSaveUnder);
+	DestroySurface(&ptSprite->tWork);
+	ZeroMem(ptSprite, sizeof(SPRITE));
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: HideSprite()
+** Description: Puts back the screen saved under a sprite
+** Input:
+**		ptSprite: Sprite
+** Output: Sprite removed from the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+HideSprite(
+	IN OUT   SPRITE                              *ptSprite
+)
+{
+	RECT       tRect;
+	ASSERT_ENSURE(ptSprite != NULL && ptSprite->ptGraphicsOutput != NULL);
+	if (ptSprite->bShown == FALSE)
+		return EFI_SUCCESS;
+	SetSpriteRect(&tRect, ptSprite->nX, ptSprite->nY, ptSprite->tSaveUnder.nWidth, ptSprite->tSaveUnder.nHeight);
+	ASSERT_CHECK_EFISTATUS(DrawBltEx(ptSprite->ptGraphicsOutput, ptSprite->tSaveUnder.ptPixels, EfiBltBufferToVideo, &tRect, NULL, 0));
+	ptSprite->bShown = FALSE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SpriteStripBlt()
+** Description: Reads or writes part of a sprite-sized area between the
+** screen and a buffer, nothing when the part is empty
+** Input:
+**		ptSprite: Sprite
+**		ptBuffer: Sprite-sized buffer
+**		nMode: EfiBltVideoToBltBuffer or EfiBltBufferToVideo
+**		nX, nY: Screen position of the whole area
+**		nLeft, nTop: Part position inside the area
+**		nWidth, nHeight: Part size
+** Output: Updated buffer/screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+SpriteStripBlt(
+	IN CONST SPRITE *ptSprite,
+	IN OUT SURFACE *ptBuffer,
+	IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION nMode,
+	IN INTN nX,
+	IN INTN nY,
+	IN UINTN nLeft,
+	IN UINTN nTop,
+	IN UINTN nWidth,
+	IN UINTN nHeight
+)
+{
+	RECT       tRect;
+	RECT       tSrcRect;
+	if (nWidth == 0 || nHeight == 0)
+		return EFI_SUCCESS;
+	SetSpriteRect(&tRect, nX + (INTN)nLeft, nY + (INTN)nTop, nWidth, nHeight);
+	SetRect(&tSrcRect, nLeft, nTop, nLeft + nWidth - 1, nTop + nHeight - 1);
+	return DrawBltEx(ptSprite->ptGraphicsOutput, ptBuffer->ptPixels, nMode, &tRect, &tSrcRect, ptBuffer->nStride);
+}
+
+/*
+** ===========================================================================
+** Function: MoveSprite()
+** Description: Shows a sprite at a position. When the old and new areas
+** overlap, only the newly covered strips are read, the rest of the new
+** save-under comes from the old one. The uncovered strips are restored and
+** the sprite drawn at the new position, so nothing flickers and no more
+** than the sprite plus the uncovered strips is sent. Far moves restore the
+** old area and draw at the new one.
+** Input:
+**		ptSprite: Sprite, shown or hidden
+**		nX, nY: New top left corner, may be partly off-screen
+** Output: Sprite on the screen at the new position
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+MoveSprite(
+	IN OUT   SPRITE                              *ptSprite,
+	IN       INTN                                nX,
+	IN       INTN                                nY
+)
+{
+	SURFACE    tBack;
+	SURFACE    tFront;
+	RECT       tRect;
+	UINTN      nWidth;
+	UINTN      nHeight;
+	UINTN      nMoveX;
+	UINTN      nMoveY;
+	UINTN      nOldX;
+	UINTN      nOldY;
+	UINTN      nNewX;
+	UINTN      nNewY;
+	ASSERT_ENSURE(ptSprite != NULL && ptSprite->ptGraphicsOutput != NULL);
+	nWidth = ptSprite->tSaveUnder.nWidth;
+	nHeight = ptSprite->tSaveUnder.nHeight;
+	if (ptSprite->bShown == FALSE)
+		return DrawSpriteAt(ptSprite, nX, nY);
+	if (nX == ptSprite->nX && nY == ptSprite->nY)
+		return EFI_SUCCESS;
+	nMoveX = (UINTN)ABS(nX - ptSprite->nX);
+	nMoveY = (UINTN)ABS(nY - ptSprite->nY);
+	if (nMoveX >= nWidth || nMoveY >= nHeight)
+	{
+		ASSERT_CHECK_EFISTATUS(HideSprite(ptSprite));
+		return DrawSpriteAt(ptSprite, nX, nY);
+	}
+	/* The overlap starts here inside the old and the new area */
+	nOldX = (nX > ptSprite->nX) ? nMoveX : 0;
+	nOldY = (nY > ptSprite->nY) ? nMoveY : 0;
+	nNewX = (nX > ptSprite->nX) ? 0 : nMoveX;
+	nNewY = (nY > ptSprite->nY) ? 0 : nMoveY;
+	/* New save-under and composed sprite side by side in the work buffer */
+	ASSERT_CHECK_EFISTATUS(InitSurface(&tBack, ptSprite->tWork.ptPixels, nWidth, nHeight, ptSprite->tWork.nStride, SURFACE_FORMAT_BGRX));
+	ASSERT_CHECK_EFISTATUS(InitSurface(&tFront, ptSprite->tWork.ptPixels + nWidth, nWidth, nHeight, ptSprite->tWork.nStride, SURFACE_FORMAT_BGRX));
+	SurfaceBlt(&tBack, ptSprite->tSaveUnder.ptPixels, EfiBltBufferToVideo, nOldX, nOldY, nNewX, nNewY,
+		nWidth - nMoveX, nHeight - nMoveY, nWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	/* Newly covered: a column strip over the full height and a row strip
+	over the overlap width. Off-screen parts hold stale pixels, the
+	clipping in DrawBltEx() keeps them from ever reaching the screen. */
+	ASSERT_CHECK_EFISTATUS(SpriteStripBlt(ptSprite, &tBack, EfiBltVideoToBltBuffer, nX, nY,
+		(nNewX == 0) ? nWidth - nMoveX : 0, 0, nMoveX, nHeight));
+	ASSERT_CHECK_EFISTATUS(SpriteStripBlt(ptSprite, &tBack, EfiBltVideoToBltBuffer, nX, nY,
+		nNewX, (nNewY == 0) ? nHeight - nMoveY : 0, nWidth - nMoveX, nMoveY));
+	SurfaceBlt(&tFront, tBack.ptPixels, EfiBltBufferToVideo, 0, 0, 0, 0, nWidth, nHeight, tBack.nStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	ComposeSprite(ptSprite, &tFront, 0, 0);
+	/* Uncovered: the same strips on the opposite sides of the old area */
+	ASSERT_CHECK_EFISTATUS(SpriteStripBlt(ptSprite, &ptSprite->tSaveUnder, EfiBltBufferToVideo, ptSprite->nX, ptSprite->nY,
+		(nOldX == 0) ? nWidth - nMoveX : 0, 0, nMoveX, nHeight));
+	ASSERT_CHECK_EFISTATUS(SpriteStripBlt(ptSprite, &ptSprite->tSaveUnder, EfiBltBufferToVideo, ptSprite->nX, ptSprite->nY,
+		nOldX, (nOldY == 0) ? nHeight - nMoveY : 0, nWidth - nMoveX, nMoveY));
+	SetSpriteRect(&tRect, nX, nY, nWidth, nHeight);
+	ASSERT_CHECK_EFISTATUS(DrawBltEx(ptSprite->ptGraphicsOutput, tFront.ptPixels, EfiBltBufferToVideo, &tRect, NULL, tFront.nStride));
+	SurfaceBlt(&ptSprite->tSaveUnder, tBack.ptPixels, EfiBltBufferToVideo, 0, 0, 0, 0, nWidth, nHeight, tBack.nStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	ptSprite->nX = nX;
+	ptSprite->nY = nY;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetSpriteImage()
+** Description: Changes the image of a sprite (animation frames, pointer
+** shapes). A shown sprite is redrawn from its save-under, the screen is not
+** read again.
+** Input:
+**		ptSprite: Sprite
+**		ptImage: New image, same size as the one given to CreateSprite()
+** Output: Sprite with the new image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetSpriteImage(
+	IN OUT   SPRITE                              *ptSprite,
+	IN CONST SURFACE                             *ptImage
+)
+{
+	RECT       tRect;
+	UINTN      nWidth;
+	UINTN      nHeight;
+	ASSERT_ENSURE(ptSprite != NULL && ptSprite->ptGraphicsOutput != NULL && ptImage != NULL && ptImage->ptPixels != NULL);
+	nWidth = ptSprite->tSaveUnder.nWidth;
+	nHeight = ptSprite->tSaveUnder.nHeight;
+	ASSERT_CHECK(ptImage->nWidth == nWidth && ptImage->nHeight == nHeight);
+	ptSprite->ptImage = ptImage;
+	if (ptSprite->bShown == FALSE)
+		return EFI_SUCCESS;
+	SurfaceBlt(&ptSprite->tWork, ptSprite->tSaveUnder.ptPixels, EfiBltBufferToVideo, 0, 0, 0, 0, nWidth, nHeight, 0);
+	ComposeSprite(ptSprite, &ptSprite->tWork, 0, 0);
+	SetSpriteRect(&tRect, ptSprite->nX, ptSprite->nY, nWidth, nHeight);
+	return DrawBltEx(ptSprite->ptGraphicsOutput, ptSprite->tWork.ptPixels, EfiBltBufferToVideo, &tRect, NULL, ptSprite->tWork.nStride);
+}
+
+/*
+** ===========================================================================
+** Function: TrackPointerSprite()
+** Description: Reads a pointer device and moves a sprite with it, kept
+** inside the current mode. Counts below one pixel are carried over to the
+** next call, so slow movements are not lost.
+** Input:
+**		ptSprite: Sprite, shown where the pointer starts
+**		ptPointer: Pointer device
+**		ptState: Pointer state read, NULL = not needed
+** Output: Moved sprite
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** (also when the device had no new state)
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TrackPointerSprite(
+	IN OUT   SPRITE                              *ptSprite,
+	IN       EFI_SIMPLE_POINTER_PROTOCOL         *ptPointer,
+	OUT      EFI_SIMPLE_POINTER_STATE            *ptState OPTIONAL
+)
+{
+	EFI_SIMPLE_POINTER_STATE tState;
+	INTN       nResolutionX;
+	INTN       nResolutionY;
+	INTN       nX;
+	INTN       nY;
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptSprite != NULL && ptSprite->ptGraphicsOutput != NULL && ptPointer != NULL);
+	nStatus = ptPointer->GetState(ptPointer, &tState);
+	if (nStatus == EFI_NOT_READY)
+	{
+		if (ptState != NULL)
+			ZeroMem(ptState, sizeof(EFI_SIMPLE_POINTER_STATE));
+		return EFI_SUCCESS;
+	}
+	ASSERT_CHECK_EFISTATUS(nStatus);
+	if (ptState != NULL)
+		CopyMem(ptState, &tState, sizeof(EFI_SIMPLE_POINTER_STATE));
+	/* Resolution is counts per millimeter, 0 when the device does not say */
+	nResolutionX = (ptPointer->Mode != NULL && ptPointer->Mode->ResolutionX != 0) ? (INTN)ptPointer->Mode->ResolutionX : 1;
+	nResolutionY = (ptPointer->Mode != NULL && ptPointer->Mode->ResolutionY != 0) ? (INTN)ptPointer->Mode->ResolutionY : 1;
+	ptSprite->nPointerRestX += (INTN)tState.RelativeMovementX * SPRITE_POINTER_SPEED;
+	ptSprite->nPointerRestY += (INTN)tState.RelativeMovementY * SPRITE_POINTER_SPEED;
+	nX = ptSprite->nX + ptSprite->nPointerRestX / nResolutionX;
+	nY = ptSprite->nY + ptSprite->nPointerRestY / nResolutionY;
+	ptSprite->nPointerRestX %= nResolutionX;
+	ptSprite->nPointerRestY %= nResolutionY;
+	nX = MAX(0, MIN(nX, (INTN)ptSprite->ptGraphicsOutput->Mode->Info->HorizontalResolution - 1));
+	nY = MAX(0, MIN(nY, (INTN)ptSprite->ptGraphicsOutput->Mode->Info->VerticalResolution - 1));
+	return MoveSprite(ptSprite, nX, nY);
+}
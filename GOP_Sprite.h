@@ -0,0 +1,186 @@
+/*
+** ===========================================================================
+** File: GOP_Sprite.h
+** Description: UEFI graphics-related code module (sprites and pointer)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_SPRITE_H_
+#define _GRAPHICS_GOP_SPRITE_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <Protocol/SimplePointer.h>
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define SPRITE_POINTER_SPEED	4	/* Pointer pixels per millimeter moved */
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;
+	CONST SURFACE                                *ptImage;		/* Sprite image, BGRA is blended */
+	BOOLEAN                                      bColorKey;		/* Pixels of tColorKey are transparent */
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                tColorKey;
+	BOOLEAN                                      bShown;
+	INTN                                         nX;			/* Top left corner, may be off-screen */
+	INTN                                         nY;
+	SURFACE                                      tSaveUnder;	/* Screen under the sprite */
+	SURFACE                                      tWork;			/* New save-under and composed sprite while moving */
+	INTN                                         nPointerRestX;	/* Pointer counts not yet moved */
+	INTN                                         nPointerRestY;
+} SPRITE;
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: CreateSprite()
+** Description: Prepares a hidden sprite. Its save-under and work buffers
+** are allocated once here, so showing and moving it never allocates.
+** Input:
+**		ptSprite: Sprite to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptImage: Sprite image, must stay valid while the sprite exists.
+**		SURFACE_FORMAT_BGRA images are blended.
+**		ptColorKey: Transparent color of a BGRX image, NULL = none
+** Output: Hidden sprite
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CreateSprite(
+	OUT      SPRITE                              *ptSprite,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptImage,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptColorKey OPTIONAL
+);
+
+/*
+** ===========================================================================
+** Function: DestroySprite()
+** Description: Hides a sprite and frees its buffers
+** Input:
+**		ptSprite: Sprite
+** Output: Freed sprite
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DestroySprite(
+	IN OUT   SPRITE                              *ptSprite
+);
+
+/*
+** ===========================================================================
+** Function: HideSprite()
+** Description: Puts back the screen saved under a sprite
+** Input:
+**		ptSprite: Sprite
+** Output: Sprite removed from the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+HideSprite(
+	IN OUT   SPRITE                              *ptSprite
+);
+
+/*
+** ===========================================================================
+** Function: MoveSprite()
+** Description: Shows a sprite at a position. When the old and new areas
+** overlap, only the newly covered strips are read, the rest of the new
+** save-under comes from the old one. The uncovered strips are restored and
+** the sprite drawn at the new position, so nothing flickers and no more
+** than the sprite plus the uncovered strips is sent. Far moves restore the
+** old area and draw at the new one.
+** Input:
+**		ptSprite: Sprite, shown or hidden
+**		nX, nY: New top left corner, may be partly off-screen
+** Output: Sprite on the screen at the new position
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+MoveSprite(
+	IN OUT   SPRITE                              *ptSprite,
+	IN       INTN                                nX,
+	IN       INTN                                nY
+);
+
+/*
+** ===========================================================================
+** Function: SetSpriteImage()
+** Description: Changes the image of a sprite (animation frames, pointer
+** shapes). A shown sprite is redrawn from its save-under, the screen is not
+** read again.
+** Input:
+**		ptSprite: Sprite
+**		ptImage: New image, same size as the one given to CreateSprite()
+** Output: Sprite with the new image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetSpriteImage(
+	IN OUT   SPRITE                              *ptSprite,
+	IN CONST SURFACE                             *ptImage
+);
+
+/*
+** ===========================================================================
+** Function: TrackPointerSprite()
+** Description: Reads a pointer device and moves a sprite with it, kept
+** inside the current mode. Counts below one pixel are carried over to the
+** next call, so slow movements are not lost.
+** Input:
+**		ptSprite: Sprite, shown where the pointer starts
+**		ptPointer: Pointer device
+**		ptState: Pointer state read, NULL = not needed
+** Output: Moved sprite
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** (also when the device had no new state)
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TrackPointerSprite(
+	IN OUT   SPRITE                              *ptSprite,
+	IN       EFI_SIMPLE_POINTER_PROTOCOL         *ptPointer,
+	OUT      EFI_SIMPLE_POINTER_STATE            *ptState OPTIONAL
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_SPRITE_H_ */
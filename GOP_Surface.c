@@ -0,0 +1,297 @@
+/*
+** ===========================================================================
+** File: GOP_Surface.c
+** Description: UEFI graphics-related code module (off-screen surfaces)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Surface.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: CreateSurface()
+** Description: Allocates an off-screen surface
+** Input:
+**		ptSurface: Surface to initialize
+**		nWidth, nHeight: Surface size
+**		nFormat: SURFACE_FORMAT_*
+** Output: Surface with uninitialized pixels
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CreateSurface(
+	OUT      SURFACE                             *ptSurface,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       UINTN                               nFormat
+)
+{
+	ASSERT_ENSURE(ptSurface != NULL && nWidth != 0 && nHeight != 0);
+	ASSERT_CHECK(nHeight <= (UINTN)~0 / sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL) / nWidth);
+	ASSERT_CHECK((ptSurface->ptPixels = AllocatePool(nWidth * nHeight * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL))) != NULL);
+	ptSurface->nWidth = nWidth;
+	ptSurface->nHeight = nHeight;
+	ptSurface->nStride = nWidth;
+	ptSurface->nFormat = nFormat;
+	ptSurface->bOwnsPixels = TRUE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: InitSurface()
+** Description: Wraps existing BLT pixels (decoded image, shadow buffer...)
+** in a surface without copying them
+** Input:
+**		ptSurface: Surface to initialize
+**		ptPixels: First pixel
+**		nWidth, nHeight: Surface size
+**		nStride: Pixels per row
+**		nFormat: SURFACE_FORMAT_*
+** Output: Surface sharing the given pixels
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitSurface(
+	OUT      SURFACE                             *ptSurface,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptPixels,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       UINTN                               nStride,
+	IN       UINTN                               nFormat
+)
+{
+	ASSERT_ENSURE(ptSurface != NULL && ptPixels != NULL && nWidth != 0 && nHeight != 0 && nStride >= nWidth);
+	ptSurface->ptPixels = ptPixels;
+	ptSurface->nWidth = nWidth;
+	ptSurface->nHeight = nHeight;
+	ptSurface->nStride = nStride;
+	ptSurface->nFormat = nFormat;
+	ptSurface->bOwnsPixels = FALSE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: CreateSubSurface()
+** Description: Creates a view of part of a surface. The view shares pixels
+** and stride with its parent, so drawing into it draws into the parent.
+** Input:
+**		ptView: Surface to initialize
+**		ptParent: Parent surface
+**		ptRect: Area of the parent, clipped to it
+** Output: Sub-surface view
+** Return value: EFI_LOAD_ERROR -> Failure (empty area), EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CreateSubSurface(
+	OUT      SURFACE                             *ptView,
+	IN CONST SURFACE                             *ptParent,
+	IN CONST RECT                                *ptRect
+)
+{
+	RECT       tBounds;
+	RECT       tArea;
+	RECT       *ptArea = &tArea;
+	ASSERT_ENSURE(ptView != NULL && ptParent != NULL && ptRect != NULL);
+	SetRect(&tBounds, 0, 0, ptParent->nWidth - 1, ptParent->nHeight - 1);
+	ASSERT_CHECK(IntersectRect(&tArea, &tBounds, ptRect) == TRUE);
+	ptView->ptPixels = SurfacePixel(ptParent, tArea.nLeft, tArea.nTop);
+	ptView->nWidth = WidthRect(ptArea);
+	ptView->nHeight = HeightRect(ptArea);
+	ptView->nStride = ptParent->nStride;
+	ptView->nFormat = ptParent->nFormat;
+	ptView->bOwnsPixels = FALSE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: DestroySurface()
+** Description: Frees the pixels of a surface created by CreateSurface(),
+** views and wrapped buffers are only reset
+** Input:
+**		ptSurface: Surface
+** Output: Empty surface
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DestroySurface(
+	IN OUT   SURFACE                             *ptSurface
+)
+{
+	ASSERT_ENSURE(ptSurface != NULL);
+	if (ptSurface->bOwnsPixels == TRUE && ptSurface->ptPixels != NULL)
+		FreePool(ptSurface->ptPixels);
+	ZeroMem(ptSurface, sizeof(SURFACE));
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SurfaceBlt()
+** Description: Performs a BLT operation on a surface with the semantics of
+** EFI_GRAPHICS_OUTPUT_PROTOCOL.Blt(), the surface taking the place of video
+** memory. The operation must lie inside the surface.
+** Input:
+**		ptSurface: Surface
+**		ptBlt: BLT pixel buffer (unused for EfiBltVideoToVideo)
+**		nMode: BLT opmode
+**		nBufX, nBufY: Position inside the BLT buffer (source position on the
+**		surface for EfiBltVideoToVideo)
+**		nX, nY: Position on the surface
+**		nWidth, nHeight: Size of the operation
+**		nDelta: BLT buffer stride in bytes (0 = nWidth pixels)
+** Output: Updated surface/BLT buffer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SurfaceBlt(
+	IN       SURFACE                             *ptSurface,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_OPERATION   nMode,
+	IN       UINTN                               nBufX,
+	IN       UINTN                               nBufY,
+	IN       UINTN                               nX,
+	IN       UINTN                               nY,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       UINTN                               nDelta
+)
+{
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptRow;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptBufRow;
+	UINTN      nStride;
+	UINTN      nRow;
+	UINTN      nCol;
+	UINTN      nRowSize;
+	ASSERT_ENSURE(ptSurface != NULL && ptSurface->ptPixels != NULL);
+	ASSERT_CHECK(nX + nWidth <= ptSurface->nWidth && nY + nHeight <= ptSurface->nHeight);
+	if (nWidth == 0 || nHeight == 0)
+		return EFI_SUCCESS;
+	nStride = (nDelta == 0) ? nWidth : nDelta / sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+	nRowSize = nWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+	ptRow = SurfacePixel(ptSurface, nX, nY);
+	switch (nMode) {
+	case EfiBltVideoFill:
+		ASSERT_ENSURE(ptBlt != NULL);
+		for (nCol = 0; nCol < nWidth; nCol++)
+			ptRow[nCol] = *ptBlt;
+		for (nRow = 1; nRow < nHeight; nRow++)
+			CopyMem(ptRow + nRow * ptSurface->nStride, ptRow, nRowSize);
+		break;
+	case EfiBltBufferToVideo:
+		ASSERT_ENSURE(ptBlt != NULL);
+		ptBufRow = ptBlt + nBufY * nStride + nBufX;
+		for (nRow = 0; nRow < nHeight; nRow++)
+			CopyMem(ptRow + nRow * ptSurface->nStride, ptBufRow + nRow * nStride, nRowSize);
+		break;
+	case EfiBltVideoToBltBuffer:
+		ASSERT_ENSURE(ptBlt != NULL);
+		ptBufRow = ptBlt + nBufY * nStride + nBufX;
+		for (nRow = 0; nRow < nHeight; nRow++)
+			CopyMem(ptBufRow + nRow * nStride, ptRow + nRow * ptSurface->nStride, nRowSize);
+		break;
+	case EfiBltVideoToVideo:
+		ASSERT_CHECK(nBufX + nWidth <= ptSurface->nWidth && nBufY + nHeight <= ptSurface->nHeight);
+		ptBufRow = SurfacePixel(ptSurface, nBufX, nBufY);
+		/* Walk rows against the direction of the move so overlapping areas
+		are read before they are overwritten, CopyMem() handles each row */
+		if (nY > nBufY)
+		{
+			for (nRow = nHeight; nRow-- > 0;)
+				CopyMem(ptRow + nRow * ptSurface->nStride, ptBufRow + nRow * ptSurface->nStride, nRowSize);
+		}
+		else
+		{
+			for (nRow = 0; nRow < nHeight; nRow++)
+				CopyMem(ptRow + nRow * ptSurface->nStride, ptBufRow + nRow * ptSurface->nStride, nRowSize);
+		}
+		break;
+	default:
+		return EFI_LOAD_ERROR;
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: PresentSurface()
+** Description: Outputs a surface in one operation. The output goes through
+** DrawBltEx(), so it lands in the draw target bound to the GOP if any (for
+** compositing surfaces into each other) and on screen otherwise.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface
+**		ptRect: Destination rectangle, the surface's top left corner is drawn
+**		at its top left corner
+** Output: Surface output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+PresentSurface(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptSurface,
+	IN CONST RECT                                *ptRect
+)
+{
+	RECT       tSrcRect;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptSurface != NULL && ptSurface->ptPixels != NULL && ptRect != NULL);
+	SetRect(&tSrcRect, 0, 0, ptSurface->nWidth - 1, ptSurface->nHeight - 1);
+	return DrawBltEx(ptGraphicsOutput, ptSurface->ptPixels, EfiBltBufferToVideo, ptRect, &tSrcRect, ptSurface->nStride);
+}
@@ -0,0 +1,208 @@
+/*
+** ===========================================================================
+** File: GOP_Surface.h
+** Description: UEFI graphics-related code module (off-screen surfaces)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#define _GRAPHICS_GOP_SURFACE_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <Protocol/GraphicsOutput.h>
+#ifndef _GRAPHICS_RECTANGLE_H_
+#include "Rectangle.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+enum
+{
+	SURFACE_FORMAT_BGRX,	/* Reserved byte unused */
+	SURFACE_FORMAT_BGRA		/* Reserved byte holds alpha, colors premultiplied by it */
+};
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                *ptPixels;
+	UINTN                                        nWidth;
+	UINTN                                        nHeight;
+	UINTN                                        nStride;		/* Pixels per row */
+	UINTN                                        nFormat;		/* SURFACE_FORMAT_* */
+	BOOLEAN                                      bOwnsPixels;	/* FALSE for views */
+} SURFACE;
+
+/* Address of pixel (nX, nY) */
+#define SurfacePixel(ptSurface, nX, nY) ((ptSurface)->ptPixels + (nY) * (ptSurface)->nStride + (nX))
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: CreateSurface()
+** Description: Allocates an off-screen surface
+** Input:
+**		ptSurface: Surface to initialize
+**		nWidth, nHeight: Surface size
+**		nFormat: SURFACE_FORMAT_*
+** Output: Surface with uninitialized pixels
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CreateSurface(
+	OUT      SURFACE                             *ptSurface,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       UINTN                               nFormat
+);
+
+/*
+** ===========================================================================
+** Function: InitSurface()
+** Description: Wraps existing BLT pixels (decoded image, shadow buffer...)
+** in a surface without copying them
+** Input:
+**		ptSurface: Surface to initialize
+**		ptPixels: First pixel
+**		nWidth, nHeight: Surface size
+**		nStride: Pixels per row
+**		nFormat: SURFACE_FORMAT_*
+** Output: Surface sharing the given pixels
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitSurface(
+	OUT      SURFACE                             *ptSurface,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptPixels,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       UINTN                               nStride,
+	IN       UINTN                               nFormat
+);
+
+/*
+** ===========================================================================
+** Function: CreateSubSurface()
+** Description: Creates a view of part of a surface. The view shares pixels
+** and stride with its parent, so drawing into it draws into the parent.
+** Input:
+**		ptView: Surface to initialize
+**		ptParent: Parent surface
+**		ptRect: Area of the parent, clipped to it
+** Output: Sub-surface view
+** Return value: EFI_LOAD_ERROR -> Failure (empty area), EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CreateSubSurface(
+	OUT      SURFACE                             *ptView,
+	IN CONST SURFACE                             *ptParent,
+	IN CONST RECT                                *ptRect
+);
+
+/*
+** ===========================================================================
+** Function: DestroySurface()
+** Description: Frees the pixels of a surface created by CreateSurface(),
+** views and wrapped buffers are only reset
+** Input:
+**		ptSurface: Surface
+** Output: Empty surface
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DestroySurface(
+	IN OUT   SURFACE                             *ptSurface
+);
+
+/*
+** ===========================================================================
+** Function: SurfaceBlt()
+** Description: Performs a BLT operation on a surface with the semantics of
+** EFI_GRAPHICS_OUTPUT_PROTOCOL.Blt(), the surface taking the place of video
+** memory. The operation must lie inside the surface.
+** Input:
+**		ptSurface: Surface
+**		ptBlt: BLT pixel buffer (unused for EfiBltVideoToVideo)
+**		nMode: BLT opmode
+**		nBufX, nBufY: Position inside the BLT buffer (source position on the
+**		surface for EfiBltVideoToVideo)
+**		nX, nY: Position on the surface
+**		nWidth, nHeight: Size of the operation
+**		nDelta: BLT buffer stride in bytes (0 = nWidth pixels)
+** Output: Updated surface/BLT buffer
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SurfaceBlt(
+	IN       SURFACE                             *ptSurface,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBlt,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_OPERATION   nMode,
+	IN       UINTN                               nBufX,
+	IN       UINTN                               nBufY,
+	IN       UINTN                               nX,
+	IN       UINTN                               nY,
+	IN       UINTN                               nWidth,
+	IN       UINTN                               nHeight,
+	IN       UINTN                               nDelta
+);
+
+/*
+** ===========================================================================
+** Function: PresentSurface()
+** Description: Outputs a surface in one operation. The output goes through
+** DrawBltEx(), so it lands in the draw target bound to the GOP if any (for
+** compositing surfaces into each other) and on screen otherwise.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptSurface: Surface
+**		ptRect: Destination rectangle, the surface's top left corner is drawn
+**		at its top left corner
+** Output: Surface output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+PresentSurface(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptSurface,
+	IN CONST RECT                                *ptRect
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_SURFACE_H_ */
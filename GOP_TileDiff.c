@@ -0,0 +1,337 @@
+/*
+** ===========================================================================
+** File: GOP_TileDiff.c
+** Description: UEFI graphics-related code module (tile-diff image updates)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Surface.h"
+#include "GOP_TileDiff.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+static BOOLEAN gbTileDiff = FALSE;
+static RETAINED_IMAGE gatRetained[TILE_DIFF_MAX];
+static UINTN gnNextRetained = 0;
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: DropRetained()
+** Description: Frees the copy kept in a retained image slot
+** Input:
+**		ptRetained: Slot
+** Output: Unused slot
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+DropRetained(
+	IN OUT RETAINED_IMAGE *ptRetained
+)
+{
+	if (ptRetained->ptGraphicsOutput == NULL)
+		return;
+	DestroySurface(&ptRetained->tCopy);
+	ptRetained->ptGraphicsOutput = NULL;
+}
+
+/*
+** ===========================================================================
+** Function: FindRetained()
+** Description: Looks up the copy of what was last drawn at exactly a
+** rectangle of a GOP
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptRect: Rectangle on screen
+** Output: None
+** Return value: Slot, NULL when nothing was retained there
+** ===========================================================================
+*/
+static
+RETAINED_IMAGE *
+FindRetained(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST RECT *ptRect
+)
+{
+	UINTN      nIndex;
+	for (nIndex = 0; nIndex < TILE_DIFF_MAX; nIndex++)
+	{
+		if (gatRetained[nIndex].ptGraphicsOutput == ptGraphicsOutput &&
+			CompareMem(&gatRetained[nIndex].tRect, ptRect, sizeof(RECT)) == 0)
+			return &gatRetained[nIndex];
+	}
+	return NULL;
+}
+
+/*
+** ===========================================================================
+** Function: IsTileChanged()
+** Description: Compares one tile of an image against the retained copy and
+** refreshes the copy when it differs. Rows are compared with CompareMem(),
+** which stops at the first difference.
+** Input:
+**		ptCopy: Retained copy
+**		ptImage: New image, same size as the copy
+**		nX, nY: Tile position
+**		nWidth, nHeight: Tile size
+** Output: Updated copy
+** Return value: TRUE -> Tile changed, FALSE -> Tile identical
+** ===========================================================================
+*/
+static
+BOOLEAN
+IsTileChanged(
+	IN OUT SURFACE *ptCopy,
+	IN CONST SURFACE *ptImage,
+	IN UINTN nX,
+	IN UINTN nY,
+	IN UINTN nWidth,
+	IN UINTN nHeight
+)
+{
+	UINTN      nRowSize = nWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+	UINTN      nRow;
+	for (nRow = 0; nRow < nHeight; nRow++)
+	{
+		if (CompareMem(SurfacePixel(ptCopy, nX, nY + nRow), SurfacePixel(ptImage, nX, nY + nRow), nRowSize) != 0)
+			break;
+	}
+	if (nRow == nHeight)
+		return FALSE;
+	/* Rows before the first difference are already equal */
+	for (; nRow < nHeight; nRow++)
+		CopyMem(SurfacePixel(ptCopy, nX, nY + nRow), SurfacePixel(ptImage, nX, nY + nRow), nRowSize);
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: OutputTileRun()
+** Description: Outputs a run of neighbouring tiles of an image in one BLT
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptImage: Image
+**		ptRect: Image rectangle on screen
+**		nX, nY: Run position in the image
+**		nWidth, nHeight: Run size
+** Output: Tiles output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+OutputTileRun(
+	IN EFI_GRAPHICS_OUTPUT_PROTOCOL *ptGraphicsOutput,
+	IN CONST SURFACE *ptImage,
+	IN CONST RECT *ptRect,
+	IN UINTN nX,
+	IN UINTN nY,
+	IN UINTN nWidth,
+	IN UINTN nHeight
+)
+{
+	RECT       tDest;
+	RECT       tSrc;
+	SetRect(&tSrc, nX, nY, nX + nWidth - 1, nY + nHeight - 1);
+	SetRect(&tDest, ptRect->nLeft + nX, ptRect->nTop + nY, ptRect->nLeft + nX + nWidth - 1, ptRect->nTop + nY + nHeight - 1);
+	return DrawBltEx(ptGraphicsOutput, ptImage->ptPixels, EfiBltBufferToVideo, &tDest, &tSrc, ptImage->nStride);
+}
+
+/*
+** ===========================================================================
+** Function: SetTileDiff()
+** Description: Turns tile-diff updates of images drawn by DrawBmpImage() and
+** DrawQoiImage() on or off. Turning them off frees every retained copy.
+** Input:
+**		bEnable: TRUE = on, FALSE = off
+** Output: Tile-diff state
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetTileDiff(
+	IN       BOOLEAN                             bEnable
+)
+{
+	if (bEnable == FALSE)
+		InvalidateTileDiff(NULL);
+	gbTileDiff = bEnable;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: IsTileDiffEnabled()
+** Description: Tells whether tile-diff updates are on
+** Input: None
+** Output: None
+** Return value: TRUE -> On, FALSE -> Off
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+IsTileDiffEnabled(
+	VOID
+)
+{
+	return gbTileDiff;
+}
+
+/*
+** ===========================================================================
+** Function: InvalidateTileDiff()
+** Description: Forgets the retained copies of a GOP, so the next image drawn
+** there is sent in full. Call this after drawing over a retained image by
+** other means or after a mode change.
+** Input:
+**		ptGraphicsOutput: Output protocol, NULL = every GOP
+** Output: Freed copies
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InvalidateTileDiff(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput OPTIONAL
+)
+{
+	UINTN      nIndex;
+	for (nIndex = 0; nIndex < TILE_DIFF_MAX; nIndex++)
+	{
+		if (ptGraphicsOutput == NULL || gatRetained[nIndex].ptGraphicsOutput == ptGraphicsOutput)
+			DropRetained(&gatRetained[nIndex]);
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: DrawSurfaceDiff()
+** Description: Outputs an opaque image, sending only the TILE_DIFF_SIZE
+** tiles that differ from the image last drawn at exactly the same
+** rectangle. Changed tiles next to each other in a tile row go out in one
+** BLT. The first image drawn at a rectangle is sent in full and retained.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptImage: Image, alpha is ignored
+**		ptRect: Destination rectangle, must be the image size
+** Output: Image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSurfaceDiff(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptImage,
+	IN CONST RECT                                *ptRect
+)
+{
+	RETAINED_IMAGE *ptRetained;
+	UINTN      nTileX;
+	UINTN      nTileY;
+	UINTN      nTileHeight;
+	UINTN      nRunX = 0;
+	BOOLEAN    bInRun;
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptGraphicsOutput != NULL && ptImage != NULL && ptImage->ptPixels != NULL && ptRect != NULL);
+	ASSERT_CHECK(WidthRect(ptRect) == ptImage->nWidth && HeightRect(ptRect) == ptImage->nHeight);
+	ptRetained = FindRetained(ptGraphicsOutput, ptRect);
+	if (ptRetained == NULL)
+	{
+		/* First image here: send it in full and retain a copy, replacing
+		the oldest slot when all are used */
+		ASSERT_CHECK_EFISTATUS(PresentSurface(ptGraphicsOutput, ptImage, ptRect));
+		ptRetained = &gatRetained[gnNextRetained];
+		gnNextRetained = (gnNextRetained + 1) % TILE_DIFF_MAX;
+		DropRetained(ptRetained);
+		if (CreateSurface(&ptRetained->tCopy, ptImage->nWidth, ptImage->nHeight, ptImage->nFormat) != EFI_SUCCESS)
+			return EFI_SUCCESS;
+		SurfaceBlt(&ptRetained->tCopy, ptImage->ptPixels, EfiBltBufferToVideo, 0, 0, 0, 0, ptImage->nWidth, ptImage->nHeight,
+			ptImage->nStride * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+		ptRetained->ptGraphicsOutput = ptGraphicsOutput;
+		CopyMem(&ptRetained->tRect, ptRect, sizeof(RECT));
+		return EFI_SUCCESS;
+	}
+	for (nTileY = 0; nTileY < ptImage->nHeight; nTileY += TILE_DIFF_SIZE)
+	{
+		nTileHeight = MIN(TILE_DIFF_SIZE, ptImage->nHeight - nTileY);
+		bInRun = FALSE;
+		for (nTileX = 0; nTileX < ptImage->nWidth; nTileX += TILE_DIFF_SIZE)
+		{
+			if (IsTileChanged(&ptRetained->tCopy, ptImage, nTileX, nTileY, MIN(TILE_DIFF_SIZE, ptImage->nWidth - nTileX), nTileHeight))
+			{
+				if (bInRun == FALSE)
+					nRunX = nTileX;
+				bInRun = TRUE;
+				continue;
+			}
+			if (bInRun)
+			{
+				nStatus = OutputTileRun(ptGraphicsOutput, ptImage, ptRect, nRunX, nTileY, nTileX - nRunX, nTileHeight);
+				if (nStatus != EFI_SUCCESS)
+				{
+					/* The copy no longer matches the screen */
+					DropRetained(ptRetained);
+					return nStatus;
+				}
+			}
+			bInRun = FALSE;
+		}
+		if (bInRun)
+		{
+			nStatus = OutputTileRun(ptGraphicsOutput, ptImage, ptRect, nRunX, nTileY, ptImage->nWidth - nRunX, nTileHeight);
+			if (nStatus != EFI_SUCCESS)
+			{
+				DropRetained(ptRetained);
+				return nStatus;
+			}
+		}
+	}
+	return EFI_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/*
+** ===========================================================================
+** File: GOP_TileDiff.h
+** Description: UEFI graphics-related code module (tile-diff image updates)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_TILEDIFF_H_
+#define _GRAPHICS_GOP_TILEDIFF_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define TILE_DIFF_SIZE		32	/* Tile side in pixels */
+#define TILE_DIFF_MAX		4	/* Images retained at once */
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;	/* NULL = slot unused */
+	RECT                                         tRect;			/* Where the copy is on screen */
+	SURFACE                                      tCopy;			/* Pixels last sent there */
+} RETAINED_IMAGE;
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: SetTileDiff()
+** Description: Turns tile-diff updates of images drawn by DrawBmpImage() and
+** DrawQoiImage() on or off. Turning them off frees every retained copy.
+** Input:
+**		bEnable: TRUE = on, FALSE = off
+** Output: Tile-diff state
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetTileDiff(
+	IN       BOOLEAN                             bEnable
+);
+
+/*
+** ===========================================================================
+** Function: IsTileDiffEnabled()
+** Description: Tells whether tile-diff updates are on
+** Input: None
+** Output: None
+** Return value: TRUE -> On, FALSE -> Off
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+IsTileDiffEnabled(
+	VOID
+);
+
+/*
+** ===========================================================================
+** Function: InvalidateTileDiff()
+** Description: Forgets the retained copies of a GOP, so the next image drawn
+** there is sent in full. Call this after drawing over a retained image by
+** other means or after a mode change.
+** Input:
+**		ptGraphicsOutput: Output protocol, NULL = every GOP
+** Output: Freed copies
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InvalidateTileDiff(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput OPTIONAL
+);
+
+/*
+** ===========================================================================
+** Function: DrawSurfaceDiff()
+** Description: Outputs an opaque image, sending only the TILE_DIFF_SIZE
+** tiles that differ from the image last drawn at exactly the same
+** rectangle. Changed tiles next to each other in a tile row go out in one
+** BLT. The first image drawn at a rectangle is sent in full and retained.
+** Input:
+**		ptGraphicsOutput: Output protocol
+**		ptImage: Image, alpha is ignored
+**		ptRect: Destination rectangle, must be the image size
+** Output: Image output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSurfaceDiff(
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptImage,
+	IN CONST RECT                                *ptRect
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_TILEDIFF_H_ */
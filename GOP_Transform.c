@@ -0,0 +1,258 @@
+/*
+** ===========================================================================
+** File: GOP_Transform.c
+** Description: UEFI graphics-related code module (rotate/flip transforms)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "GOP_Surface.h"
+#include "GOP_Transform.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/* Side of the square blocks rotated at once: the source and destination
+blocks (2 x 16 x 16 pixels, 2 KiB) stay in L1 while a block is transposed */
+#define TRANSFORM_TILE	16
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+static UINTN gnImageTransform = TRANSFORM_NONE;
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: RotateTiles()
+** Description: Rotates a surface by 90 or 270 degrees block by block, so
+** the column-wise side of the transpose never walks more than
+** TRANSFORM_TILE rows before they are reused
+** Input:
+**		ptSrc: Source surface
+**		ptDest: Destination surface, nHeight x nWidth of the source
+**		bClockwise: TRUE = 90 degrees, FALSE = 270 degrees
+** Output: Rotated pixels
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+RotateTiles(
+	IN CONST SURFACE *ptSrc,
+	IN OUT SURFACE *ptDest,
+	IN BOOLEAN bClockwise
+)
+{
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptSrcRow;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptDestRow;
+	UINTN      nTileX;
+	UINTN      nTileY;
+	UINTN      nEndX;
+	UINTN      nEndY;
+	UINTN      nX;
+	UINTN      nY;
+	for (nTileY = 0; nTileY < ptSrc->nHeight; nTileY += TRANSFORM_TILE)
+	{
+		nEndY = MIN(nTileY + TRANSFORM_TILE, ptSrc->nHeight);
+		for (nTileX = 0; nTileX < ptSrc->nWidth; nTileX += TRANSFORM_TILE)
+		{
+			nEndX = MIN(nTileX + TRANSFORM_TILE, ptSrc->nWidth);
+			/* Each source column becomes a destination row, written
+			sequentially */
+			for (nX = nTileX; nX < nEndX; nX++)
+			{
+				if (bClockwise)
+				{
+					/* (x, y) -> (height - 1 - y, x) */
+					ptDestRow = SurfacePixel(ptDest, ptSrc->nHeight - 1 - nTileY, nX);
+					ptSrcRow = SurfacePixel(ptSrc, nX, nTileY);
+					for (nY = nTileY; nY < nEndY; nY++, ptSrcRow += ptSrc->nStride)
+						*ptDestRow-- = *ptSrcRow;
+				}
+				else
+				{
+					/* (x, y) -> (y, width - 1 - x) */
+					ptDestRow = SurfacePixel(ptDest, nTileY, ptSrc->nWidth - 1 - nX);
+					ptSrcRow = SurfacePixel(ptSrc, nX, nTileY);
+					for (nY = nTileY; nY < nEndY; nY++, ptSrcRow += ptSrc->nStride)
+						*ptDestRow++ = *ptSrcRow;
+				}
+			}
+		}
+	}
+}
+
+/*
+** ===========================================================================
+** Function: MirrorRows()
+** Description: Copies rows in (TRANSFORM_FLIP_V) or reversed
+** (TRANSFORM_FLIP_H) order, or both (TRANSFORM_ROTATE_180). These stay
+** row-sequential on both sides, no blocking is needed.
+** Input:
+**		ptSrc: Source surface
+**		ptDest: Destination surface of the same size
+**		bMirrorX: Reverse each row
+**		bMirrorY: Reverse row order
+** Output: Mirrored pixels
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+MirrorRows(
+	IN CONST SURFACE *ptSrc,
+	IN OUT SURFACE *ptDest,
+	IN BOOLEAN bMirrorX,
+	IN BOOLEAN bMirrorY
+)
+{
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptSrcRow;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptDestRow;
+	UINTN      nX;
+	UINTN      nY;
+	for (nY = 0; nY < ptSrc->nHeight; nY++)
+	{
+		ptSrcRow = SurfacePixel(ptSrc, 0, nY);
+		ptDestRow = SurfacePixel(ptDest, 0, bMirrorY ? ptSrc->nHeight - 1 - nY : nY);
+		if (bMirrorX == FALSE)
+		{
+			CopyMem(ptDestRow, ptSrcRow, ptSrc->nWidth * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+			continue;
+		}
+		for (nX = ptSrc->nWidth; nX-- > 0;)
+			*ptDestRow++ = ptSrcRow[nX];
+	}
+}
+
+/*
+** ===========================================================================
+** Function: TransformSurface()
+** Description: Rotates or mirrors a surface into a new one. Rotations by 90
+** and 270 degrees are done in cache-sized blocks.
+** Input:
+**		ptSrc: Source surface
+**		nTransform: TRANSFORM_*
+**		ptDest: Surface to create, release with DestroySurface()
+** Output: Transformed surface, same format as the source
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TransformSurface(
+	IN CONST SURFACE                             *ptSrc,
+	IN       UINTN                               nTransform,
+	OUT      SURFACE                             *ptDest
+)
+{
+	BOOLEAN    bSwapSize;
+	ASSERT_ENSURE(ptSrc != NULL && ptSrc->ptPixels != NULL && ptDest != NULL && nTransform <= TRANSFORM_FLIP_V);
+	bSwapSize = (BOOLEAN)(nTransform == TRANSFORM_ROTATE_90 || nTransform == TRANSFORM_ROTATE_270);
+	ASSERT_CHECK_EFISTATUS(CreateSurface(ptDest, bSwapSize ? ptSrc->nHeight : ptSrc->nWidth,
+		bSwapSize ? ptSrc->nWidth : ptSrc->nHeight, ptSrc->nFormat));
+	switch (nTransform) {
+	case TRANSFORM_ROTATE_90:
+		RotateTiles(ptSrc, ptDest, TRUE);
+		break;
+	case TRANSFORM_ROTATE_270:
+		RotateTiles(ptSrc, ptDest, FALSE);
+		break;
+	case TRANSFORM_ROTATE_180:
+		MirrorRows(ptSrc, ptDest, TRUE, TRUE);
+		break;
+	case TRANSFORM_FLIP_H:
+		MirrorRows(ptSrc, ptDest, TRUE, FALSE);
+		break;
+	case TRANSFORM_FLIP_V:
+		MirrorRows(ptSrc, ptDest, FALSE, TRUE);
+		break;
+	default:
+		MirrorRows(ptSrc, ptDest, FALSE, FALSE);
+		break;
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetImageTransform()
+** Description: Sets the transform applied to decoded images before they are
+** output (for panels mounted rotated against the mode GOP reports)
+** Input:
+**		nTransform: TRANSFORM_*
+** Output: Image transform
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetImageTransform(
+	IN       UINTN                               nTransform
+)
+{
+	ASSERT_ENSURE(nTransform <= TRANSFORM_FLIP_V);
+	gnImageTransform = nTransform;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: ApplyImageTransform()
+** Description: Applies the transform set with SetImageTransform() to a
+** decoded image, replacing its pixels. Does nothing for TRANSFORM_NONE.
+** Input:
+**		ptImage: Decoded image
+** Output: Transformed image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+ApplyImageTransform(
+	IN OUT   SURFACE                             *ptImage
+)
+{
+	SURFACE    tResult;
+	ASSERT_ENSURE(ptImage != NULL && ptImage->ptPixels != NULL);
+	if (gnImageTransform == TRANSFORM_NONE)
+		return EFI_SUCCESS;
+	ASSERT_CHECK_EFISTATUS(TransformSurface(ptImage, gnImageTransform, &tResult));
+	DestroySurface(ptImage);
+	CopyMem(ptImage, &tResult, sizeof(SURFACE));
+	return EFI_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/*
+** ===========================================================================
+** File: GOP_Transform.h
+** Description: UEFI graphics-related code module (rotate/flip transforms)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_TRANSFORM_H_
+#define _GRAPHICS_GOP_TRANSFORM_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+enum
+{
+	TRANSFORM_NONE,
+	TRANSFORM_ROTATE_90,	/* Clockwise */
+	TRANSFORM_ROTATE_180,
+	TRANSFORM_ROTATE_270,	/* Clockwise, i.e. 90 counter-clockwise */
+	TRANSFORM_FLIP_H,		/* Mirrored left to right */
+	TRANSFORM_FLIP_V		/* Mirrored top to bottom */
+};
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: TransformSurface()
+** Description: Rotates or mirrors a surface into a new one. Rotations by 90
+** and 270 degrees are done in cache-sized blocks.
+** Input:
+**		ptSrc: Source surface
+**		nTransform: TRANSFORM_*
+**		ptDest: Surface to create, release with DestroySurface()
+** Output: Transformed surface, same format as the source
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TransformSurface(
+	IN CONST SURFACE                             *ptSrc,
+	IN       UINTN                               nTransform,
+	OUT      SURFACE                             *ptDest
+);
+
+/*
+** ===========================================================================
+** Function: SetImageTransform()
+** Description: Sets the transform applied to decoded images before they are
+** output (for panels mounted rotated against the mode GOP reports)
+** Input:
+**		nTransform: TRANSFORM_*
+** Output: Image transform
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetImageTransform(
+	IN       UINTN                               nTransform
+);
+
+/*
+** ===========================================================================
+** Function: ApplyImageTransform()
+** Description: Applies the transform set with SetImageTransform() to a
+** decoded image, replacing its pixels. Does nothing for TRANSFORM_NONE.
+** Input:
+**		ptImage: Decoded image
+** Output: Transformed image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+ApplyImageTransform(
+	IN OUT   SURFACE                             *ptImage
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_TRANSFORM_H_ */
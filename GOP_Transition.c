@@ -0,0 +1,1127 @@
+/*
+** ===========================================================================
+** File: GOP_Transition.c
+** Description: UEFI graphics-related code module (image transitions)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Raster.h"
+#include "GOP_Transition.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define CLOCK_WIPE_STEPS		4096	/* Angle buckets of a full turn */
+#define BLINDS_DEFAULT			8
+#define CHECKERBOARD_DEFAULT	32		/* Cell size in pixels */
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+typedef struct {
+	INT32                                        nRow;
+	INT32                                        nLeft;
+	INT32                                        nRight;
+} CLOCK_SPAN;
+
+typedef struct {
+	UINTN                                        anStart[CLOCK_WIPE_STEPS + 1];	/* First span of every bucket */
+	CLOCK_SPAN                                   *ptSpans;	/* Sorted by bucket */
+} CLOCK_WIPE;
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/* atan(n / 64) for n = 0..64, 8192 = 45 degrees */
+static CONST UINT16 ganClockAtan[65] = {
+	0, 163, 326, 489, 651, 813, 975, 1136, 1297, 1457, 1617, 1775, 1933, 2090, 2246, 2401,
+	2555, 2708, 2860, 3010, 3159, 3307, 3453, 3599, 3742, 3884, 4025, 4164, 4302, 4438, 4572, 4705,
+	4836, 4966, 5094, 5220, 5344, 5467, 5589, 5708, 5826, 5943, 6058, 6171, 6282, 6392, 6500, 6607,
+	6712, 6815, 6917, 7018, 7117, 7214, 7310, 7405, 7498, 7589, 7679, 7768, 7856, 7942, 8026, 8110,
+	8192
+};
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: EaseProgress()
+** Description: Applies an easing curve to a linear progress
+** Input:
+**		nProgress: Linear progress, 0..TRANSITION_ONE
+**		nEasing: TRANSITION_EASE_*
+** Output: None
+** Return value: Eased progress, 0..TRANSITION_ONE
+** ===========================================================================
+*/
+static
+UINT32
+EaseProgress(
+	IN UINT32 nProgress,
+	IN UINTN nEasing
+)
+{
+	UINT64     nSquare = MultU64x32(nProgress, nProgress);
+	switch (nEasing) {
+	case TRANSITION_EASE_IN:
+		return (UINT32)RShiftU64(nSquare, 16);
+	case TRANSITION_EASE_OUT:
+		return TRANSITION_ONE - (UINT32)RShiftU64(MultU64x32(TRANSITION_ONE - nProgress, TRANSITION_ONE - nProgress), 16);
+	case TRANSITION_EASE_IN_OUT:
+		/* p * p * (3 - 2 * p) */
+		return (UINT32)RShiftU64(MultU64x32(nSquare, 3 * TRANSITION_ONE - 2 * nProgress), 32);
+	default:
+		return nProgress;
+	}
+}
+
+/*
+** ===========================================================================
+** Function: SquareRoot()
+** Description: Computes an integer square root, digit by digit
+** Input:
+**		nValue: Radicand
+** Output: None
+** Return value: floor(sqrt(nValue))
+** ===========================================================================
+*/
+static
+UINT64
+SquareRoot(
+	IN UINT64 nValue
+)
+{
+	UINT64     nRoot = 0;
+	UINT64     nBit = LShiftU64(1, 62);
+	while (nBit > nValue)
+		nBit = RShiftU64(nBit, 2);
+	while (nBit != 0)
+	{
+		if (nValue >= nRoot + nBit)
+		{
+			nValue -= nRoot + nBit;
+			nRoot = RShiftU64(nRoot, 1) + nBit;
+		}
+		else
+			nRoot = RShiftU64(nRoot, 1);
+		nBit = RShiftU64(nBit, 2);
+	}
+	return nRoot;
+}
+
+/*
+** ===========================================================================
+** Function: GetClockAngle()
+** Description: Computes the clock angle of a point around a center without
+** floating point: the octant is found from the signs and magnitudes, the
+** angle inside it from a table of arctangents
+** Input:
+**		nDx, nDy: Point relative to the center, Y pointing down
+** Output: None
+** Return value: Angle clockwise from 12 o'clock, 0..65535 for a full turn
+** ===========================================================================
+*/
+static
+UINT32
+GetClockAngle(
+	IN INTN nDx,
+	IN INTN nDy
+)
+{
+	UINT64 nAbsX;
+	UINT64 nAbsY;
+	UINT32 nRatio;
+	UINT32 nAngle;
+	nAbsX = (UINT64)((nDx < 0) ? -nDx : nDx);
+	nAbsY = (UINT64)((nDy < 0) ? -nDy : nDy);
+	if (nAbsX == 0 && nAbsY == 0)
+		return 0;
+	/* nRatio: tangent inside the octant, 10.6 fixed point over the table */
+	if (nAbsX <= nAbsY)
+		nRatio = (UINT32)DivU64x64Remainder(LShiftU64(nAbsX, 12), nAbsY, NULL);
+	else
+		nRatio = (UINT32)DivU64x64Remainder(LShiftU64(nAbsY, 12), nAbsX, NULL);
+	nAngle = ganClockAtan[nRatio >> 6];
+	if ((nRatio & 63) != 0)
+		nAngle += ((ganClockAtan[(nRatio >> 6) + 1] - nAngle) * (nRatio & 63) + 32) >> 6;
+	/* Angle away from the vertical axis, 0..16384 */
+	if (nAbsX > nAbsY)
+		nAngle = 16384 - nAngle;
+	if (nDx >= 0)
+		nAngle = (nDy < 0) ? nAngle : 32768 - nAngle;
+	else
+		nAngle = (nDy < 0) ? 65536 - nAngle : 32768 + nAngle;
+	return MIN(nAngle, 65535);
+}
+
+/*
+** ===========================================================================
+** Function: ScaleProgress()
+** Description: Maps a progress onto a length
+** Input:
+**		nProgress: Progress, 0..TRANSITION_ONE
+**		nLength: Length at TRANSITION_ONE
+** Output: None
+** Return value: Length reached, 0..nLength
+** ===========================================================================
+*/
+static
+UINTN
+ScaleProgress(
+	IN UINT32 nProgress,
+	IN UINTN nLength
+)
+{
+	return (UINTN)RShiftU64(MultU64x32(nLength, nProgress), 16);
+}
+
+/*
+** ===========================================================================
+** Function: FadeFrame()
+** Description: Dissolve frame: blends the source image (black without one)
+** into the target in the scratch buffer
+** Input:
+**		ptTransition: Transition
+**		nFrom, nTo: Progress range
+** Output: Scratch buffer marked for output
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+FadeFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nFrom,
+	IN UINT32 nTo
+)
+{
+	UINTN      nPixels = ptTransition->nWidth * ptTransition->nHeight;
+	UINT32     nWeight;
+	if ((ptTransition->nFlags & TRANSITION_REVERSE) != 0)
+		nTo = TRANSITION_ONE - nTo;
+	/* The original implementation had a big oopsie. Which?
+	It checks if one value the out buffer has less color value than input's.
+	A proper fade does a percentage-like operation for every color value. 
+	Same goes with fade out, but in reverse order. */
+	if (ptTransition->ptFrom == NULL)
+	{
+		nWeight = (UINT32)ScaleProgress(nTo, 255);
+		ScalePixelRow(ptTransition->pnScratch, (CONST UINT32 *)ptTransition->ptTo, nWeight, nPixels);
+	}
+	else
+	{
+		nWeight = (UINT32)ScaleProgress(nTo, 256);
+		LerpPixelRow(ptTransition->pnScratch, (CONST UINT32 *)ptTransition->ptFrom, (CONST UINT32 *)ptTransition->ptTo, nWeight, nPixels);
+	}
+	return TransitionMarkDirty(ptTransition, 0, 0, ptTransition->nWidth - 1, ptTransition->nHeight - 1);
+}
+
+/*
+** ===========================================================================
+** Function: ClockWipeSetup()
+** Description: Computes the clock angle bucket of every pixel once and
+** groups the pixels into horizontal spans sorted by bucket (counting sort)
+** Input:
+**		ptTransition: Transition
+** Output: CLOCK_WIPE data
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+ClockWipeSetup(
+	IN OUT TRANSITION *ptTransition
+)
+{
+	CLOCK_WIPE *ptWipe;
+	UINT16     *pnBuckets;
+	UINT16     *pnRow;
+	CLOCK_SPAN *ptSpan;
+	UINTN      nWidth = ptTransition->nWidth;
+	UINTN      nHeight = ptTransition->nHeight;
+	UINTN      nX;
+	UINTN      nY;
+	UINTN      nRunStart;
+	UINTN      nBucket;
+	UINT32     nAngle;
+	ASSERT_CHECK((ptWipe = AllocateZeroPool(sizeof(CLOCK_WIPE))) != NULL);
+	if ((pnBuckets = AllocatePool(nWidth * nHeight * sizeof(UINT16))) == NULL)
+	{
+		FreePool(ptWipe);
+		return EFI_LOAD_ERROR;
+	}
+	/* Bucket of every pixel, counting the runs each bucket gets. Doubled
+	coordinates put the center between pixels for even sizes. */
+	for (nY = 0; nY < nHeight; nY++)
+	{
+		pnRow = pnBuckets + nY * nWidth;
+		for (nX = 0; nX < nWidth; nX++)
+		{
+			nAngle = GetClockAngle((INTN)(2 * nX) - (INTN)(nWidth - 1), (INTN)(2 * nY) - (INTN)(nHeight - 1));
+			if ((ptTransition->nFlags & TRANSITION_REVERSE) != 0 && nAngle != 0)
+				nAngle = 65536 - nAngle;
+			pnRow[nX] = (UINT16)((nAngle * CLOCK_WIPE_STEPS) >> 16);
+			if (nX == 0 || pnRow[nX] != pnRow[nX - 1])
+				ptWipe->anStart[pnRow[nX] + 1]++;
+		}
+	}
+	for (nBucket = 1; nBucket <= CLOCK_WIPE_STEPS; nBucket++)
+		ptWipe->anStart[nBucket] += ptWipe->anStart[nBucket - 1];
+	if ((ptWipe->ptSpans = AllocatePool(ptWipe->anStart[CLOCK_WIPE_STEPS] * sizeof(CLOCK_SPAN))) == NULL)
+	{
+		FreePool(pnBuckets);
+		FreePool(ptWipe);
+		return EFI_LOAD_ERROR;
+	}
+	/* Placing a run advances its bucket's start to the next bucket's */
+	for (nY = 0; nY < nHeight; nY++)
+	{
+		pnRow = pnBuckets + nY * nWidth;
+		for (nRunStart = 0, nX = 1; nX <= nWidth; nX++)
+		{
+			if (nX < nWidth && pnRow[nX] == pnRow[nRunStart])
+				continue;
+			ptSpan = &ptWipe->ptSpans[ptWipe->anStart[pnRow[nRunStart]]++];
+			ptSpan->nRow = (INT32)nY;
+			ptSpan->nLeft = (INT32)nRunStart;
+			ptSpan->nRight = (INT32)nX - 1;
+			nRunStart = nX;
+		}
+	}
+	for (nBucket = CLOCK_WIPE_STEPS; nBucket > 0; nBucket--)
+		ptWipe->anStart[nBucket] = ptWipe->anStart[nBucket - 1];
+	ptWipe->anStart[0] = 0;
+	FreePool(pnBuckets);
+	ptTransition->pvData = ptWipe;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: ClockWipeFrame()
+** Description: Clock wipe frame: reveals the spans of the angle buckets
+** reached since the last frame, every pixel is output once
+** Input:
+**		ptTransition: Transition
+**		nFrom, nTo: Progress range
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+ClockWipeFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nFrom,
+	IN UINT32 nTo
+)
+{
+	CLOCK_WIPE *ptWipe = ptTransition->pvData;
+	CLOCK_SPAN *ptSpan;
+	UINTN      nIndex;
+	UINTN      nEnd;
+	nEnd = ptWipe->anStart[ScaleProgress(nTo, CLOCK_WIPE_STEPS)];
+	for (nIndex = ptWipe->anStart[ScaleProgress(nFrom, CLOCK_WIPE_STEPS)]; nIndex < nEnd; nIndex++)
+	{
+		ptSpan = &ptWipe->ptSpans[nIndex];
+		ASSERT_CHECK_EFISTATUS(TransitionReveal(ptTransition, ptSpan->nLeft, ptSpan->nRow, ptSpan->nRight, ptSpan->nRow));
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: ClockWipeCleanup()
+** Description: Frees the clock wipe span lists
+** Input:
+**		ptTransition: Transition
+** Output: None
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+EFIAPI
+ClockWipeCleanup(
+	IN OUT TRANSITION *ptTransition
+)
+{
+	CLOCK_WIPE *ptWipe = ptTransition->pvData;
+	if (ptWipe == NULL)
+		return;
+	FreePool(ptWipe->ptSpans);
+	FreePool(ptWipe);
+	ptTransition->pvData = NULL;
+}
+
+/*
+** ===========================================================================
+** Function: RainFallFrame()
+** Description: Rain fall frame: outputs the image rows reached since the
+** last frame, then stretches the last one over the rows still to fall by
+** doubling on-screen copies (log2(rows) BLTs)
+** Input:
+**		ptTransition: Transition
+**		nFrom, nTo: Progress range
+** Output: Rows output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+RainFallFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nFrom,
+	IN UINT32 nTo
+)
+{
+	RECT       *ptRect = &ptTransition->tRect;
+	RECT       tDest;
+	RECT       tSrc;
+	UINTN      nHeight = ptTransition->nHeight;
+	UINTN      nOld = ScaleProgress(nFrom, nHeight);
+	UINTN      nNew = ScaleProgress(nTo, nHeight);
+	UINTN      nTop;
+	UINTN      nLast;
+	UINTN      nFilled;
+	UINTN      nCopy;
+	BOOLEAN    bUp = (BOOLEAN)((ptTransition->nFlags & TRANSITION_REVERSE) != 0);
+	if (nNew == nOld)
+		return EFI_SUCCESS;
+	/* Rows [nTop, nTop + nNew - nOld) are final, nLast is the one stretched */
+	nTop = (bUp == FALSE) ? nOld : nHeight - nNew;
+	nLast = (bUp == FALSE) ? nNew - 1 : nTop;
+	SetRect(&tSrc, 0, nTop, ptTransition->nWidth - 1, nTop + nNew - nOld - 1);
+	SetRect(&tDest, ptRect->nLeft, ptRect->nTop + nTop, ptRect->nRight, ptRect->nTop + tSrc.nBottom);
+	ASSERT_CHECK_EFISTATUS(DrawBltEx(ptTransition->ptGraphicsOutput, ptTransition->ptTo, EfiBltBufferToVideo, &tDest, &tSrc, ptTransition->nWidth));
+	for (nFilled = 1; nFilled < nHeight - nNew + 1; nFilled += nCopy)
+	{
+		nCopy = MIN(nFilled, nHeight - nNew + 1 - nFilled);
+		if (bUp == FALSE)
+		{
+			SetRect(&tSrc, ptRect->nLeft, ptRect->nTop + nLast, ptRect->nRight, ptRect->nTop + nLast + nCopy - 1);
+			ASSERT_CHECK_EFISTATUS(CopyScreenRect(ptTransition->ptGraphicsOutput, &tSrc, ptRect->nLeft, ptRect->nTop + nLast + nFilled));
+		}
+		else
+		{
+			SetRect(&tSrc, ptRect->nLeft, ptRect->nTop + nLast + 1 - nCopy, ptRect->nRight, ptRect->nTop + nLast);
+			ASSERT_CHECK_EFISTATUS(CopyScreenRect(ptTransition->ptGraphicsOutput, &tSrc, ptRect->nLeft, ptRect->nTop + nLast + 1 - nFilled - nCopy));
+		}
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: BlindsFrame()
+** Description: Blinds frame: every band reveals the lines reached since the
+** last frame
+** Input:
+**		ptTransition: Transition
+**		nFrom, nTo: Progress range
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+BlindsFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nFrom,
+	IN UINT32 nTo
+)
+{
+	BOOLEAN    bVertical = (BOOLEAN)((ptTransition->nFlags & TRANSITION_VERTICAL) != 0);
+	UINTN      nLength = (bVertical == TRUE) ? ptTransition->nWidth : ptTransition->nHeight;
+	UINTN      nBlinds = (ptTransition->nParam != 0) ? ptTransition->nParam : BLINDS_DEFAULT;
+	UINTN      nBand = (nLength + MIN(nBlinds, nLength) - 1) / MIN(nBlinds, nLength);
+	UINTN      nOld = ScaleProgress(nFrom, nBand);
+	UINTN      nNew = ScaleProgress(nTo, nBand);
+	UINTN      nStart;
+	INT32      nFirst;
+	INT32      nLast;
+	if (nNew == nOld)
+		return EFI_SUCCESS;
+	for (nStart = 0; nStart < nLength; nStart += nBand)
+	{
+		/* Lines [nOld, nNew) of the band, counted from its far end in reverse */
+		if ((ptTransition->nFlags & TRANSITION_REVERSE) == 0)
+		{
+			nFirst = (INT32)(nStart + nOld);
+			nLast = (INT32)(nStart + nNew - 1);
+		}
+		else
+		{
+			nFirst = (INT32)(nStart + nBand - nNew);
+			nLast = (INT32)(nStart + nBand - nOld - 1);
+		}
+		if (bVertical == TRUE)
+		{
+			ASSERT_CHECK_EFISTATUS(TransitionReveal(ptTransition, nFirst, 0, nLast, (INT32)ptTransition->nHeight - 1));
+		}
+		else
+		{
+			ASSERT_CHECK_EFISTATUS(TransitionReveal(ptTransition, 0, nFirst, (INT32)ptTransition->nWidth - 1, nLast));
+		}
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: IrisFrame()
+** Description: Iris frame: reveals the ring between the previous and the
+** new circle around the center, at most two spans per row
+** Input:
+**		ptTransition: Transition
+**		nFrom, nTo: Progress range
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+IrisFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nFrom,
+	IN UINT32 nTo
+)
+{
+	UINTN      nWidth = ptTransition->nWidth;
+	UINTN      nHeight = ptTransition->nHeight;
+	UINT64     nMax;
+	UINT64     nOld;
+	UINT64     nNew;
+	UINT64     nDy;
+	UINTN      nY;
+	UINTN      nHalf;
+	INT32      nNewLeft;
+	INT32      nNewRight;
+	INT32      nOldLeft;
+	INT32      nOldRight;
+	/* Doubled coordinates around the center, the full radius reaches the
+	corners */
+	nMax = SquareRoot(MultU64x64(nWidth - 1, nWidth - 1) + MultU64x64(nHeight - 1, nHeight - 1)) + 1;
+	nOld = MultU64x64(ScaleProgress(nFrom, (UINTN)nMax), ScaleProgress(nFrom, (UINTN)nMax));
+	nNew = MultU64x64(ScaleProgress(nTo, (UINTN)nMax), ScaleProgress(nTo, (UINTN)nMax));
+	for (nY = 0; nY < nHeight; nY++)
+	{
+		nDy = (2 * nY >= nHeight - 1) ? 2 * nY - (nHeight - 1) : (nHeight - 1) - 2 * nY;
+		nDy = MultU64x64(nDy, nDy);
+		if (nDy > nNew)
+			continue;
+		nHalf = (UINTN)MIN(SquareRoot(nNew - nDy), nWidth - 1);
+		nNewLeft = (INT32)((nWidth - nHalf) / 2);
+		nNewRight = (INT32)((nWidth - 1 + nHalf) / 2);
+		if (nFrom == 0 || nDy > nOld)
+		{
+			ASSERT_CHECK_EFISTATUS(TransitionReveal(ptTransition, nNewLeft, (INT32)nY, nNewRight, (INT32)nY));
+			continue;
+		}
+		nHalf = (UINTN)MIN(SquareRoot(nOld - nDy), nWidth - 1);
+		nOldLeft = (INT32)((nWidth - nHalf) / 2);
+		nOldRight = (INT32)((nWidth - 1 + nHalf) / 2);
+		if (nNewLeft < nOldLeft)
+			ASSERT_CHECK_EFISTATUS(TransitionReveal(ptTransition, nNewLeft, (INT32)nY, nOldLeft - 1, (INT32)nY));
+		if (nNewRight > nOldRight)
+			ASSERT_CHECK_EFISTATUS(TransitionReveal(ptTransition, nOldRight + 1, (INT32)nY, nNewRight, (INT32)nY));
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: CheckerboardFrame()
+** Description: Checkerboard frame: cells reveal from left to right, every
+** other cell half a run later
+** Input:
+**		ptTransition: Transition
+**		nFrom, nTo: Progress range
+** Output: Queued spans
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+CheckerboardFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nFrom,
+	IN UINT32 nTo
+)
+{
+	UINTN      nCell = (ptTransition->nParam != 0) ? ptTransition->nParam : CHECKERBOARD_DEFAULT;
+	UINTN      nOld = ScaleProgress(nFrom, 2 * nCell);
+	UINTN      nNew = ScaleProgress(nTo, 2 * nCell);
+	UINTN      nX;
+	UINTN      nY;
+	UINTN      nDelay;
+	UINTN      nFirst;
+	UINTN      nLast;
+	for (nY = 0; nY < ptTransition->nHeight; nY += nCell)
+	{
+		for (nX = 0; nX < ptTransition->nWidth; nX += nCell)
+		{
+			/* Columns of the cell reached: progress minus its delay, 0..nCell */
+			nDelay = (((nX / nCell) + (nY / nCell)) & 1) ? nCell : 0;
+			nFirst = MIN(MAX(nOld, nDelay) - nDelay, nCell);
+			nLast = MIN(MAX(nNew, nDelay) - nDelay, nCell);
+			if (nLast > nFirst)
+				ASSERT_CHECK_EFISTATUS(TransitionReveal(ptTransition, (INT32)(nX + nFirst), (INT32)nY, (INT32)(nX + nLast - 1), (INT32)(nY + nCell - 1)));
+		}
+	}
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: PushFrame()
+** Description: Push frame: the target image slides in and pushes the source
+** image out, two BLTs
+** Input:
+**		ptTransition: Transition
+**		nFrom, nTo: Progress range
+** Output: Both images output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+EFIAPI
+PushFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nFrom,
+	IN UINT32 nTo
+)
+{
+	RECT       *ptRect = &ptTransition->tRect;
+	RECT       tFromSrc;
+	RECT       tFromDest;
+	RECT       tToSrc;
+	RECT       tToDest;
+	UINTN      nRight = ptTransition->nWidth - 1;
+	UINTN      nBottom = ptTransition->nHeight - 1;
+	UINTN      nShift;
+	if ((ptTransition->nFlags & TRANSITION_VERTICAL) == 0)
+	{
+		nShift = ScaleProgress(nTo, ptTransition->nWidth);
+		if (nShift == 0 || nShift > nRight)
+			return DrawBltEx(ptTransition->ptGraphicsOutput, (nShift == 0) ? ptTransition->ptFrom : ptTransition->ptTo, EfiBltBufferToVideo, ptRect, NULL, 0);
+		if ((ptTransition->nFlags & TRANSITION_REVERSE) == 0)
+		{
+			SetRect(&tFromSrc, nShift, 0, nRight, nBottom);
+			SetRect(&tToSrc, 0, 0, nShift - 1, nBottom);
+			SetRect(&tFromDest, ptRect->nLeft, ptRect->nTop, ptRect->nRight - nShift, ptRect->nBottom);
+			SetRect(&tToDest, ptRect->nRight + 1 - nShift, ptRect->nTop, ptRect->nRight, ptRect->nBottom);
+		}
+		else
+		{
+			SetRect(&tFromSrc, 0, 0, nRight - nShift, nBottom);
+			SetRect(&tToSrc, nRight + 1 - nShift, 0, nRight, nBottom);
+			SetRect(&tFromDest, ptRect->nLeft + nShift, ptRect->nTop, ptRect->nRight, ptRect->nBottom);
+			SetRect(&tToDest, ptRect->nLeft, ptRect->nTop, ptRect->nLeft + nShift - 1, ptRect->nBottom);
+		}
+	}
+	else
+	{
+		nShift = ScaleProgress(nTo, ptTransition->nHeight);
+		if (nShift == 0 || nShift > nBottom)
+			return DrawBltEx(ptTransition->ptGraphicsOutput, (nShift == 0) ? ptTransition->ptFrom : ptTransition->ptTo, EfiBltBufferToVideo, ptRect, NULL, 0);
+		if ((ptTransition->nFlags & TRANSITION_REVERSE) == 0)
+		{
+			SetRect(&tFromSrc, 0, nShift, nRight, nBottom);
+			SetRect(&tToSrc, 0, 0, nRight, nShift - 1);
+			SetRect(&tFromDest, ptRect->nLeft, ptRect->nTop, ptRect->nRight, ptRect->nBottom - nShift);
+			SetRect(&tToDest, ptRect->nLeft, ptRect->nBottom + 1 - nShift, ptRect->nRight, ptRect->nBottom);
+		}
+		else
+		{
+			SetRect(&tFromSrc, 0, 0, nRight, nBottom - nShift);
+			SetRect(&tToSrc, 0, nBottom + 1 - nShift, nRight, nBottom);
+			SetRect(&tFromDest, ptRect->nLeft, ptRect->nTop + nShift, ptRect->nRight, ptRect->nBottom);
+			SetRect(&tToDest, ptRect->nLeft, ptRect->nTop, ptRect->nRight, ptRect->nTop + nShift - 1);
+		}
+	}
+	ASSERT_CHECK_EFISTATUS(DrawBltEx(ptTransition->ptGraphicsOutput, ptTransition->ptFrom, EfiBltBufferToVideo, &tFromDest, &tFromSrc, ptTransition->nWidth));
+	return DrawBltEx(ptTransition->ptGraphicsOutput, ptTransition->ptTo, EfiBltBufferToVideo, &tToDest, &tToSrc, ptTransition->nWidth);
+}
+
+/* Built-in transition types */
+CONST TRANSITION_TYPE gtTransitionFade = { NULL, FadeFrame, NULL, TRUE, FALSE };
+CONST TRANSITION_TYPE gtTransitionClockWipe = { ClockWipeSetup, ClockWipeFrame, ClockWipeCleanup, FALSE, FALSE };
+CONST TRANSITION_TYPE gtTransitionRainFall = { NULL, RainFallFrame, NULL, FALSE, FALSE };
+CONST TRANSITION_TYPE gtTransitionBlinds = { NULL, BlindsFrame, NULL, FALSE, FALSE };
+CONST TRANSITION_TYPE gtTransitionIris = { NULL, IrisFrame, NULL, FALSE, FALSE };
+CONST TRANSITION_TYPE gtTransitionCheckerboard = { NULL, CheckerboardFrame, NULL, FALSE, FALSE };
+CONST TRANSITION_TYPE gtTransitionPush = { NULL, PushFrame, NULL, FALSE, TRUE };
+
+/*
+** ===========================================================================
+** Function: EndTransition()
+** Description: Frees what a started transition allocated
+** Input:
+**		ptTransition: Transition
+** Output: None
+** Return value: None
+** ===========================================================================
+*/
+static
+VOID
+EndTransition(
+	IN OUT TRANSITION *ptTransition
+)
+{
+	if (ptTransition->ptType->pfnCleanup != NULL)
+		ptTransition->ptType->pfnCleanup(ptTransition);
+	if (ptTransition->pnScratch != NULL)
+		FreePool(ptTransition->pnScratch);
+	if (ptTransition->bOwnsFrom == TRUE)
+	{
+		FreePool(ptTransition->ptFrom);
+		ptTransition->ptFrom = NULL;
+		ptTransition->bOwnsFrom = FALSE;
+	}
+	ptTransition->pnScratch = NULL;
+	StopFrameClock(&ptTransition->tClock);
+	ptTransition->bRunning = FALSE;
+}
+
+/*
+** ===========================================================================
+** Function: OutputTransitionFrame()
+** Description: Advances a started transition to a progress and outputs the
+** change: the dirty scratch area in one BLT, then the queued spans
+** Input:
+**		ptTransition: Transition
+**		nProgress: Eased progress, 0..TRANSITION_ONE
+** Output: Frame on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+OutputTransitionFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN UINT32 nProgress
+)
+{
+	RECT       tDest;
+	EFI_STATUS nStatus;
+	if (nProgress <= ptTransition->nProgress)
+		return EFI_SUCCESS;
+	nStatus = ptTransition->ptType->pfnFrame(ptTransition, ptTransition->nProgress, nProgress);
+	ptTransition->nProgress = nProgress;
+	if (nStatus == EFI_SUCCESS && ptTransition->bDirty == TRUE)
+	{
+		CopyRect(&tDest, &ptTransition->tDirty);
+		OffsetRect(&tDest, ptTransition->tRect.nLeft, ptTransition->tRect.nTop);
+		nStatus = DrawBltEx(ptTransition->ptGraphicsOutput, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)ptTransition->pnScratch, EfiBltBufferToVideo, &tDest, &ptTransition->tDirty, ptTransition->nWidth);
+	}
+	ptTransition->bDirty = FALSE;
+	if (nStatus == EFI_SUCCESS)
+		nStatus = FlushRaster(&ptTransition->tRaster);
+	FlushShadow(ptTransition->ptGraphicsOutput);
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: DrawTransitionFrame()
+** Description: Draws the next frame of a started transition at the progress
+** of the clock (the next step when it has no duration)
+** Input:
+**		ptTransition: Transition
+**		bWait: TRUE = wait until the frame is due, FALSE = return at once
+**		when it is not
+** Output: Frame on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+DrawTransitionFrame(
+	IN OUT TRANSITION *ptTransition,
+	IN BOOLEAN bWait
+)
+{
+	UINT64     nElapsed;
+	UINT32     nLinear = 0;
+	EFI_STATUS nStatus;
+	if (ptTransition->nDurationMs == 0)
+		ptTransition->nFrame++;
+	else
+	{
+		if (bWait == TRUE)
+			nElapsed = WaitFrameClock(&ptTransition->tClock);
+		else if (PollFrameClock(&ptTransition->tClock, &nElapsed) == FALSE)
+			return EFI_SUCCESS;
+		nLinear = (UINT32)DivU64x64Remainder(MultU64x32(nElapsed, TRANSITION_ONE), ptTransition->tClock.nDurationUs, NULL);
+		if (ptTransition->nFrames != 0)
+			ptTransition->nFrame = (UINTN)DivU64x64Remainder(MultU64x64(nElapsed, ptTransition->nFrames), ptTransition->tClock.nDurationUs, NULL);
+	}
+	if (ptTransition->nFrames != 0)
+	{
+		/* Rounded up, so step n of a type scaled to nFrames steps is reached */
+		nLinear = (UINT32)DivU64x64Remainder(MultU64x32(ptTransition->nFrame, TRANSITION_ONE) + ptTransition->nFrames - 1, ptTransition->nFrames, NULL);
+	}
+	nStatus = OutputTransitionFrame(ptTransition, EaseProgress(nLinear, ptTransition->nEasing));
+	/* Measured here, so time the caller spends between steps is not draw time */
+	if (ptTransition->nDurationMs != 0)
+		MarkFrameClockDrawn(&ptTransition->tClock);
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: InitTransition()
+** Description: Prepares a transition between two images of the same size.
+** It lasts TRANSITION_DURATION_DEFAULT ms with linear progress until
+** changed by SetTransitionTiming().
+** Input:
+**		ptTransition: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptType: Transition type, gtTransition* or a custom one
+**		ptFrom: Image shown at the start, NULL = black or the screen
+**		(depending on the type)
+**		ptTo: Image shown at the end
+**		ptRect: Where the images are on screen
+** Output: Transition ready to run
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitTransition(
+	OUT      TRANSITION                          *ptTransition,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST TRANSITION_TYPE                     *ptType,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptFrom OPTIONAL,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptTo,
+	IN CONST RECT                                *ptRect
+)
+{
+	ASSERT_ENSURE(ptTransition != NULL && ptGraphicsOutput != NULL && ptType != NULL && ptType->pfnFrame != NULL && ptTo != NULL && ptRect != NULL);
+	ZeroMem(ptTransition, sizeof(TRANSITION));
+	ptTransition->ptGraphicsOutput = ptGraphicsOutput;
+	ptTransition->ptType = ptType;
+	ptTransition->ptFrom = ptFrom;
+	ptTransition->ptTo = ptTo;
+	CopyRect(&ptTransition->tRect, ptRect);
+	ptTransition->nWidth = WidthRect(ptRect);
+	ptTransition->nHeight = HeightRect(ptRect);
+	ptTransition->nDurationMs = TRANSITION_DURATION_DEFAULT;
+	ptTransition->nEasing = TRANSITION_EASE_LINEAR;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetTransitionTiming()
+** Description: Sets how a transition advances. Frames are due at
+** FRAME_RATE_DEFAULT and progress follows the clock, so the transition
+** lasts nDurationMs however slow the output is: frames that cannot be drawn
+** in time are skipped. nFrames quantizes progress into that many steps and
+** lowers the frame rate to match when they are slower.
+** Input:
+**		ptTransition: Transition
+**		nFrames: Number of steps, 0 = continuous
+**		nDurationMs: Duration in milliseconds, 0 = every step as fast as
+**		possible
+**		nEasing: TRANSITION_EASE_*
+** Output: Updated transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetTransitionTiming(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       UINTN                               nFrames,
+	IN       UINT32                              nDurationMs,
+	IN       UINTN                               nEasing
+)
+{
+	ASSERT_ENSURE(ptTransition != NULL && nEasing <= TRANSITION_EASE_IN_OUT);
+	ptTransition->nFrames = nFrames;
+	ptTransition->nDurationMs = nDurationMs;
+	ptTransition->nEasing = nEasing;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: SetTransitionOptions()
+** Description: Sets the type specific options of a transition
+** Input:
+**		ptTransition: Transition
+**		nFlags: TRANSITION_REVERSE, TRANSITION_VERTICAL
+**		nParam: Blind count, cell size... 0 = default
+** Output: Updated transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetTransitionOptions(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       UINT32                              nFlags,
+	IN       UINTN                               nParam
+)
+{
+	ASSERT_ENSURE(ptTransition != NULL);
+	ptTransition->nFlags = nFlags;
+	ptTransition->nParam = nParam;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: TransitionReveal()
+** Description: Frame helper: queues an area of the target image, output
+** when the frame ends. Stacked areas of equal columns are merged.
+** Input:
+**		ptTransition: Transition
+**		nLeft, nTop, nRight, nBottom: Inclusive area, image coordinates,
+**		clipped to the image
+** Output: Queued area
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TransitionReveal(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       INT32                               nLeft,
+	IN       INT32                               nTop,
+	IN       INT32                               nRight,
+	IN       INT32                               nBottom
+)
+{
+	ASSERT_ENSURE(ptTransition != NULL);
+	return RasterRect(&ptTransition->tRaster, nLeft, nTop, nRight, nBottom);
+}
+
+/*
+** ===========================================================================
+** Function: TransitionMarkDirty()
+** Description: Frame helper: marks an area of the scratch buffer as changed.
+** The bounding box of the marked areas is output in one BLT when the frame
+** ends.
+** Input:
+**		ptTransition: Transition of a type with a scratch buffer
+**		nLeft, nTop, nRight, nBottom: Inclusive area, image coordinates
+** Output: Marked area
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TransitionMarkDirty(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       UINTN                               nLeft,
+	IN       UINTN                               nTop,
+	IN       UINTN                               nRight,
+	IN       UINTN                               nBottom
+)
+{
+	RECT       tArea;
+	ASSERT_ENSURE(ptTransition != NULL && ptTransition->pnScratch != NULL);
+	ASSERT_CHECK(nLeft <= nRight && nTop <= nBottom && nRight < ptTransition->nWidth && nBottom < ptTransition->nHeight);
+	SetRect(&tArea, nLeft, nTop, nRight, nBottom);
+	if (ptTransition->bDirty == FALSE)
+		CopyRect(&ptTransition->tDirty, &tArea);
+	else
+		UnionRect(&ptTransition->tDirty, &ptTransition->tDirty, &tArea);
+	ptTransition->bDirty = TRUE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: StartTransition()
+** Description: Starts a transition without drawing anything: allocates
+** its buffers, runs the type setup and starts the frame clock. The caller
+** then advances it with StepTransition() from its own loop or a timer
+** callback, until it ends or is cancelled.
+** Input:
+**		ptTransition: Transition prepared by InitTransition()
+** Output: Running transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StartTransition(
+	IN OUT   TRANSITION                          *ptTransition
+)
+{
+	UINTN      nSize;
+	UINT32     nFrameRate;
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	ASSERT_ENSURE(ptTransition != NULL && ptTransition->ptType != NULL && ptTransition->bRunning == FALSE);
+	nSize = ptTransition->nWidth * ptTransition->nHeight * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+	if (ptTransition->nFrames == 0 && ptTransition->nDurationMs == 0)
+		ptTransition->nFrames = 1;
+	ptTransition->nFrame = 0;
+	ptTransition->nProgress = 0;
+	ptTransition->bDirty = FALSE;
+	if (ptTransition->ptType->bNeedsFrom == TRUE && ptTransition->ptFrom == NULL)
+	{
+		ASSERT_CHECK((ptTransition->ptFrom = AllocatePool(nSize)) != NULL);
+		ptTransition->bOwnsFrom = TRUE;
+		nStatus = DrawBltEx(ptTransition->ptGraphicsOutput, ptTransition->ptFrom, EfiBltVideoToBltBuffer, &ptTransition->tRect, NULL, 0);
+	}
+	if (nStatus == EFI_SUCCESS && ptTransition->ptType->bScratch == TRUE && (ptTransition->pnScratch = AllocatePool(nSize)) == NULL)
+		nStatus = EFI_LOAD_ERROR;
+	if (nStatus == EFI_SUCCESS)
+		nStatus = InitRaster(&ptTransition->tRaster, ptTransition->ptGraphicsOutput, ptTransition->ptTo);
+	if (nStatus == EFI_SUCCESS)
+		nStatus = SetRasterSource(&ptTransition->tRaster, ptTransition->ptTo, ptTransition->nWidth, &ptTransition->tRect);
+	if (nStatus == EFI_SUCCESS && ptTransition->ptType->pfnSetup != NULL)
+		nStatus = ptTransition->ptType->pfnSetup(ptTransition);
+	if (nStatus != EFI_SUCCESS)
+	{
+		/* Cleanup must cope with a setup that did not run or failed */
+		EndTransition(ptTransition);
+		return EFI_LOAD_ERROR;
+	}
+	/* Steps slower than the default frame rate set the rate themselves */
+	nFrameRate = FRAME_RATE_DEFAULT;
+	if (ptTransition->nFrames != 0 && ptTransition->nDurationMs != 0)
+		nFrameRate = (UINT32)MIN(DivU64x64Remainder(MultU64x32(ptTransition->nFrames, 1000) + ptTransition->nDurationMs - 1, ptTransition->nDurationMs, NULL), FRAME_RATE_DEFAULT);
+	if (ptTransition->nDurationMs != 0)
+		StartFrameClock(&ptTransition->tClock, nFrameRate, ptTransition->nDurationMs);
+	ptTransition->bRunning = TRUE;
+	return EFI_SUCCESS;
+}
+
+/*
+** ===========================================================================
+** Function: StepTransition()
+** Description: Draws the next frame of a running transition if it is due
+** and returns at once otherwise, so it can be called as often as the
+** caller likes. The transition ends, and frees its buffers, with its last
+** frame or on failure.
+** Input:
+**		ptTransition: Transition started by StartTransition()
+**		pbRunning: FALSE once the transition ended (OPTIONAL)
+** Output: Frame on the screen if one was due
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StepTransition(
+	IN OUT   TRANSITION                          *ptTransition,
+	OUT      BOOLEAN                             *pbRunning OPTIONAL
+)
+{
+	EFI_STATUS nStatus;
+	ASSERT_ENSURE(ptTransition != NULL && ptTransition->bRunning == TRUE);
+	nStatus = DrawTransitionFrame(ptTransition, FALSE);
+	if (nStatus != EFI_SUCCESS || ptTransition->nProgress >= TRANSITION_ONE)
+		EndTransition(ptTransition);
+	if (pbRunning != NULL)
+		*pbRunning = ptTransition->bRunning;
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: CancelTransition()
+** Description: Ends a running transition early and frees its buffers. The
+** screen keeps the last frame drawn, or shows the target image with
+** bFinish (e.g. when a key skips the animation). Transitions that are not
+** running are left alone.
+** Input:
+**		ptTransition: Transition
+**		bFinish: TRUE = draw the final frame before ending
+** Output: Ended transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CancelTransition(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       BOOLEAN                             bFinish
+)
+{
+	EFI_STATUS nStatus = EFI_SUCCESS;
+	ASSERT_ENSURE(ptTransition != NULL);
+	if (ptTransition->bRunning == FALSE)
+		return EFI_SUCCESS;
+	if (bFinish == TRUE)
+		nStatus = OutputTransitionFrame(ptTransition, TRANSITION_ONE);
+	EndTransition(ptTransition);
+	return nStatus;
+}
+
+/*
+** ===========================================================================
+** Function: RunTransition()
+** Description: Runs a transition to its end, blocking the caller. Frames
+** are scheduled by the engine, each one outputs only what its type changed.
+** See StartTransition() for running it from the caller's own loop.
+** Input:
+**		ptTransition: Transition
+** Output: Target image on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RunTransition(
+	IN OUT   TRANSITION                          *ptTransition
+)
+{
+	EFI_STATUS nStatus;
+	ASSERT_CHECK_EFISTATUS(StartTransition(ptTransition));
+	do
+	{
+		nStatus = DrawTransitionFrame(ptTransition, TRUE);
+	} while (nStatus == EFI_SUCCESS && ptTransition->nProgress < TRANSITION_ONE);
+	EndTransition(ptTransition);
+	return nStatus;
+}
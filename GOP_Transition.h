@@ -0,0 +1,335 @@
+/*
+** ===========================================================================
+** File: GOP_Transition.h
+** Description: UEFI graphics-related code module (image transitions)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_TRANSITION_H_
+#define _GRAPHICS_GOP_TRANSITION_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_H_
+#include "GOP.h"
+#endif
+#ifndef _GRAPHICS_GOP_RASTER_H_
+#include "GOP_Raster.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define TRANSITION_ONE				65536	/* Progress of a finished transition */
+#define TRANSITION_DURATION_DEFAULT	500		/* ms */
+
+/* Flags, meaning depends on the transition type */
+#define TRANSITION_REVERSE			0x0001	/* Fade out, counter-clockwise, bottom to top, push right */
+#define TRANSITION_VERTICAL			0x0002	/* Blinds and push along the other axis */
+
+enum
+{
+	TRANSITION_EASE_LINEAR,
+	TRANSITION_EASE_IN,			/* Starts slow */
+	TRANSITION_EASE_OUT,		/* Ends slow */
+	TRANSITION_EASE_IN_OUT		/* Smoothstep */
+};
+
+typedef struct _TRANSITION TRANSITION;
+
+/*
+** Transition type callbacks. Setup runs once before the first frame (e.g.
+** to precompute span lists into pvData), Frame draws the change from
+** progress nFrom to nTo (0..TRANSITION_ONE, eased) and Cleanup frees what
+** Setup allocated. Frame draws through TransitionReveal() (pixels of the
+** target image), TransitionMarkDirty() (the scratch buffer) or directly.
+*/
+typedef
+EFI_STATUS
+(EFIAPI *TRANSITION_SETUP)(
+	IN OUT   TRANSITION                          *ptTransition
+);
+
+typedef
+EFI_STATUS
+(EFIAPI *TRANSITION_FRAME)(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       UINT32                              nFrom,
+	IN       UINT32                              nTo
+);
+
+typedef
+VOID
+(EFIAPI *TRANSITION_CLEANUP)(
+	IN OUT   TRANSITION                          *ptTransition
+);
+
+typedef struct {
+	TRANSITION_SETUP                             pfnSetup;		/* OPTIONAL */
+	TRANSITION_FRAME                             pfnFrame;
+	TRANSITION_CLEANUP                           pfnCleanup;	/* OPTIONAL */
+	BOOLEAN                                      bScratch;		/* Engine allocates a rectangle-sized frame buffer */
+	BOOLEAN                                      bNeedsFrom;	/* Without a source image, the screen is read instead */
+} TRANSITION_TYPE;
+
+struct _TRANSITION {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;
+	CONST TRANSITION_TYPE                        *ptType;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                *ptFrom;		/* Image shown at the start, may be NULL */
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                *ptTo;			/* Image shown at the end */
+	RECT                                         tRect;			/* Where both images are on screen */
+	UINTN                                        nWidth;
+	UINTN                                        nHeight;
+	UINTN                                        nFrames;		/* Progress steps, 0 = continuous */
+	UINT32                                       nDurationMs;
+	UINTN                                        nEasing;		/* TRANSITION_EASE_* */
+	UINT32                                       nFlags;		/* TRANSITION_REVERSE... */
+	UINTN                                        nParam;		/* Blind count, cell size... 0 = default */
+	UINT32                                       *pnScratch;	/* bScratch types */
+	VOID                                         *pvData;		/* Owned by the type */
+	RASTER                                       tRaster;		/* Spans of the target image */
+	RECT                                         tDirty;		/* Scratch area to output this frame */
+	BOOLEAN                                      bDirty;
+	BOOLEAN                                      bOwnsFrom;		/* ptFrom was read from the screen */
+	BOOLEAN                                      bRunning;		/* Between StartTransition() and its end */
+	UINTN                                        nFrame;		/* Step drawn last */
+	UINT32                                       nProgress;		/* Eased progress drawn so far */
+	FRAME_CLOCK                                  tClock;
+};
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+extern CONST TRANSITION_TYPE gtTransitionFade;		/* Dissolve, from black without a source image */
+extern CONST TRANSITION_TYPE gtTransitionClockWipe;
+extern CONST TRANSITION_TYPE gtTransitionRainFall;
+extern CONST TRANSITION_TYPE gtTransitionBlinds;	/* nParam: number of blinds */
+extern CONST TRANSITION_TYPE gtTransitionIris;
+extern CONST TRANSITION_TYPE gtTransitionCheckerboard;	/* nParam: cell size */
+extern CONST TRANSITION_TYPE gtTransitionPush;
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: InitTransition()
+** Description: Prepares a transition between two images of the same size.
+** It lasts TRANSITION_DURATION_DEFAULT ms with linear progress until
+** changed by SetTransitionTiming().
+** Input:
+**		ptTransition: Transition to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptType: Transition type, gtTransition* or a custom one
+**		ptFrom: Image shown at the start, NULL = black or the screen
+**		(depending on the type)
+**		ptTo: Image shown at the end
+**		ptRect: Where the images are on screen
+** Output: Transition ready to run
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitTransition(
+	OUT      TRANSITION                          *ptTransition,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST TRANSITION_TYPE                     *ptType,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptFrom OPTIONAL,
+	IN       EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptTo,
+	IN CONST RECT                                *ptRect
+);
+
+/*
+** ===========================================================================
+** Function: SetTransitionTiming()
+** Description: Sets how a transition advances. Frames are due at
+** FRAME_RATE_DEFAULT and progress follows the clock, so the transition
+** lasts nDurationMs however slow the output is: frames that cannot be drawn
+** in time are skipped. nFrames quantizes progress into that many steps and
+** lowers the frame rate to match when they are slower.
+** Input:
+**		ptTransition: Transition
+**		nFrames: Number of steps, 0 = continuous
+**		nDurationMs: Duration in milliseconds, 0 = every step as fast as
+**		possible
+**		nEasing: TRANSITION_EASE_*
+** Output: Updated transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetTransitionTiming(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       UINTN                               nFrames,
+	IN       UINT32                              nDurationMs,
+	IN       UINTN                               nEasing
+);
+
+/*
+** ===========================================================================
+** Function: SetTransitionOptions()
+** Description: Sets the type specific options of a transition
+** Input:
+**		ptTransition: Transition
+**		nFlags: TRANSITION_REVERSE, TRANSITION_VERTICAL
+**		nParam: Blind count, cell size... 0 = default
+** Output: Updated transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetTransitionOptions(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       UINT32                              nFlags,
+	IN       UINTN                               nParam
+);
+
+/*
+** ===========================================================================
+** Function: TransitionReveal()
+** Description: Frame helper: queues an area of the target image, output
+** when the frame ends. Stacked areas of equal columns are merged.
+** Input:
+**		ptTransition: Transition
+**		nLeft, nTop, nRight, nBottom: Inclusive area, image coordinates,
+**		clipped to the image
+** Output: Queued area
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TransitionReveal(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       INT32                               nLeft,
+	IN       INT32                               nTop,
+	IN       INT32                               nRight,
+	IN       INT32                               nBottom
+);
+
+/*
+** ===========================================================================
+** Function: TransitionMarkDirty()
+** Description: Frame helper: marks an area of the scratch buffer as changed.
+** The bounding box of the marked areas is output in one BLT when the frame
+** ends.
+** Input:
+**		ptTransition: Transition of a type with a scratch buffer
+**		nLeft, nTop, nRight, nBottom: Inclusive area, image coordinates
+** Output: Marked area
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TransitionMarkDirty(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       UINTN                               nLeft,
+	IN       UINTN                               nTop,
+	IN       UINTN                               nRight,
+	IN       UINTN                               nBottom
+);
+
+/*
+** ===========================================================================
+** Function: StartTransition()
+** Description: Starts a transition without drawing anything: allocates
+** its buffers, runs the type setup and starts the frame clock. The caller
+** then advances it with StepTransition() from its own loop or a timer
+** callback, until it ends or is cancelled.
+** Input:
+**		ptTransition: Transition prepared by InitTransition()
+** Output: Running transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StartTransition(
+	IN OUT   TRANSITION                          *ptTransition
+);
+
+/*
+** ===========================================================================
+** Function: StepTransition()
+** Description: Draws the next frame of a running transition if it is due
+** and returns at once otherwise, so it can be called as often as the
+** caller likes. The transition ends, and frees its buffers, with its last
+** frame or on failure.
+** Input:
+**		ptTransition: Transition started by StartTransition()
+**		pbRunning: FALSE once the transition ended (OPTIONAL)
+** Output: Frame on the screen if one was due
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StepTransition(
+	IN OUT   TRANSITION                          *ptTransition,
+	OUT      BOOLEAN                             *pbRunning OPTIONAL
+);
+
+/*
+** ===========================================================================
+** Function: CancelTransition()
+** Description: Ends a running transition early and frees its buffers. The
+** screen keeps the last frame drawn, or shows the target image with
+** bFinish (e.g. when a key skips the animation). Transitions that are not
+** running are left alone.
+** Input:
+**		ptTransition: Transition
+**		bFinish: TRUE = draw the final frame before ending
+** Output: Ended transition
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+CancelTransition(
+	IN OUT   TRANSITION                          *ptTransition,
+	IN       BOOLEAN                             bFinish
+);
+
+/*
+** ===========================================================================
+** Function: RunTransition()
+** Description: Runs a transition to its end, blocking the caller. Frames
+** are scheduled by the engine, each one outputs only what its type changed.
+** See StartTransition() for running it from the caller's own loop.
+** Input:
+**		ptTransition: Transition
+** Output: Target image on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+RunTransition(
+	IN OUT   TRANSITION                          *ptTransition
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_TRANSITION_H_ */
@@ -0,0 +1,401 @@
+/*
+** ===========================================================================
+** File: GOP_Widgets.c
+** Description: UEFI graphics-related code module (progress widgets)
+** ===========================================================================
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+#include <Uefi.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/TimerLib.h>
+#include "UefiDebug.h"
+#include "Rectangle.h"
+#include "GOP.h"
+#include "GOP_Surface.h"
+#include "GOP_Widgets.h"
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**----------------------------------------------------------------------------
+**  Type Definitions
+**----------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Global variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Internal variables
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(internal use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: FillBarColumns()
+** Description: Fills a range of columns of a progress bar with one color
+** Input:
+**		ptBar: Progress bar
+**		nFrom, nTo: Column range [nFrom, nTo) relative to the bar
+**		ptColor: Fill color
+** Output: Columns output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+FillBarColumns(
+	IN PROGRESS_BAR *ptBar,
+	IN UINTN nFrom,
+	IN UINTN nTo,
+	IN EFI_GRAPHICS_OUTPUT_BLT_PIXEL *ptColor
+)
+{
+	RECT       tColumns;
+	if (nFrom >= nTo)
+		return EFI_SUCCESS;
+	SetRect(&tColumns, ptBar->tRect.nLeft + nFrom, ptBar->tRect.nTop, ptBar->tRect.nLeft + nTo - 1, ptBar->tRect.nBottom);
+	return DrawBltEx(ptBar->ptGraphicsOutput, ptColor, EfiBltVideoFill, &tColumns, NULL, 0);
+}
+
+/*
+** ===========================================================================
+** Function: GetBarWidth()
+** Description: Converts a progress value to a filled width
+** Input:
+**		ptBar: Progress bar
+**		nValue: Progress value, at most nTotal
+** Output: None
+** Return value: Filled width in pixels
+** ===========================================================================
+*/
+static
+UINTN
+GetBarWidth(
+	IN CONST PROGRESS_BAR *ptBar,
+	IN UINT64 nValue
+)
+{
+	return (UINTN)DivU64x64Remainder(MultU64x64(nValue, WidthRect((&ptBar->tRect))), ptBar->nTotal, NULL);
+}
+
+/*
+** ===========================================================================
+** Function: GetNextBarValue()
+** Description: Finds the smallest progress value that fills more pixels
+** than a given width, so updates below it can return at once
+** Input:
+**		ptBar: Progress bar
+**		nFilled: Filled width
+** Output: None
+** Return value: Threshold value, MAX_UINT64 when the bar is full
+** ===========================================================================
+*/
+static
+UINT64
+GetNextBarValue(
+	IN CONST PROGRESS_BAR *ptBar,
+	IN UINTN nFilled
+)
+{
+	UINT64     nRemainder;
+	UINT64     nValue;
+	if (nFilled >= WidthRect((&ptBar->tRect)))
+		return MAX_UINT64;
+	/* Smallest value with value * width >= (nFilled + 1) * total */
+	nValue = DivU64x64Remainder(MultU64x64(nFilled + 1, ptBar->nTotal), WidthRect((&ptBar->tRect)), &nRemainder);
+	return (nRemainder != 0) ? nValue + 1 : nValue;
+}
+
+/*
+** ===========================================================================
+** Function: OutputSpinnerPart()
+** Description: Outputs part of the current spinner frame
+** Input:
+**		ptSpinner: Spinner
+**		ptPart: Area of the frame, frame coordinates
+** Output: Frame part output on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+static
+EFI_STATUS
+OutputSpinnerPart(
+	IN SPINNER *ptSpinner,
+	IN CONST RECT *ptPart
+)
+{
+	RECT       tSrc;
+	RECT       tDest;
+	UINTN      nOffset = ptSpinner->nCurrent * ptSpinner->nFrameWidth;
+	SetRect(&tSrc, nOffset + ptPart->nLeft, ptPart->nTop, nOffset + ptPart->nRight, ptPart->nBottom);
+	SetRect(&tDest, ptSpinner->tRect.nLeft + ptPart->nLeft, ptSpinner->tRect.nTop + ptPart->nTop,
+		ptSpinner->tRect.nLeft + ptPart->nRight, ptSpinner->tRect.nTop + ptPart->nBottom);
+	return DrawBltEx(ptSpinner->ptGraphicsOutput, ptSpinner->ptFrames->ptPixels, EfiBltBufferToVideo, &tDest, &tSrc, ptSpinner->ptFrames->nStride);
+}
+
+/*
+** ===========================================================================
+** Function: InitProgressBar()
+** Description: Prepares a horizontal progress bar and draws it empty
+** Input:
+**		ptBar: Progress bar to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptRect: Bar rectangle
+**		ptFillColor: Color of the done part
+**		ptBackColor: Color of the rest
+**		nTotal: Value of a full bar
+** Output: Empty bar on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitProgressBar(
+	OUT      PROGRESS_BAR                        *ptBar,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST RECT                                *ptRect,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptFillColor,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBackColor,
+	IN       UINT64                              nTotal
+)
+{
+	ASSERT_ENSURE(ptBar != NULL && ptGraphicsOutput != NULL && ptRect != NULL && ptFillColor != NULL && ptBackColor != NULL && nTotal != 0);
+	ptBar->ptGraphicsOutput = ptGraphicsOutput;
+	CopyMem(&ptBar->tRect, ptRect, sizeof(RECT));
+	CopyMem(&ptBar->tFillColor, ptFillColor, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	CopyMem(&ptBar->tBackColor, ptBackColor, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+	ptBar->nTotal = nTotal;
+	ptBar->nFilled = 0;
+	ptBar->nLowValue = 0;
+	ptBar->nNextValue = GetNextBarValue(ptBar, 0);
+	return DrawProgressBar(ptBar);
+}
+
+/*
+** ===========================================================================
+** Function: DrawProgressBar()
+** Description: Redraws a whole progress bar (after the screen under it was
+** overwritten)
+** Input:
+**		ptBar: Progress bar
+** Output: Bar on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawProgressBar(
+	IN       PROGRESS_BAR                        *ptBar
+)
+{
+	ASSERT_ENSURE(ptBar != NULL && ptBar->ptGraphicsOutput != NULL);
+	ASSERT_CHECK_EFISTATUS(FillBarColumns(ptBar, 0, ptBar->nFilled, &ptBar->tFillColor));
+	return FillBarColumns(ptBar, ptBar->nFilled, WidthRect((&ptBar->tRect)), &ptBar->tBackColor);
+}
+
+/*
+** ===========================================================================
+** Function: SetProgress()
+** Description: Updates a progress bar. Only the columns that change color
+** are filled; values that do not reach the next pixel return after one
+** comparison, so this can be called for every block processed.
+** Input:
+**		ptBar: Progress bar
+**		nValue: Progress value, clamped to the total
+** Output: Updated bar on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetProgress(
+	IN OUT   PROGRESS_BAR                        *ptBar,
+	IN       UINT64                              nValue
+)
+{
+	UINTN      nFilled;
+	UINTN      nOld;
+	ASSERT_ENSURE(ptBar != NULL && ptBar->ptGraphicsOutput != NULL);
+	/* Common case: still inside the current pixel */
+	if (nValue >= ptBar->nLowValue && nValue < ptBar->nNextValue)
+		return EFI_SUCCESS;
+	nFilled = GetBarWidth(ptBar, MIN(nValue, ptBar->nTotal));
+	nOld = ptBar->nFilled;
+	ptBar->nFilled = nFilled;
+	ptBar->nLowValue = (nFilled == 0) ? 0 : GetNextBarValue(ptBar, nFilled - 1);
+	ptBar->nNextValue = GetNextBarValue(ptBar, nFilled);
+	if (nFilled > nOld)
+		return FillBarColumns(ptBar, nOld, nFilled, &ptBar->tFillColor);
+	return FillBarColumns(ptBar, nFilled, nOld, &ptBar->tBackColor);
+}
+
+/*
+** ===========================================================================
+** Function: InitSpinner()
+** Description: Prepares a spinner from frames laid side by side in one
+** image. The area each frame differs from the next is found here once, so
+** stepping only outputs that area. The first frame is drawn.
+** Input:
+**		ptSpinner: Spinner to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptFrames: Frame strip, must stay valid while the spinner is used
+**		nFrames: Number of frames, up to SPINNER_FRAME_MAX
+**		nX, nY: Top left corner on screen
+**		nPeriodMs: Time per frame for TickSpinner()
+** Output: Spinner on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitSpinner(
+	OUT      SPINNER                             *ptSpinner,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptFrames,
+	IN       UINTN                               nFrames,
+	IN       UINTN                               nX,
+	IN       UINTN                               nY,
+	IN       UINT32                              nPeriodMs
+)
+{
+	CONST UINT32 *pnA;
+	CONST UINT32 *pnB;
+	RECT       *ptChange;
+	UINTN      nFrame;
+	UINTN      nNext;
+	UINTN      nRow;
+	UINTN      nCol;
+	ASSERT_ENSURE(ptSpinner != NULL && ptGraphicsOutput != NULL && ptFrames != NULL && ptFrames->ptPixels != NULL);
+	ASSERT_CHECK(nFrames != 0 && nFrames <= SPINNER_FRAME_MAX && ptFrames->nWidth % nFrames == 0);
+	ZeroMem(ptSpinner, sizeof(SPINNER));
+	ptSpinner->ptGraphicsOutput = ptGraphicsOutput;
+	ptSpinner->ptFrames = ptFrames;
+	ptSpinner->nFrames = nFrames;
+	ptSpinner->nFrameWidth = ptFrames->nWidth / nFrames;
+	SetRect(&ptSpinner->tRect, nX, nY, nX + ptSpinner->nFrameWidth - 1, nY + ptFrames->nHeight - 1);
+	for (nFrame = 0; nFrame < nFrames; nFrame++)
+	{
+		nNext = (nFrame + 1) % nFrames;
+		ptChange = &ptSpinner->atChanges[nFrame];
+		for (nRow = 0; nRow < ptFrames->nHeight; nRow++)
+		{
+			pnA = (CONST UINT32 *)SurfacePixel(ptFrames, nFrame * ptSpinner->nFrameWidth, nRow);
+			pnB = (CONST UINT32 *)SurfacePixel(ptFrames, nNext * ptSpinner->nFrameWidth, nRow);
+			for (nCol = 0; nCol < ptSpinner->nFrameWidth; nCol++)
+			{
+				if (pnA[nCol] == pnB[nCol])
+					continue;
+				if (ptSpinner->abChanged[nFrame] == FALSE)
+				{
+					SetRect(ptChange, nCol, nRow, nCol, nRow);
+					ptSpinner->abChanged[nFrame] = TRUE;
+				}
+				ptChange->nLeft = MIN(ptChange->nLeft, nCol);
+				ptChange->nRight = MAX(ptChange->nRight, nCol);
+				ptChange->nBottom = nRow;
+			}
+		}
+	}
+	ptSpinner->nPeriodTicks = DivU64x32(MultU64x32(GetPerformanceCounterProperties(NULL, NULL), nPeriodMs), 1000);
+	ptSpinner->nLastTick = GetPerformanceCounter();
+	return DrawSpinner(ptSpinner);
+}
+
+/*
+** ===========================================================================
+** Function: DrawSpinner()
+** Description: Redraws the whole current frame of a spinner
+** Input:
+**		ptSpinner: Spinner
+** Output: Spinner on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSpinner(
+	IN       SPINNER                             *ptSpinner
+)
+{
+	RECT       tFrame;
+	ASSERT_ENSURE(ptSpinner != NULL && ptSpinner->ptGraphicsOutput != NULL);
+	SetRect(&tFrame, 0, 0, ptSpinner->nFrameWidth - 1, ptSpinner->ptFrames->nHeight - 1);
+	return OutputSpinnerPart(ptSpinner, &tFrame);
+}
+
+/*
+** ===========================================================================
+** Function: StepSpinner()
+** Description: Shows the next spinner frame, outputting only the area that
+** differs from the previous one
+** Input:
+**		ptSpinner: Spinner
+** Output: Next frame on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StepSpinner(
+	IN OUT   SPINNER                             *ptSpinner
+)
+{
+	UINTN      nPrevious;
+	ASSERT_ENSURE(ptSpinner != NULL && ptSpinner->ptGraphicsOutput != NULL);
+	nPrevious = ptSpinner->nCurrent;
+	ptSpinner->nCurrent = (nPrevious + 1) % ptSpinner->nFrames;
+	if (ptSpinner->abChanged[nPrevious] == FALSE)
+		return EFI_SUCCESS;
+	return OutputSpinnerPart(ptSpinner, &ptSpinner->atChanges[nPrevious]);
+}
+
+/*
+** ===========================================================================
+** Function: TickSpinner()
+** Description: Steps a spinner when its frame period has passed. Meant to
+** be called from a work loop as often as convenient; calls within the
+** period only read the performance counter.
+** Input:
+**		ptSpinner: Spinner
+** Output: Spinner on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TickSpinner(
+	IN OUT   SPINNER                             *ptSpinner
+)
+{
+	UINT64     nNow;
+	ASSERT_ENSURE(ptSpinner != NULL && ptSpinner->ptGraphicsOutput != NULL);
+	nNow = GetPerformanceCounter();
+	if (GetElapsedTicks(ptSpinner->nLastTick, nNow) < ptSpinner->nPeriodTicks)
+		return EFI_SUCCESS;
+	ptSpinner->nLastTick = nNow;
+	return StepSpinner(ptSpinner);
+}
@@ -0,0 +1,215 @@
+/*
+** ===========================================================================
+** File: GOP_Widgets.h
+** Description: UEFI graphics-related code module (progress widgets)
+** ===========================================================================
+*/
+
+#ifndef _GRAPHICS_GOP_WIDGETS_H_
+#define _GRAPHICS_GOP_WIDGETS_H_
+
+/*
+**----------------------------------------------------------------------------
+**  Includes
+**----------------------------------------------------------------------------
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
+
+/*
+**----------------------------------------------------------------------------
+**  Definitions
+**----------------------------------------------------------------------------
+*/
+
+#define SPINNER_FRAME_MAX	32
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;
+	RECT                                         tRect;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                tFillColor;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL                tBackColor;
+	UINT64                                       nTotal;
+	UINT64                                       nLowValue;		/* Values in [nLowValue, nNextValue) keep */
+	UINT64                                       nNextValue;	/* the filled width unchanged */
+	UINTN                                        nFilled;		/* Filled width drawn, in pixels */
+} PROGRESS_BAR;
+
+typedef struct {
+	EFI_GRAPHICS_OUTPUT_PROTOCOL                 *ptGraphicsOutput;
+	CONST SURFACE                                *ptFrames;		/* Frames side by side */
+	UINTN                                        nFrames;
+	UINTN                                        nFrameWidth;
+	UINTN                                        nCurrent;
+	RECT                                         tRect;			/* Where the spinner is on screen */
+	RECT                                         atChanges[SPINNER_FRAME_MAX];	/* Area differing from the next frame */
+	BOOLEAN                                      abChanged[SPINNER_FRAME_MAX];
+	UINT64                                       nPeriodTicks;	/* Counter ticks per frame */
+	UINT64                                       nLastTick;
+} SPINNER;
+
+/*
+**---------------------------------------------------------------------------
+**  Variable Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+**---------------------------------------------------------------------------
+**  Function(external use only) Declarations
+**---------------------------------------------------------------------------
+*/
+
+/*
+** ===========================================================================
+** Function: InitProgressBar()
+** Description: Prepares a horizontal progress bar and draws it empty
+** Input:
+**		ptBar: Progress bar to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptRect: Bar rectangle
+**		ptFillColor: Color of the done part
+**		ptBackColor: Color of the rest
+**		nTotal: Value of a full bar
+** Output: Empty bar on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitProgressBar(
+	OUT      PROGRESS_BAR                        *ptBar,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST RECT                                *ptRect,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptFillColor,
+	IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *ptBackColor,
+	IN       UINT64                              nTotal
+);
+
+/*
+** ===========================================================================
+** Function: DrawProgressBar()
+** Description: Redraws a whole progress bar (after the screen under it was
+** overwritten)
+** Input:
+**		ptBar: Progress bar
+** Output: Bar on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawProgressBar(
+	IN       PROGRESS_BAR                        *ptBar
+);
+
+/*
+** ===========================================================================
+** Function: SetProgress()
+** Description: Updates a progress bar. Only the columns that change color
+** are filled; values that do not reach the next pixel return after one
+** comparison, so this can be called for every block processed.
+** Input:
+**		ptBar: Progress bar
+**		nValue: Progress value, clamped to the total
+** Output: Updated bar on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+SetProgress(
+	IN OUT   PROGRESS_BAR                        *ptBar,
+	IN       UINT64                              nValue
+);
+
+/*
+** ===========================================================================
+** Function: InitSpinner()
+** Description: Prepares a spinner from frames laid side by side in one
+** image. The area each frame differs from the next is found here once, so
+** stepping only outputs that area. The first frame is drawn.
+** Input:
+**		ptSpinner: Spinner to initialize
+**		ptGraphicsOutput: Output protocol
+**		ptFrames: Frame strip, must stay valid while the spinner is used
+**		nFrames: Number of frames, up to SPINNER_FRAME_MAX
+**		nX, nY: Top left corner on screen
+**		nPeriodMs: Time per frame for TickSpinner()
+** Output: Spinner on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+InitSpinner(
+	OUT      SPINNER                             *ptSpinner,
+	IN       EFI_GRAPHICS_OUTPUT_PROTOCOL        *ptGraphicsOutput,
+	IN CONST SURFACE                             *ptFrames,
+	IN       UINTN                               nFrames,
+	IN       UINTN                               nX,
+	IN       UINTN                               nY,
+	IN       UINT32                              nPeriodMs
+);
+
+/*
+** ===========================================================================
+** Function: DrawSpinner()
+** Description: Redraws the whole current frame of a spinner
+** Input:
+**		ptSpinner: Spinner
+** Output: Spinner on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+DrawSpinner(
+	IN       SPINNER                             *ptSpinner
+);
+
+/*
+** ===========================================================================
+** Function: StepSpinner()
+** Description: Shows the next spinner frame, outputting only the area that
+** differs from the previous one
+** Input:
+**		ptSpinner: Spinner
+** Output: Next frame on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+StepSpinner(
+	IN OUT   SPINNER                             *ptSpinner
+);
+
+/*
+** ===========================================================================
+** Function: TickSpinner()
+** Description: Steps a spinner when its frame period has passed. Meant to
+** be called from a work loop as often as convenient; calls within the
+** period only read the performance counter.
+** Input:
+**		ptSpinner: Spinner
+** Output: Spinner on the screen
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+EFIAPI
+TickSpinner(
+	IN OUT   SPINNER                             *ptSpinner
+);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* _GRAPHICS_GOP_WIDGETS_H_ */
@@ -23,6 +23,10 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include "Rectangle.h"
 #include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Blend.h"
+#include "GOP_Transform.h"
+#include "GOP_TileDiff.h"
 #include "UefiDebug.h"
 #include "Image_Bmp.h"
 
@@ -291,6 +295,7 @@ ConvertBmpToGopBlt(
 				Blt->Blue = *pImage++;
 				Blt->Green = *pImage++;
 				Blt->Red = *pImage++;
+				Blt->Reserved = *pImage;
 				break;
 
 			default:
@@ -313,10 +318,65 @@ ConvertBmpToGopBlt(
 	return EFI_SUCCESS;
 };
 
+/*
+** ===========================================================================
+** Function: DecodeBmpImage()
+** Description: Decodes a bitmap image into a surface once, so it can be
+** output any number of times (or to several GOPs) without converting again
+** Input:
+**		pBitmap: Image itself
+**		nBitmappSize: Image size
+**		ptSurface: Surface to initialize, release with DestroySurface()
+** Output: Decoded image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DecodeBmpImage(
+	IN		UINT8*		pBitmap,
+	IN		UINTN		nBitmapSize,
+	OUT		SURFACE		*ptSurface
+)
+{
+	UINTN			nGopBltSize;
+	UINTN			nIndex;
+	UINTN			nFormat = SURFACE_FORMAT_BGRX;
+	BMP_PROCESS_HEADER tBmpProcess;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL* ptGopBlt;
+	ASSERT_ENSURE(pBitmap != NULL && nBitmapSize != 0 && ptSurface != NULL);
+	ASSERT_CHECK_EFISTATUS(ReadBmpHdr(pBitmap, nBitmapSize, &tBmpProcess));
+	ASSERT_DEBUG_MSGONLY("tBmpHeader->Width=%d, Height=%d, BPP=%d, Compression=%d, Size=%d, UpsideDown?=%a", tBmpProcess.tBmpHeader.nWidth, tBmpProcess.tBmpHeader.nHeight, tBmpProcess.tBmpHeader.nBPP, tBmpProcess.tBmpHeader.nCompression, tBmpProcess.tBmpHeader.nImgSize, (tBmpProcess.bIsUpsideDown == TRUE) ? "TRUE" : "FALSE");
+	ASSERT_CHECK_EFISTATUS(ConvertBmpToGopBlt(pBitmap, nBitmapSize, (VOID**)&ptGopBlt, &nGopBltSize, &tBmpProcess));
+	/* 32bpp files that leave the fourth byte zero have no alpha */
+	if (tBmpProcess.nBitPerPixel == BITMAP_BPP_32BPP8888)
+	{
+		for (nIndex = 0; nIndex < nGopBltSize / sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL); nIndex++)
+		{
+			if (ptGopBlt[nIndex].Reserved != 0)
+			{
+				nFormat = SURFACE_FORMAT_BGRA;
+				PremultiplyPixelRow(ptGopBlt, nGopBltSize / sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL), FALSE);
+				break;
+			}
+		}
+	}
+	if (InitSurface(ptSurface, ptGopBlt, tBmpProcess.tBmpHeader.nWidth, tBmpProcess.tBmpHeader.nHeight,
+		tBmpProcess.tBmpHeader.nWidth, nFormat) != EFI_SUCCESS)
+	{
+		FreePool(ptGopBlt);
+		return EFI_LOAD_ERROR;
+	}
+	ptSurface->bOwnsPixels = TRUE;
+	return EFI_SUCCESS;
+}
+
 /*
 ** ===========================================================================
 ** Function: DrawBmpImage()
-** Description: Outputs bitmap image to screen
+** Description: Outputs bitmap image to screen, images with alpha are
+** composited over what is already there. The image transform set with
+** SetImageTransform() is applied first. With SetTileDiff() on, opaque
+** images redrawn at the same rectangle only send the tiles that changed.
 ** Input:
 **		ptGraphicsOutput: GOP
 **		pBitmap: Image itself
@@ -334,15 +394,24 @@ DrawBmpImage(
 	IN		RECT		*ptRect	
 )
 {
-	UINTN			nGopBltSize;
-	BMP_PROCESS_HEADER tBmpProcess;
-	EFI_GRAPHICS_OUTPUT_BLT_PIXEL* ptGopBlt;
+	SURFACE			tImage;
+	EFI_STATUS		nStatus;
 	ASSERT_ENSURE(ptGraphicsOutput != NULL || pBitmap != NULL || nBitmapSize != 0 || ptRect != NULL);
-	ASSERT_CHECK_EFISTATUS(ReadBmpHdr(pBitmap, nBitmapSize, &tBmpProcess));
-	ASSERT_DEBUG_MSGONLY("tBmpHeader->Width=%d, Height=%d, BPP=%d, Compression=%d, Size=%d, UpsideDown?=%a", tBmpProcess.tBmpHeader.nWidth, tBmpProcess.tBmpHeader.nHeight, tBmpProcess.tBmpHeader.nBPP, tBmpProcess.tBmpHeader.nCompression, tBmpProcess.tBmpHeader.nImgSize, (tBmpProcess.bIsUpsideDown == TRUE) ? "TRUE" : "FALSE");
-	ASSERT_CHECK_EFISTATUS(ConvertBmpToGopBlt(pBitmap, nBitmapSize, &ptGopBlt, &nGopBltSize, &tBmpProcess));
-	ptRect->nRight = ptRect->nLeft + tBmpProcess.tBmpHeader.nWidth - 1;
-	ptRect->nBottom = ptRect->nTop + tBmpProcess.tBmpHeader.nHeight - 1;
-	DrawBlt(ptGraphicsOutput, ptGopBlt, EfiBltBufferToVideo, ptRect);
-	return EFI_SUCCESS;
-}
\ No newline at end of file
+	ASSERT_CHECK_EFISTATUS(DecodeBmpImage(pBitmap, nBitmapSize, &tImage));
+	nStatus = ApplyImageTransform(&tImage);
+	if (nStatus == EFI_SUCCESS)
+	{
+		ptRect->nRight = ptRect->nLeft + tImage.nWidth - 1;
+		ptRect->nBottom = ptRect->nTop + tImage.nHeight - 1;
+		if (IsTileDiffEnabled() && tImage.nFormat == SURFACE_FORMAT_BGRX)
+			nStatus = DrawSurfaceDiff(ptGraphicsOutput, &tImage, ptRect);
+		else
+		{
+			/* Blending changes the screen under any retained copy */
+			InvalidateTileDiff(ptGraphicsOutput);
+			nStatus = DrawSurfaceAlpha(ptGraphicsOutput, &tImage, ptRect);
+		}
+	}
+	DestroySurface(&tImage);
+	return nStatus;
+}
@@ -17,6 +17,9 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
 
 #include <IndustryStandard/Bmp.h>
 
@@ -92,10 +95,33 @@ typedef struct {
 **---------------------------------------------------------------------------
 */
 
+/*
+** ===========================================================================
+** Function: DecodeBmpImage()
+** Description: Decodes a bitmap image into a surface once, so it can be
+** output any number of times (or to several GOPs) without converting again
+** Input:
+**		pBitmap: Image itself
+**		nBitmappSize: Image size
+**		ptSurface: Surface to initialize, release with DestroySurface()
+** Output: Decoded image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DecodeBmpImage(
+	IN		UINT8*		pBitmap,
+	IN		UINTN		nBitmapSize,
+	OUT		SURFACE		*ptSurface
+);
+
 /*
 ** ===========================================================================
 ** Function: DrawBmpImage()
-** Description: Outputs bitmap image to screen
+** Description: Outputs bitmap image to screen, images with alpha are
+** composited over what is already there. The image transform set with
+** SetImageTransform() is applied first. With SetTileDiff() on, opaque
+** images redrawn at the same rectangle only send the tiles that changed.
 ** Input:
 **		ptGraphicsOutput: GOP
 **		pBitmap: Image itself
@@ -23,6 +23,10 @@
 #include "UefiDebug.h"
 #include "Rectangle.h"
 #include "GOP.h"
+#include "GOP_Pixel.h"
+#include "GOP_Blend.h"
+#include "GOP_Transform.h"
+#include "GOP_TileDiff.h"
 #include "Image_Qoi.h"
 /*
 ** ===========================================================================
@@ -105,15 +109,56 @@ ConvertQoiToGopBlt(
 	bIsAllocated = TRUE;
 	nBltBufferSize = MultU64x32((UINT64)ptQoiDescription->width, ptQoiDescription->height);
 	ASSERT_CHECK((nBltBufferSize > DivU64x32((UINTN)~0, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL))) == 0);
+	/* qoi_decode() returns RGBA bytes, BLT pixels are BGRA with premultiplied alpha */
+	PremultiplyPixelRow(*ptGopBlt, (UINTN)nBltBufferSize, TRUE);
 	nBltBufferSize = MultU64x32(nBltBufferSize, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
 	*nGopBltSize = (UINTN)nBltBufferSize;
 	return EFI_SUCCESS;
 }
 
+/*
+** ===========================================================================
+** Function: DecodeQoiImage()
+** Description: Decodes a QOI image into a surface once, so it can be output
+** any number of times (or to several GOPs) without converting again
+** Input:
+**		pBitmap: Image itself
+**		nBitmappSize: Image size
+**		ptSurface: Surface to initialize, release with DestroySurface()
+** Output: Decoded image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DecodeQoiImage(
+	IN		UINT8*		pBitmap,
+	IN		UINTN		nBitmapSize,
+	OUT		SURFACE		*ptSurface
+)
+{
+	UINTN			nGopBltSize;
+	qoi_desc		tQoiDesc;
+	EFI_GRAPHICS_OUTPUT_BLT_PIXEL* ptGopBlt;
+	ASSERT_ENSURE(pBitmap != NULL && nBitmapSize != 0 && ptSurface != NULL);
+	ASSERT_CHECK_EFISTATUS(ConvertQoiToGopBlt(pBitmap, nBitmapSize, (VOID**)&ptGopBlt, &nGopBltSize, &tQoiDesc));
+	ASSERT_DEBUG_MSGONLY("tQoiDesc->Width=%d, Height=%d, Channels=%d, Colorspace=%d", tQoiDesc.width, tQoiDesc.height, tQoiDesc.channels, tQoiDesc.colorspace);
+	if (InitSurface(ptSurface, ptGopBlt, tQoiDesc.width, tQoiDesc.height, tQoiDesc.width,
+		(tQoiDesc.channels == 4) ? SURFACE_FORMAT_BGRA : SURFACE_FORMAT_BGRX) != EFI_SUCCESS)
+	{
+		FreePool(ptGopBlt);
+		return EFI_LOAD_ERROR;
+	}
+	ptSurface->bOwnsPixels = TRUE;
+	return EFI_SUCCESS;
+}
+
 /*
 ** ===========================================================================
 ** Function: DrawQoiImage()
-** Description: Outputs QOI image to screen
+** Description: Outputs QOI image to screen, images with alpha are
+** composited over what is already there. The image transform set with
+** SetImageTransform() is applied first. With SetTileDiff() on, opaque
+** images redrawn at the same rectangle only send the tiles that changed.
 ** Input:
 **		ptGraphicsOutput: GOP
 **		pBitmap: Image itself
@@ -131,14 +176,24 @@ DrawQoiImage(
 	IN		RECT		*ptRect
 )
 {
-	UINTN			nGopBltSize;
-	qoi_desc		tQoiDesc;
-	EFI_GRAPHICS_OUTPUT_BLT_PIXEL* ptGopBlt;
+	SURFACE			tImage;
+	EFI_STATUS		nStatus;
 	ASSERT_ENSURE(ptGraphicsOutput != NULL || pBitmap != NULL || nBitmapSize != 0 || ptRect != NULL);
-	ASSERT_CHECK_EFISTATUS(ConvertQoiToGopBlt(pBitmap, nBitmapSize, &ptGopBlt, &nGopBltSize, &tQoiDesc));
-	ASSERT_DEBUG_MSGONLY("tQoiDesc->Width=%d, Height=%d, Channels=%d, Colorspace=%d", tQoiDesc.width, tQoiDesc.height, tQoiDesc.channels, tQoiDesc.colorspace);
-	ptRect->nRight = ptRect->nLeft + tQoiDesc.width - 1;
-	ptRect->nBottom = ptRect->nTop + tQoiDesc.height - 1;
-	DrawBlt(ptGraphicsOutput, ptGopBlt, EfiBltBufferToVideo, ptRect);
-	return EFI_SUCCESS;
-}
\ No newline at end of file
+	ASSERT_CHECK_EFISTATUS(DecodeQoiImage(pBitmap, nBitmapSize, &tImage));
+	nStatus = ApplyImageTransform(&tImage);
+	if (nStatus == EFI_SUCCESS)
+	{
+		ptRect->nRight = ptRect->nLeft + tImage.nWidth - 1;
+		ptRect->nBottom = ptRect->nTop + tImage.nHeight - 1;
+		if (IsTileDiffEnabled() && tImage.nFormat == SURFACE_FORMAT_BGRX)
+			nStatus = DrawSurfaceDiff(ptGraphicsOutput, &tImage, ptRect);
+		else
+		{
+			/* Blending changes the screen under any retained copy */
+			InvalidateTileDiff(ptGraphicsOutput);
+			nStatus = DrawSurfaceAlpha(ptGraphicsOutput, &tImage, ptRect);
+		}
+	}
+	DestroySurface(&tImage);
+	return nStatus;
+}
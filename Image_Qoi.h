@@ -18,6 +18,9 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+#ifndef _GRAPHICS_GOP_SURFACE_H_
+#include "GOP_Surface.h"
+#endif
 
 /*
 **----------------------------------------------------------------------------
@@ -37,10 +40,33 @@ extern "C" {
 **---------------------------------------------------------------------------
 */
 
+/*
+** ===========================================================================
+** Function: DecodeQoiImage()
+** Description: Decodes a QOI image into a surface once, so it can be output
+** any number of times (or to several GOPs) without converting again
+** Input:
+**		pBitmap: Image itself
+**		nBitmappSize: Image size
+**		ptSurface: Surface to initialize, release with DestroySurface()
+** Output: Decoded image
+** Return value: EFI_LOAD_ERROR -> Failure, EFI_SUCCESS -> Success
+** ===========================================================================
+*/
+EFI_STATUS
+DecodeQoiImage(
+	IN		UINT8*		pBitmap,
+	IN		UINTN		nBitmapSize,
+	OUT		SURFACE		*ptSurface
+);
+
 /*
 ** ===========================================================================
 ** Function: DrawQoiImage()
-** Description: Outputs QOI image to screen
+** Description: Outputs QOI image to screen, images with alpha are
+** composited over what is already there. The image transform set with
+** SetImageTransform() is applied first. With SetTileDiff() on, opaque
+** images redrawn at the same rectangle only send the tiles that changed.
 ** Input:
 **		ptGraphicsOutput: GOP
 **		pBitmap: Image itself
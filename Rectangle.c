@@ -161,3 +161,154 @@ OffsetRect(
 	ptRect->nBottom += nDiffY;
 	return TRUE;
 }
+
+/*
+** ===========================================================================
+** Function: IntersectRect()
+** Description: Computes the overlapping part of two rectangles
+** Input:
+**		ptDestRect: Intersection output (may alias one of the inputs)
+**		ptRect1, ptRect2: Rectangles to intersect
+** Output: Intersection rectangle (left untouched when there is no overlap)
+** Return value: FALSE -> No overlap, TRUE -> Rectangles overlap
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+IntersectRect(
+	OUT      RECT                                *ptDestRect,
+	IN CONST RECT                                *ptRect1,
+	IN CONST RECT                                *ptRect2
+)
+{
+	RECT tResult;
+	ASSERT_ENSURE_FALSE(ptDestRect != NULL && ptRect1 != NULL && ptRect2 != NULL);
+	tResult.nLeft = MAX(ptRect1->nLeft, ptRect2->nLeft);
+	tResult.nTop = MAX(ptRect1->nTop, ptRect2->nTop);
+	tResult.nRight = MIN(ptRect1->nRight, ptRect2->nRight);
+	tResult.nBottom = MIN(ptRect1->nBottom, ptRect2->nBottom);
+	if (tResult.nLeft > tResult.nRight || tResult.nTop > tResult.nBottom)
+		return FALSE;
+	CopyMem(ptDestRect, &tResult, sizeof(RECT));
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: UnionRect()
+** Description: Computes the bounding rectangle of two rectangles
+** Input:
+**		ptDestRect: Union output (may alias one of the inputs)
+**		ptRect1, ptRect2: Rectangles to join
+** Output: Bounding rectangle
+** Return value: FALSE -> Failure, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+UnionRect(
+	OUT      RECT                                *ptDestRect,
+	IN CONST RECT                                *ptRect1,
+	IN CONST RECT                                *ptRect2
+)
+{
+	RECT tResult;
+	ASSERT_ENSURE_FALSE(ptDestRect != NULL && ptRect1 != NULL && ptRect2 != NULL);
+	tResult.nLeft = MIN(ptRect1->nLeft, ptRect2->nLeft);
+	tResult.nTop = MIN(ptRect1->nTop, ptRect2->nTop);
+	tResult.nRight = MAX(ptRect1->nRight, ptRect2->nRight);
+	tResult.nBottom = MAX(ptRect1->nBottom, ptRect2->nBottom);
+	CopyMem(ptDestRect, &tResult, sizeof(RECT));
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: ClearRectList()
+** Description: Empties a dirty rectangle list
+** Input:
+**		ptList: Rectangle list
+** Output: Empty list
+** Return value: FALSE -> Failure, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+ClearRectList(
+	IN OUT RECT_LIST                             *ptList
+)
+{
+	ASSERT_ENSURE_FALSE(ptList != NULL);
+	ptList->nCount = 0;
+	return TRUE;
+}
+
+/*
+** ===========================================================================
+** Function: AddRectToList()
+** Description: Adds a rectangle to a dirty rectangle list, merging it with
+** the entries it overlaps or borders as long as the merged rectangle is not
+** bigger than the parts it replaces. When the list is full, the two entries
+** whose union grows the least are merged to make room.
+** Input:
+**		ptList: Rectangle list
+**		ptRect: Rectangle to add
+** Output: Updated list
+** Return value: FALSE -> Failure, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+AddRectToList(
+	IN OUT   RECT_LIST                           *ptList,
+	IN CONST RECT                                *ptRect
+)
+{
+	RECT  tNew;
+	RECT  tUnion;
+	UINTN nIndex;
+	UINTN nBestIndex;
+	UINTN nGrowth;
+	UINTN nBestGrowth;
+	BOOLEAN bMerged;
+	ASSERT_ENSURE_FALSE(ptList != NULL && ptRect != NULL);
+	ASSERT_ENSURE_FALSE(ptRect->nLeft <= ptRect->nRight && ptRect->nTop <= ptRect->nBottom);
+	CopyMem(&tNew, ptRect, sizeof(RECT));
+	do {
+		bMerged = FALSE;
+		for (nIndex = 0; nIndex < ptList->nCount; nIndex++)
+		{
+			UnionRect(&tUnion, &ptList->atRects[nIndex], &tNew);
+			if (AreaRect((&tUnion)) <= AreaRect((&ptList->atRects[nIndex])) + AreaRect((&tNew)))
+			{
+				/* Merge, drop the old entry and retry: the bigger rectangle may now swallow others */
+				CopyMem(&tNew, &tUnion, sizeof(RECT));
+				ptList->nCount--;
+				CopyMem(&ptList->atRects[nIndex], &ptList->atRects[ptList->nCount], sizeof(RECT));
+				bMerged = TRUE;
+				break;
+			}
+		}
+		if (bMerged == FALSE && ptList->nCount == RECT_LIST_MAX)
+		{
+			nBestIndex = 0;
+			nBestGrowth = (UINTN)~0;
+			for (nIndex = 0; nIndex < ptList->nCount; nIndex++)
+			{
+				UnionRect(&tUnion, &ptList->atRects[nIndex], &tNew);
+				nGrowth = AreaRect((&tUnion)) - AreaRect((&ptList->atRects[nIndex]));
+				if (nGrowth < nBestGrowth)
+				{
+					nBestGrowth = nGrowth;
+					nBestIndex = nIndex;
+				}
+			}
+			UnionRect(&tNew, &ptList->atRects[nBestIndex], &tNew);
+			ptList->nCount--;
+			CopyMem(&ptList->atRects[nBestIndex], &ptList->atRects[ptList->nCount], sizeof(RECT));
+			bMerged = TRUE;
+		}
+	} while (bMerged == TRUE);
+	CopyMem(&ptList->atRects[ptList->nCount++], &tNew, sizeof(RECT));
+	return TRUE;
+}
@@ -34,6 +34,13 @@ typedef struct {
 #pragma pack()
 #define WidthRect(ptRect) (ptRect->nRight - ptRect->nLeft + 1)
 #define HeightRect(ptRect) (ptRect->nBottom - ptRect->nTop + 1)
+#define AreaRect(ptRect) (WidthRect(ptRect) * HeightRect(ptRect))
+#define RECT_LIST_MAX 32
+
+typedef struct {
+	UINTN                                        nCount;
+	RECT                                         atRects[RECT_LIST_MAX];
+} RECT_LIST;
 
 /*
 **---------------------------------------------------------------------------
@@ -124,6 +131,81 @@ OffsetRect(
 	IN     UINTN                                 nDiffY
 );
 
+/*
+** ===========================================================================
+** Function: IntersectRect()
+** Description: Computes the overlapping part of two rectangles
+** Input:
+**		ptDestRect: Intersection output (may alias one of the inputs)
+**		ptRect1, ptRect2: Rectangles to intersect
+** Output: Intersection rectangle (left untouched when there is no overlap)
+** Return value: FALSE -> No overlap, TRUE -> Rectangles overlap
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+IntersectRect(
+	OUT      RECT                                *ptDestRect,
+	IN CONST RECT                                *ptRect1,
+	IN CONST RECT                                *ptRect2
+);
+
+/*
+** ===========================================================================
+** Function: UnionRect()
+** Description: Computes the bounding rectangle of two rectangles
+** Input:
+**		ptDestRect: Union output (may alias one of the inputs)
+**		ptRect1, ptRect2: Rectangles to join
+** Output: Bounding rectangle
+** Return value: FALSE -> Failure, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+UnionRect(
+	OUT      RECT                                *ptDestRect,
+	IN CONST RECT                                *ptRect1,
+	IN CONST RECT                                *ptRect2
+);
+
+/*
+** ===========================================================================
+** Function: ClearRectList()
+** Description: Empties a dirty rectangle list
+** Input:
+**		ptList: Rectangle list
+** Output: Empty list
+** Return value: FALSE -> Failure, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+ClearRectList(
+	IN OUT RECT_LIST                             *ptList
+);
+
+/*
+** ===========================================================================
+** Function: AddRectToList()
+** Description: Adds a rectangle to a dirty rectangle list, merging it with
+** the entries it overlaps or borders as long as the merged rectangle is not
+** bigger than the parts it replaces. When the list is full, the two entries
+** whose union grows the least are merged to make room.
+** Input:
+**		ptList: Rectangle list
+**		ptRect: Rectangle to add
+** Output: Updated list
+** Return value: FALSE -> Failure, TRUE -> Success
+** ===========================================================================
+*/
+BOOLEAN
+EFIAPI
+AddRectToList(
+	IN OUT   RECT_LIST                           *ptList,
+	IN CONST RECT                                *ptRect
+);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif